@@ -0,0 +1,146 @@
+#ifndef __ACCUMULATOR_H_
+#define __ACCUMULATOR_H_
+
+#include <functional>
+#include <iostream>
+#include <vector>
+
+// Internal
+#include <generic.hpp>
+#include <neighbours.hpp>
+#include <profiler.hpp>
+#include <rdf.hpp>
+#include <selection.hpp>
+
+/*! \file accumulator.hpp
+    \brief This header file contains the \f$g(r)\f$ accumulator, which is the
+   library interface of the \f$g(r)\f$ calculation.
+
+    Details.
+*/
+
+/*!
+ *  \addtogroup rdf
+ *  @{
+ */
+
+/*! \brief Library interface of the \f$g(r)\f$ calculation.
+ *
+ An rdf::RdfAccumulator owns its settings and raw histograms (an
+ rdf::RdfState), and is used in three steps:
+
+ 1. <b>Construction:</b> the bin width, cutoff and number of atom types are
+ fixed, and the histograms are zeroed.
+ 2. <b>Accumulation:</b> rdf::RdfAccumulator::addFrame bins the pairs of a
+ frame, which is only read (never copied). The accumulators of separate
+ threads, processes or jobs are added up with rdf::RdfAccumulator::merge.
+ 3. <b>Result:</b> rdf::RdfAccumulator::result gives the normalized
+ \f$g(r)\f$, and leaves the accumulator as it is, so frames can still be
+ added afterwards.
+
+ For error bars, rdf::RdfAccumulator::endBlock closes a block of the frames
+ added so far, and adds its \f$g(r)\f$ to the block averages
+ (rdf::BlockStats), whose spread gives the standard error of the result. Block
+ averages are not carried over by rdf::RdfAccumulator::merge, since the blocks
+ of separate accumulators need not be consecutive frames.
+
+ The pairs are binned by a pair kernel (rdf::PairKernel), which can be
+ swapped for another one. The kernels here are rdf::defaultKernel (a cell list
+ whenever the box allows it, split between OpenMP threads when built with
+ OpenMP), rdf::cellListKernel and rdf::bruteForceKernel. The accumulator keeps
+ a cell list for its kernel, which is reused from frame to frame, so nothing
+ is reallocated once the first frame has been added.
+
+ The \f$g(r)\f$ may also be restricted to selected reference and target
+ atoms (see rdf::RdfAccumulator::setSelection). The selections are evaluated
+ for every frame as it is added, and only the pairs of selected atoms are
+ binned (see rdf::accumulateSelected), in place of the pair kernel.
+
+ An accumulator is not thread-safe: every thread should have its own, and
+ merge them at the end.
+ */
+
+namespace rdf {
+
+// Bins the pairs of a frame into the raw histograms. The settings are those
+// of the accumulation state, and cells is a cell list which may be reused
+// from frame to frame. Returns 0 (success) or 1 (failure)
+typedef std::function<int(uint64_t *histogram, const gen::Frame &frame,
+                          const RdfState &settings, nlist::CellList *cells)>
+    PairKernel;
+
+// Bins every pair of particles
+int bruteForceKernel(uint64_t *histogram, const gen::Frame &frame,
+                     const RdfState &settings, nlist::CellList *cells);
+
+// Bins the pairs in neighbouring cells of a cell list, if the box allows it
+int cellListKernel(uint64_t *histogram, const gen::Frame &frame,
+                   const RdfState &settings, nlist::CellList *cells);
+
+// Uses a cell list if possible, and OpenMP threads if available
+int defaultKernel(uint64_t *histogram, const gen::Frame &frame,
+                  const RdfState &settings, nlist::CellList *cells);
+
+// Bins the pairs in neighbouring cells of a cell list built for the frame
+int builtCellKernel(uint64_t *histogram, const gen::Frame &frame,
+                    const RdfState &settings, const nlist::CellList &cells);
+
+/*! \brief Accumulator of the \f$g(r)\f$ (and partial \f$g_{ab}(r)\f$) over
+ frames.
+ */
+class RdfAccumulator {
+public:
+  // Empty accumulator; the number of bins is cutoff/binsize + 1
+  RdfAccumulator(double binsize, double cutoff, int ntypes = 1,
+                 PairKernel kernel = defaultKernel);
+  // Accumulator carrying on from a saved state (see io::readCheckpoint)
+  explicit RdfAccumulator(const RdfState &state,
+                          PairKernel kernel = defaultKernel);
+
+  // Adds the pairs, volume and numbers of particles of a frame, binning the
+  // pairs from a cell list of the frame if one is given
+  int addFrame(const gen::Frame &frame,
+               const nlist::CellList *cells = nullptr);
+  // Adds the accumulation of another accumulator with the same settings
+  int merge(const RdfAccumulator &other);
+  // Normalized histograms (see rdf::normalizeState)
+  std::vector<double> result() const;
+  // Empties the histograms and sums, keeping the settings
+  void reset();
+  // Adds the g(r) of the frames since the last block to the block averages
+  void endBlock();
+
+  // Only bins the pairs of the selected reference and target atoms; must be
+  // set before any frames are added
+  int setSelection(const sel::Selection &reference,
+                   const sel::Selection &target);
+  // Finds the distances from float copies of the coordinates (see
+  // nlist::CellList); not available with atom selections
+  int setSinglePrecision(bool singlePrecision);
+
+  // Replaces the pair kernel
+  void setKernel(PairKernel kernel) { kernel_ = kernel; }
+  // Settings and raw sums, e.g. for checkpoints
+  const RdfState &state() const { return state_; }
+  // true if the distances are found in float
+  bool singlePrecision() const { return cells_.singlePrecision; }
+  // Number of frames added
+  int nframes() const { return state_.nframes; }
+  // Block averages of the closed blocks
+  const BlockStats &blocks() const { return blocks_; }
+
+private:
+  RdfState state_;       // Settings, raw histograms and sums
+  PairKernel kernel_;    // Bins the pairs of a frame
+  nlist::CellList cells_; // Cell list reused by the kernel
+  RdfState blockStart_;  // State when the current block was started
+  BlockStats blocks_;    // Block averages of the closed blocks
+  bool selecting_ = false; // true if only selected atoms are binned
+  sel::Selection reference_, target_; // Reference and target selections
+  std::vector<int> referenceAtoms_, targetAtoms_; // Selected atoms of a frame
+  gen::Frame targets_;   // Target atoms of a frame, gathered
+};
+
+} // namespace rdf
+
+#endif // __ACCUMULATOR_H_
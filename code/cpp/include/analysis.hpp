@@ -0,0 +1,107 @@
+#ifndef __ANALYSIS_H_
+#define __ANALYSIS_H_
+
+#include <algorithm>
+#include <array>
+#include <string>
+#include <vector>
+
+// Internal
+#include <accumulator.hpp>
+#include <generic.hpp>
+#include <neighbours.hpp>
+#include <selection.hpp>
+
+/*! \file analysis.hpp
+    \brief This header file contains the sets of \f$g(r)\f$ analyses which are
+   evaluated in the same pass over a trajectory.
+
+    Details.
+*/
+
+/*!
+ *  \addtogroup rdf
+ *  @{
+ */
+
+/*! \brief Several \f$g(r)\f$ analyses evaluated in one pass.
+ *
+ An analysis (rdf::Analysis) is one combination of bin width, cutoff and atom
+ selections, with its own accumulator. An rdf::AnalysisSet holds the
+ accumulators of all the analyses of a run, so that every frame is read and
+ parsed once, and then added to all of them.
+
+ The analyses also share their neighbour search where their cutoffs allow it:
+ the cell list of a frame only depends on the number of cells along each
+ dimension, so all the analyses whose cutoffs give the same grid of cells are
+ binned from a single cell list, which is built once per frame (analyses in
+ single precision share their own float cell lists). The analyses
+ with atom selections bin their own target atoms (see rdf::accumulateSelected),
+ and those whose box is too small for a cell list use their pair kernel.
+ */
+
+namespace rdf {
+
+/*! \brief Settings of one \f$g(r)\f$ analysis.
+ */
+struct Analysis {
+  std::string name = "rdf"; //!< Name, which its output files are named after
+  double binsize = 0.01;    //!< Bin width
+  double cutoff = 12;       //!< Cutoff of the \f$g(r)\f$
+  bool partialRdf = true;   //!< Also get \f$g_{ab}(r)\f$ for every pair of
+                            //!< atom types
+  bool singlePrecision = false; //!< Find the distances in float (see
+                                //!< rdf::RdfAccumulator::setSinglePrecision)
+  std::string referenceExpression = "all"; //!< Reference atoms, as written
+  std::string targetExpression = "all";    //!< Target atoms, as written
+  sel::Selection reference; //!< Reference atoms (see sel::Selection)
+  sel::Selection target;    //!< Target atoms
+
+  // true unless every atom is both a reference and a target atom
+  bool isSelecting() const { return !reference.isAll() || !target.isAll(); }
+  // Normalized selections of an accumulation (see rdf::RdfState::selection)
+  std::string selection() const {
+    return isSelecting() ? sel::formatSelection(reference) + "; " +
+                               sel::formatSelection(target)
+                         : "";
+  }
+  // Number of bins of each histogram
+  int nbin() const { return (int)(cutoff / binsize) + 1; }
+  // Number of atom types of the accumulation, if the frames have ntypes
+  int numberOfTypes(int ntypes) const {
+    return (partialRdf && !isSelecting()) ? std::max(ntypes, 1) : 1;
+  }
+};
+
+/*! \brief Accumulators of several analyses, which share the frames and their
+ cell lists.
+ */
+class AnalysisSet {
+public:
+  // Adds an analysis, accumulated with ntypes atom types (see
+  // rdf::Analysis::numberOfTypes); returns 0 (success) or 1 (failure)
+  int add(const Analysis &analysis, int ntypes);
+  // Adds a frame to every analysis
+  int addFrame(const gen::Frame &frame);
+
+  // Number of analyses
+  int size() const { return accumulators_.size(); }
+  // Accumulator of an analysis, in the order they were added
+  RdfAccumulator &operator[](int ianalysis) {
+    return accumulators_[ianalysis];
+  }
+  const RdfAccumulator &operator[](int ianalysis) const {
+    return accumulators_[ianalysis];
+  }
+
+private:
+  std::vector<RdfAccumulator> accumulators_; // Accumulator of every analysis
+  std::vector<bool> sharing_; // true if an analysis may use a shared cell list
+  std::vector<nlist::CellList> cells_; // Shared cell lists of the frame
+  // Cells of each shared cell list, and 1 if it is in single precision
+  std::vector<std::array<int, 4>> grids_;
+};
+
+} // namespace rdf
+
+#endif // __ANALYSIS_H_
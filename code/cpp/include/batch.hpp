@@ -0,0 +1,84 @@
+#ifndef __BATCH_H_
+#define __BATCH_H_
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Internal
+#include <analysis.hpp>
+#include <binaryTraj.hpp>
+#include <config.hpp>
+#include <generic.hpp>
+#include <inputOutput.hpp>
+#include <mmapReader.hpp>
+#include <pipeline.hpp>
+#include <rdf.hpp>
+
+/*! \file batch.hpp
+    \brief This header file contains the batch mode of runYoda, which analyses
+   many trajectories at once.
+
+    Details.
+*/
+
+/*!
+ *  \addtogroup batch
+ *  @{
+ */
+
+/*! \brief Batch analysis of many trajectories on a pool of threads.
+ *
+ Every trajectory of the batch has its own accumulations, and is analysed with
+ the same settings and frame selection as a single run. The selected frames of
+ all the trajectories are split into tasks of batchChunk frames, which a pool
+ of threads runs with work stealing (see pipeline::runStealing). Since a large
+ trajectory is split into many tasks, every thread stays busy until the whole
+ batch is done, however uneven the trajectories are.
+
+ A task reads its frames one at a time into the buffer of its thread, and adds
+ them to a scratch accumulation, which is added to the accumulation of the
+ trajectory at the end of the task. At most maxReaders threads read (fault in
+ and parse) frames at once, so that the parallel filesystem is not swamped,
+ while the others bin the pairs of the frames they have already read. Once the
+ last task of a trajectory is done, its results are written out, and its file
+ is released.
+
+ With MPI, the ranks take the trajectories in turn.
+ */
+
+namespace batch {
+
+/*! \brief A trajectory of the batch, with its frames and accumulations.
+ */
+struct Trajectory {
+  std::string filename; //!< Path of the trajectory
+  std::string name;     //!< Name of its output directory
+  bool isBinary = false; //!< true for a binary trajectory (see yodaConvert)
+  io::MappedFile dumpFile;        //!< Memory map of a text trajectory
+  io::BinaryTrajectory binaryTraj; //!< Binary trajectory
+  std::vector<io::FrameIndexEntry> frameIndex; //!< Index of every frame
+  std::vector<int> selectedFrames; //!< Frames (from 0) to be analysed
+  std::vector<int> ntypes; //!< Atom types of every analysis
+  std::vector<rdf::RdfState> total; //!< Accumulation of every analysis
+  std::mutex mutex;                 //!< Guards total
+  std::atomic<int> remaining{0};    //!< Tasks which are not done yet
+  std::atomic<int> fail{0};         //!< Non-zero if anything failed
+};
+
+// Reads the list of trajectories of a batch
+int readTrajectoryList(const std::string &filename,
+                       std::vector<std::string> *trajectories);
+
+// Analyses every trajectory of a batch
+int run(const io::RunConfig &config, const std::vector<rdf::Analysis> &analyses,
+        const std::vector<std::string> &trajectories, int rank = 0,
+        int nranks = 1);
+
+} // namespace batch
+
+#endif // __BATCH_H_
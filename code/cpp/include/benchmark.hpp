@@ -0,0 +1,99 @@
+#ifndef __BENCHMARK_H_
+#define __BENCHMARK_H_
+
+#include <math.h>
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Internal
+#include <generic.hpp>
+
+/*! \file benchmark.hpp
+    \brief This header file contains the synthetic systems and timers of the
+   benchmark suite.
+
+    Details.
+*/
+
+/*!
+ *  \addtogroup bench
+ *  @{
+ */
+
+/*! \brief Synthetic systems and timing for the yodaBench benchmark suite.
+ *
+ The benchmarks run on synthetic periodic systems rather than trajectory
+ files, so that they can be run anywhere, at any size:
+
+ - <b>gas</b>: particles placed uniformly at random, at a low density.
+ - <b>fcc</b>: a perfect face-centred cubic lattice.
+ - <b>liquid</b>: an fcc lattice whose particles are displaced at random, at
+ the density of a Lennard-Jones liquid near its triple point (argon).
+
+ Every stage (parsing, pair accumulation, normalization) is timed on its own
+ with bench::timeIt, which repeats it until a minimum time has passed, so that
+ short stages are measured as precisely as long ones.
+ */
+
+namespace bench {
+
+// Number density of the random gas (per cubic Angstrom)
+const double gasDensity = 0.002;
+// Number density of the fcc lattice and the liquid: rho* = 0.84 with
+// sigma = 3.405 Angstrom
+const double liquidDensity = 0.84 / (3.405 * 3.405 * 3.405);
+
+/*! \brief Result of timing one stage.
+ */
+struct Timing {
+  int reps = 0;        //!< Number of times the stage was run
+  double seconds = 0;  //!< Mean wall time of one run
+};
+
+// Builds a synthetic periodic system of about natoms particles
+int makeSystem(gen::Frame *frame, const std::string &kind, int natoms,
+               unsigned seed = 42);
+
+// Writes a frame out as a lammps trajectory frame
+std::string formatFrame(const gen::Frame &frame);
+
+// Times a stage, repeating it for at least minTime seconds
+int timeIt(const std::function<int()> &stage, double minTime, Timing *timing);
+
+// --------------------------------------------
+// INLINE FUNCTIONS
+
+/********************************************/ /**
+ *  Function for getting the number of distinct pairs of particles in a frame,
+ which is the work done by a brute-force pass.
+ *  @param[in] nop The number of particles
+ ***********************************************/
+inline double numberOfPairs(int nop) { return 0.5 * (double)nop * (nop - 1); }
+
+/********************************************/ /**
+ *  Function for splitting a comma-separated list, such as "gas,fcc" or
+ "1000,8000", into its items.
+ *  @param[in] list The comma-separated list
+ ***********************************************/
+inline std::vector<std::string> splitList(const std::string &list) {
+  std::vector<std::string> items; // Items of the list
+  std::stringstream ss(list);
+  std::string item; // Current item
+  while (std::getline(ss, item, ',')) {
+    if (!item.empty()) {
+      items.push_back(item);
+    }
+  }
+  return items;
+}
+
+} // namespace bench
+
+#endif // __BENCHMARK_H_
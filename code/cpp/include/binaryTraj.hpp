@@ -0,0 +1,184 @@
+#ifndef __BINARYTRAJ_H_
+#define __BINARYTRAJ_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Internal
+#include <generic.hpp>
+#include <inputOutput.hpp>
+#include <mmapReader.hpp>
+
+/*! \file binaryTraj.hpp
+    \brief This header file contains the compact binary trajectory format.
+
+    Details.
+*/
+
+/*!
+ *  \addtogroup io
+ *  @{
+ */
+
+/*! \brief Compact binary trajectory format.
+ *
+ Text lammps trajectories have to be parsed again for every analysis. A binary
+ trajectory is written once from a text one (see the yodaConvert tool) and
+ is then memory-mapped, so loading a frame is (nearly) a memcpy.
+
+ The layout of a binary trajectory file is:
+
+ 1. <b>Header</b> (io::BinaryTrajHeader): a signature, the version, the
+ precision and encoding of the coordinates, the number of frames and the offset
+ of the table of contents.
+ 2. <b>Frame blocks</b>, one per frame. With io::BinaryEncoding::raw, a block
+ holds the atom IDs and types as int32 arrays, then the x, y and z coordinates
+ as separate float32 or float64 arrays. With io::BinaryEncoding::quantized,
+ every coordinate is rounded to a multiple of the quantization step above the
+ lower box bound, and the IDs (as differences from the previous ID), types and
+ coordinates are all written as zigzag variable-length integers, so that the
+ error of a coordinate is at most half a step.
+ 3. <b>Table of contents</b>: for every frame, the offset and size of its block,
+ its timestep, number of atoms and box, with its tilt factors.
+
+ Only files of the current version (io::binaryTrajVersion) are read.
+
+ All numbers are stored in the byte order of the machine which wrote the file.
+ */
+
+namespace io {
+
+// Signature at the start of every binary trajectory file
+const char binaryTrajMagic[9] = "YODATRJ1";
+
+// Version of the format which is written and read
+const uint32_t binaryTrajVersion = 2;
+
+/*! \brief Encoding of the frame blocks of a binary trajectory.
+ */
+enum class BinaryEncoding : uint32_t {
+  raw = 0,      //!< Plain float32 or float64 arrays
+  quantized = 1 //!< Quantized, variable-length integer coordinates
+};
+
+/*! \brief Header at the start of a binary trajectory file.
+ */
+struct BinaryTrajHeader {
+  char magic[8];            //!< Signature, io::binaryTrajMagic
+  uint32_t version = binaryTrajVersion; //!< Version of the format
+  uint32_t precision = 4;   //!< Bytes per raw coordinate (4 or 8)
+  BinaryEncoding encoding = BinaryEncoding::raw; //!< Encoding of the blocks
+  uint32_t reserved = 0;    //!< Unused, for alignment
+  uint64_t nframes = 0;     //!< Number of frames
+  uint64_t tocOffset = 0;   //!< Offset of the table of contents
+  double quantStep = 0;     //!< Quantization step (quantized encoding only)
+};
+
+/*! \brief Entry of the table of contents of a binary trajectory.
+ */
+struct BinaryTocEntry {
+  uint64_t offset;     //!< Offset of the frame block
+  uint64_t blockSize;  //!< Size of the frame block in bytes
+  int64_t timestep;    //!< Timestep value of the frame
+  int64_t nop;         //!< Number of atoms in the frame
+  double boxLo[3];     //!< Lower box bounds
+  double box[3];       //!< Box lengths
+  double tilt[3];      //!< Tilt factors xy, xz and yz
+};
+
+/*! \brief Memory-mapped reader for binary trajectory files.
+ */
+class BinaryTrajectory {
+public:
+  // Maps a binary trajectory and reads its table of contents
+  int open(const std::string &filename);
+  // Releases the map
+  void close() {
+    file_.close();
+    toc_.clear();
+  }
+  // Number of frames
+  int nframes() const { return toc_.size(); }
+  // Header of the file
+  const BinaryTrajHeader &header() const { return header_; }
+  // Frame index equivalent to that of the text trajectory
+  std::vector<FrameIndexEntry> frameIndex() const;
+  // Reads in a frame (0-based) into a reusable frame
+  int readFrame(int iframe, gen::Frame *frame) const;
+
+private:
+  MappedFile file_;               // Memory map of the whole file
+  BinaryTrajHeader header_;       // Header of the file
+  std::vector<BinaryTocEntry> toc_; // Table of contents
+};
+
+// --------------------------------------------
+// INLINE FUNCTIONS
+
+/********************************************/ /**
+ *  Function for checking if a file is a binary trajectory, from its signature.
+ *  @param[in] filename The path of the file
+ ***********************************************/
+inline bool isBinaryTrajectory(const std::string &filename) {
+  std::ifstream file(filename, std::ios::binary);
+  char magic[8];
+  if (!file.read(magic, sizeof(magic))) {
+    return false;
+  }
+  return (memcmp(magic, io::binaryTrajMagic, sizeof(magic)) == 0);
+}
+
+/********************************************/ /**
+ *  Function for appending a signed integer to a buffer as a zigzag
+ variable-length integer (7 bits per byte, small magnitudes first).
+ *  @param[in] value The integer
+ *  @param[in, out] buffer The buffer
+ ***********************************************/
+inline void putVarint(int64_t value, std::vector<unsigned char> *buffer) {
+  uint64_t zigzag = ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+  while (zigzag >= 0x80) {
+    buffer->push_back((unsigned char)(zigzag | 0x80));
+    zigzag >>= 7;
+  }
+  buffer->push_back((unsigned char)zigzag);
+}
+
+/********************************************/ /**
+ *  Function for reading a zigzag variable-length integer.
+ *  @param[in, out] ptr The current position, which is moved past the integer
+ *  @param[in] end The end of the buffer, which is never read past
+ *  @param[out] value The integer
+ *  \return an int value of 0 (success) or 1 (the integer runs past the end
+ of the buffer, or is longer than 64 bits)
+ ***********************************************/
+inline int getVarint(const unsigned char **ptr, const unsigned char *end,
+                     int64_t *value) {
+  uint64_t zigzag = 0;
+  int shift = 0;
+  unsigned char byte;
+  do {
+    if (*ptr >= end || shift >= 64) {
+      return 1;
+    }
+    byte = *(*ptr)++;
+    zigzag |= (uint64_t)(byte & 0x7f) << shift;
+    shift += 7;
+  } while (byte & 0x80);
+  *value = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+  return 0;
+}
+
+// --------------------------------------------
+
+// Converts a text lammps trajectory into a binary trajectory
+int convertToBinary(std::string inputFile, std::string outputFile,
+                    uint32_t precision = 4,
+                    BinaryEncoding encoding = BinaryEncoding::raw,
+                    double quantStep = 1e-3);
+
+} // namespace io
+
+#endif // __BINARYTRAJ_H_
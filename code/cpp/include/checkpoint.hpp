@@ -0,0 +1,93 @@
+#ifndef __CHECKPOINT_H_
+#define __CHECKPOINT_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Internal
+#include <rdf.hpp>
+
+/*! \file checkpoint.hpp
+    \brief This header file contains the checkpoint files of \f$g(r)\f$
+   accumulations.
+
+    Details.
+*/
+
+/*!
+ *  \addtogroup io
+ *  @{
+ */
+
+/*! \brief Checkpoint files of \f$g(r)\f$ accumulations.
+ *
+ A checkpoint holds an rdf::RdfState: the raw histograms, the number of frames,
+ the summed box volume and numbers of particles, and the timestep and offset of
+ the last frame accumulated. Since nothing is normalized, a run can be resumed
+ from a checkpoint, new trajectory segments can be added to it, and the
+ checkpoints of separate jobs can be merged (see the yodaMerge tool), with the
+ normalization left to the very end.
+
+ The layout of a checkpoint file is:
+
+ 1. <b>Header</b> (io::CheckpointHeader): a signature, the version, the
+ settings, the sums and the last frame.
+ 2. <b>Selections</b>: if atoms were selected (see rdf::accumulateSelected),
+ the normalized reference and target selections, as the text of
+ rdf::RdfState::selection (without a terminating null).
+ 3. <b>Counts</b>: the summed numbers of particles (total, then each type), as
+ float64. If atoms were selected, these are followed by the summed numbers of
+ reference and target atoms.
+ 4. <b>Histograms</b>: the raw histograms, as uint64 pair counts.
+
+ Only files of the current version (io::checkpointVersion) are read.
+
+ Checkpoints are written to a temporary file which is then renamed, so a job
+ killed while writing one leaves the previous checkpoint intact. All numbers
+ are stored in the byte order of the machine which wrote the file.
+ */
+
+namespace io {
+
+// Signature at the start of every checkpoint file
+const char checkpointMagic[9] = "YODACKP1";
+
+// Version of the format which is written and read
+const uint32_t checkpointVersion = 4;
+
+// Longest selections read from a checkpoint, against a corrupt size
+const uint64_t maxSelectionSize = 1 << 20;
+
+/*! \brief Header at the start of a checkpoint file.
+ */
+struct CheckpointHeader {
+  char magic[8];          //!< Signature, io::checkpointMagic
+  uint32_t version = checkpointVersion; //!< Version of the format
+  int32_t nbin = 0;       //!< Number of bins of each histogram
+  int32_t ntypes = 1;     //!< Number of atom types
+  int32_t nframes = 0;    //!< Number of frames accumulated
+  double binsize = 0;     //!< Bin width
+  double cutoff = 0;      //!< Cutoff of the g(r)
+  double sumVolume = 0;   //!< Box volume summed over the frames
+  int64_t lastTimestep = -1; //!< Largest timestep accumulated
+  int64_t lastOffset = -1;   //!< Offset of that frame in its trajectory
+  uint64_t ncounts = 0;   //!< Number of summed particle counts
+  uint64_t nvalues = 0;   //!< Number of histogram values
+  uint64_t selectionSize = 0; //!< Length of the selections (0 unless atoms
+                              //!< are selected)
+};
+
+// Writes an accumulation state to a checkpoint file
+int writeCheckpoint(const std::string &filename, const rdf::RdfState &state);
+
+// Reads an accumulation state from a checkpoint file
+int readCheckpoint(const std::string &filename, rdf::RdfState *state);
+
+} // namespace io
+
+#endif // __CHECKPOINT_H_
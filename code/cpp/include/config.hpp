@@ -0,0 +1,181 @@
+#ifndef __CONFIG_H_
+#define __CONFIG_H_
+
+#include <array>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Internal
+#include <analysis.hpp>
+#include <inputOutput.hpp>
+#include <rdf.hpp>
+#include <selection.hpp>
+#include <structure.hpp>
+
+/*! \file config.hpp
+    \brief This header file contains the run settings of runYoda, read from
+   a configuration file and the command line.
+
+    Details.
+*/
+
+/*!
+ *  \addtogroup io
+ *  @{
+ */
+
+/*! \brief Run settings of runYoda, from a configuration file and the command
+ line.
+ *
+ Every setting has a default (the values in io::RunConfig), which a
+ configuration file can change, and the command line can change again:
+
+ \code
+ runYoda [trajectory [checkpoint]] [--config file] [--key value ...]
+         [--analysis "name;key=value;..."]
+ \endcode
+
+ A configuration file holds one "key = value" per line, with # starting a
+ comment. The keys are the names of the members of io::RunConfig (e.g.
+ numCalcSteps, cutoff or outputDir). On the command line, every key is given as
+ --key value (or --key=value).
+
+ A run can evaluate several \f$g(r)\f$ analyses (see rdf::AnalysisSet) in a
+ single pass over the trajectory. In a configuration file, every analysis is a
+ section, which starts with a line "[analysis name]" and is followed by its own
+ binsize, cutoff, partialRdf, singlePrecision, reference and target keys. On
+ the command line, an analysis is given as
+ --analysis "name;cutoff=8;reference=type 2". Any key an analysis does not set
+ is taken from the global settings, wherever in the file or on the command line
+ they are. Without any analyses, there is a single one, called rdf, with the
+ global settings.
+
+ The analysis called rdf writes rdf.dat (and cn.dat and sq.dat), and any other
+ analysis, say ions, writes ions.dat (and ions_cn.dat and ions_sq.dat), all in
+ outputDir. With a checkpoint file and several analyses, every analysis has
+ its own checkpoint, named after the checkpoint file and the analysis (e.g.
+ run.ckp.ions).
+
+ With npyOutput set, every table is also written as a NumPy array of float64
+ with the same columns, e.g. rdf.npy next to rdf.dat. All output files are
+ written to a temporary file first, which is then renamed.
+
+ With windowFrames set, the g(r) of every window of windowFrames consecutive
+ selected frames, starting every windowStride frames, is also written to
+ windows.bin (or name_windows.bin) in outputDir (see rdf::WindowStats and
+ io::WindowWriter), in the same pass over the trajectory.
+
+ In batch mode (see batch::run), the trajectories listed in the file given by
+ batch are analysed together, and the output files of each are written to a
+ directory of outputDir named after the trajectory.
+ */
+
+namespace io {
+
+/*! \brief Keys and values of an analysis, as read in.
+ */
+struct AnalysisOptions {
+  std::string name; //!< Name of the analysis
+  std::vector<std::array<std::string, 2>> options; //!< Keys and values
+};
+
+/*! \brief Run settings of runYoda (see the defaults below).
+ */
+struct RunConfig {
+  std::string trajectory = "./../../data/liq-mW"; //!< Trajectory ("-" for
+                                                  //!< stdin; .gz or .zst
+                                                  //!< are decompressed)
+  // All steps start from 1, and are the number, not the actual timestep value
+  int numCalcSteps = 10; //!< Number of steps for which to do the calculation
+  int stepGap = 1;       //!< Gap between steps
+  int equiliSteps = 1;   //!< Number of steps to skip (last frame exclusive)
+  bool selectByTimestep = false; //!< Use the timestep range below instead
+  long long firstTimestep = 0;   //!< First timestep to be processed
+  long long lastTimestep = -1;   //!< Last timestep to be processed (-1: no
+                                 //!< end)
+  long long timestepStride = 1;  //!< Gap between timesteps to be processed
+  rdf::Analysis defaults; //!< binsize, cutoff, partialRdf, singlePrecision,
+                          //!< reference and target of every analysis, unless
+                          //!< it sets them
+  std::vector<AnalysisOptions> analyses; //!< Analyses; none for a single one
+                                         //!< with the global settings
+  int nComputeWorkers = 1; //!< Threads accumulating frames (each may use
+                           //!< OpenMP)
+  int nFrameBuffers = 4;   //!< Frames held in memory at once
+  std::string checkpoint = ""; //!< Checkpoint file; empty for none
+  int checkpointEvery = 100;   //!< Frames between checkpoints
+  bool resume = true; //!< Carry on from the checkpoint file, if it exists
+  int blockFrames = 0; //!< Frames per block for error bars (0 for none)
+  double errorThreshold = 0; //!< Stop once the largest standard error of the
+                             //!< g(r) is below this (0 to never stop early)
+  int minBlocks = 5;         //!< Blocks needed before stopping early (at
+                             //!< least 2)
+  int windowFrames = 0; //!< Frames per window of the time-resolved g(r) (0
+                        //!< for none)
+  int windowStride = 0; //!< Frames between the starts of windows (0 for
+                        //!< windows which do not overlap)
+  bool coordination = false; //!< Write the running coordination numbers
+  double qMax = 0;     //!< Largest q of the structure factor (0 for none)
+  double qStep = 0.05; //!< Spacing of the q grid, in inverse Angstroms
+  std::string outputDir = "../../output"; //!< Directory of the output files
+  bool npyOutput = false; //!< Also write the tables as NumPy .npy files
+  std::string batch = ""; //!< File listing trajectories to be analysed in
+                          //!< batch mode; empty for a single trajectory
+  int batchWorkers = 0;   //!< Threads of batch mode (0 for one per core)
+  int batchChunk = 8;     //!< Frames per task of batch mode
+  int maxReaders = 2;     //!< Threads of batch mode reading at once
+  std::string traceFile = ""; //!< Trace-event file (with use_Profiling)
+  bool help = false;          //!< Only print the usage
+};
+
+// Sets a global setting (or a default of the analyses) from its key
+int setOption(RunConfig *config, const std::string &key,
+              const std::string &value);
+
+// Sets a setting of an analysis from its key
+int setAnalysisOption(rdf::Analysis *analysis, const std::string &key,
+                      const std::string &value);
+
+// Reads the settings of a configuration file
+int readConfigFile(const std::string &filename, RunConfig *config);
+
+// Reads the settings of the command line (and its configuration files)
+int parseArguments(int argc, char *argv[], RunConfig *config);
+
+// Gets the settings of every analysis of a run
+int resolveAnalyses(const RunConfig &config,
+                    std::vector<rdf::Analysis> *analyses);
+
+// Prints the usage of runYoda
+void printUsage(std::ostream &out, const std::string &program);
+
+// Writes the g(r) of an analysis, and the quantities derived from it
+int writeResults(const RunConfig &config, const std::string &name,
+                 const rdf::RdfState &state, const rdf::BlockStats &blocks,
+                 const std::string &outputDir);
+
+// --------------------------------------------
+// INLINE FUNCTIONS
+
+/********************************************/ /**
+ *  Function for getting the name of an output file of an analysis. The
+ analysis called rdf keeps the plain names (e.g. cn.dat); the others are
+ prefixed with their names (e.g. ions_cn.dat).
+ *  @param[in] analysis The name of the analysis
+ *  @param[in] quantity The quantity in the file, e.g. "cn"
+ *  @param[in] extension (Optional argument) The extension of the file
+ ***********************************************/
+inline std::string outputName(const std::string &analysis,
+                              const std::string &quantity,
+                              const std::string &extension = ".dat") {
+  if (analysis == "rdf") {
+    return quantity + extension;
+  }
+  return analysis + "_" + quantity + extension;
+}
+
+} // namespace io
+
+#endif // __CONFIG_H_
@@ -1,28 +1,125 @@
 #ifndef __GENERIC_H_
 #define __GENERIC_H_
 
-#include <math.h>  
+#include <math.h>
+#include <stdlib.h>
 #include <array>
-#include <vector> 
+#include <new>
+#include <vector>
 
 namespace gen{
 
-	// Generic function for getting the unwrapped distance
-  inline double periodicDist(std::vector< std::vector<double> > coord, std::vector<double> box, int iatom, int jatom){
-    int dim = coord[0].size(); // Number of dimensions
-    std::vector<double> dr;
-    double r2 = 0.0; // Squared absolute distance
+  // Alignment of the coordinate arrays (one cache line, enough for AVX-512)
+  const std::size_t frameAlignment = 64;
+
+  /*! \brief Allocator returning memory aligned to gen::frameAlignment bytes.
+   *
+   Used for the coordinate arrays of gen::Frame, so that vector loads in the
+   pair loop start on a cache line boundary.
+   */
+  template <typename T>
+  struct AlignedAllocator {
+    typedef T value_type;
+
+    AlignedAllocator() noexcept {}
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U> &) noexcept {}
+
+    T *allocate(std::size_t n) {
+      // aligned_alloc needs a size which is a multiple of the alignment
+      std::size_t bytes = n * sizeof(T);
+      bytes = ((bytes + frameAlignment - 1) / frameAlignment) * frameAlignment;
+      void *ptr = aligned_alloc(frameAlignment, bytes);
+      if (ptr == nullptr) {
+        throw std::bad_alloc();
+      }
+      return static_cast<T *>(ptr);
+    }
+
+    void deallocate(T *ptr, std::size_t) noexcept { free(ptr); }
+  };
+
+  template <typename T, typename U>
+  bool operator==(const AlignedAllocator<T> &, const AlignedAllocator<U> &) {
+    return true;
+  }
+  template <typename T, typename U>
+  bool operator!=(const AlignedAllocator<T> &, const AlignedAllocator<U> &) {
+    return false;
+  }
 
-    dr.resize(dim); // Resize 
+  // Contiguous, aligned array of doubles
+  typedef std::vector<double, AlignedAllocator<double>> alignedVector;
+  // Contiguous, aligned array of floats
+  typedef std::vector<float, AlignedAllocator<float>> alignedFloatVector;
+
+  /*! \brief Structure-of-arrays holding a single frame of a trajectory.
+   *
+   The x, y and z coordinates are kept in separate contiguous arrays, so that
+   the pair loop reads them with unit stride. A frame is meant to be reused:
+   resize() only reallocates when a frame has more particles than any frame
+   read before it.
+
+   A triclinic box is described as in lammps: box holds the lengths lx, ly and
+   lz, and tilt the tilt factors xy, xz and yz, so that the cell vectors are
+   (lx, 0, 0), (xy, ly, 0) and (xz, yz, lz). All the tilt factors are zero for
+   an orthorhombic box.
+   */
+  struct Frame {
+    int nop = 0; //!< Total number of particles in the box
+    long long timestep = 0; //!< Timestep value written in the trajectory
+    std::array<double, 3> boxLo = {{0, 0, 0}}; //!< Lower box bounds
+    std::array<double, 3> box = {{0, 0, 0}}; //!< Box lengths
+    std::array<double, 3> tilt = {{0, 0, 0}}; //!< Tilt factors xy, xz and yz
+    alignedVector x, y, z; //!< Coordinates of the particles
+    std::vector<int> id; //!< Atom IDs
+    std::vector<int> type; //!< Atom types
+
+    // Changes the number of particles, keeping the allocated memory
+    void resize(int n) {
+      nop = n;
+      x.resize(n);
+      y.resize(n);
+      z.resize(n);
+      id.resize(n);
+      type.resize(n);
+    }
+
+    // Box volume (the tilt factors do not change it)
+    double volume() const { return box[0] * box[1] * box[2]; }
+
+    // True if any tilt factor is non-zero
+    bool isTriclinic() const {
+      return tilt[0] != 0 || tilt[1] != 0 || tilt[2] != 0;
+    }
+  };
+
+	// Generic function for getting the unwrapped distance
+  inline double periodicDist(const Frame &frame, int iatom, int jatom){
+    const double *coord[3] = {frame.x.data(), frame.y.data(), frame.z.data()};
+    double dr[3];      // Relative distance along each dimension
+    double shift;      // Number of box vectors to shift by
+    double r2 = 0.0;   // Squared absolute distance
 
+    // Get the relative distance
+    for (int k = 0; k < 3; k++) {
+      dr[k] = coord[k][iatom]-coord[k][jatom];
+    }
+    // Correct for periodicity, along the c, b and a box vectors in turn
+    for (int k = 2; k >= 0; k--) {
+      shift = round(dr[k] / frame.box[k]);
+      dr[k] -= frame.box[k] * shift;
+      if (k == 2) {
+        dr[0] -= frame.tilt[1] * shift;
+        dr[1] -= frame.tilt[2] * shift;
+      } else if (k == 1) {
+        dr[0] -= frame.tilt[0] * shift;
+      }
+    }
     // Get the squared absolute distance
-      for (int k = 0; k < dim; k++) {
-        // Get the relative distance
-        dr[k] = fabs(coord[iatom][k]-coord[jatom][k]);
-        // Correct for periodicity
-        dr[k] -= box[k] * round(dr[k] / box[k]);
-        r2 += pow(dr[k], 2.0);
-      } 
+    for (int k = 0; k < 3; k++) {
+      r2 += pow(dr[k], 2.0);
+    }
 
     return sqrt(r2);
   }
@@ -1,9 +1,13 @@
 #ifndef __INPUTOUTPUT_H_
 #define __INPUTOUTPUT_H_
 
+#include <stdio.h>
+#include <stdlib.h>
 #include <sys/stat.h>
+#include <unistd.h>
 #include <algorithm>
 #include <array>
+#include <charconv>
 #include <fstream>
 #include <iostream>
 #include <iterator>
@@ -16,6 +20,10 @@
 #include "boost/filesystem/operations.hpp"
 #include "boost/filesystem/path.hpp"
 
+// Internal
+#include <generic.hpp>
+#include <mmapReader.hpp>
+
 /*! \file inputOutput.hpp
     \brief This header file contains functions for I/O.
 
@@ -39,6 +47,61 @@
 
 namespace io {
 
+/*! \brief Entry of the frame index of a lammps trajectory file.
+ *
+ Holds where a frame starts in the file and everything in its header, so that
+ frames can be selected and seeked to without going through the file again.
+ */
+struct FrameIndexEntry {
+  std::streamoff offset = 0; //!< Byte offset of the "ITEM: TIMESTEP" line
+  long long timestep = 0; //!< Timestep value of the frame
+  int nop = 0; //!< Number of atoms in the frame
+  std::array<double, 3> boxLo = {{0, 0, 0}}; //!< Lower box bounds
+  std::array<double, 3> box = {{0, 0, 0}}; //!< Box lengths
+  std::array<double, 3> tilt = {{0, 0, 0}}; //!< Tilt factors xy, xz and yz
+};
+
+/*! \brief Selection of the frames of a trajectory to be analysed.
+ *
+ Frames are selected either by their number (starting from 1), or by their
+ timestep value. By number, frames firstFrame, firstFrame + frameStride, ...
+ are selected. By timestep, the frames whose timesteps lie between
+ firstTimestep and lastTimestep, and are a whole number of timestepStride after
+ firstTimestep, are selected. In both cases, at most maxFrames frames are
+ selected. Neither needs the total number of frames, so the same selection is
+ used for streamed trajectories.
+ */
+struct FrameSelection {
+  bool byTimestep = false; //!< Select by timestep rather than frame number
+  int firstFrame = 1;      //!< First frame selected (starting from 1)
+  int frameStride = 1;     //!< Gap between the selected frames
+  long long firstTimestep = 0;  //!< First timestep selected
+  long long lastTimestep = -1;  //!< Last timestep selected; -1 for no limit
+  long long timestepStride = 1; //!< Gap between the selected timesteps
+  int maxFrames = -1; //!< Maximum number of frames selected; -1 for no limit
+
+  // Whether frame iframe (starting from 1), with the given timestep, is
+  // selected
+  bool selects(int iframe, long long timestep) const {
+    if (byTimestep) {
+      return (timestep >= firstTimestep &&
+              (lastTimestep < 0 || timestep <= lastTimestep) &&
+              (timestep - firstTimestep) % timestepStride == 0);
+    }
+    return (iframe >= firstFrame && (iframe - firstFrame) % frameStride == 0);
+  }
+  // Whether no frame after this one can be selected (timesteps increase
+  // through a trajectory)
+  bool isPast(long long timestep) const {
+    return (byTimestep && lastTimestep >= 0 && timestep > lastTimestep);
+  }
+  // Whether the strides and first frame are sensible
+  bool isValid() const {
+    return (firstFrame >= 1 && frameStride >= 1 && timestepStride >= 1 &&
+            maxFrames != 0);
+  }
+};
+
 // --------------------------------------------
 // INLINE FUNCTIONS
 
@@ -53,6 +116,18 @@ inline bool file_exists(const std::string &name) {
   return (stat(name.c_str(), &buffer) == 0);
 }
 
+/********************************************/ /**
+                                                *  Function for getting the
+                                                *path of the sidecar file
+                                                *holding the frame index of a
+                                                *trajectory.
+                                                *  @param[in] filename The path
+                                                *of the trajectory file
+                                                ***********************************************/
+inline std::string frameIndexPath(const std::string &filename) {
+  return filename + ".idx";
+}
+
 /********************************************/ /**
                                                 *  Function for tokenizing line
                                                 *strings into words (strings)
@@ -90,12 +165,51 @@ inline std::vector<double> tokenizerDouble(std::string line) {
 
 // --------------------------------------------
 
-// Gets the total number of timesteps in a lammps trajectory file
-int getTotalTimesteps(std::string filename, int *totalSteps);
+// Builds the frame index of a lammps trajectory file in a single pass
+int buildFrameIndex(std::string filename,
+                    std::vector<FrameIndexEntry> *frameIndex);
+
+// Reads the frame index of a trajectory from its sidecar file, if up to date
+int readFrameIndex(std::string filename,
+                   std::vector<FrameIndexEntry> *frameIndex);
+
+// Writes the frame index of a trajectory to its sidecar file
+int writeFrameIndex(std::string filename,
+                    const std::vector<FrameIndexEntry> &frameIndex);
+
+// Gets the frame index from the sidecar file, or builds and saves it
+int getFrameIndex(std::string filename,
+                  std::vector<FrameIndexEntry> *frameIndex);
+
+// Gets the (0-based) frames of an indexed trajectory which are selected
+std::vector<int> selectFrames(const std::vector<FrameIndexEntry> &frameIndex,
+                              const FrameSelection &selection);
 
 // Write out the RDF to an output file
 int writeRDF(double *rdfArray, double binsize, int nbin,
-             std::string filename = "rdf.dat");
+             std::string filename = "rdf.dat", int ntypes = 1,
+             const double *rdfError = nullptr,
+             const std::string &outputDir = "../../output");
+
+// Write out a quantity derived from the RDF, one column per pair of types
+int writeColumns(const double *values, const std::vector<double> &x,
+                 std::string xName, std::string name, std::string filename,
+                 int ntypes = 1,
+                 const std::string &outputDir = "../../output");
+
+// Appends a number to a text buffer, in its shortest round-trip form
+void appendNumber(double value, std::string *buffer);
+
+// Gets the path of an output file, creating the output directory if needed
+int outputPath(const std::string &outputDir, const std::string &filename,
+               std::string *path);
+
+// Writes a buffer to a file through a temporary file, which is then renamed
+int writeFileAtomic(const std::string &path, const char *data, size_t size);
+
+// Writes a table of numbers as text, or as a NumPy array for a .npy file
+int writeTable(const std::string &path, const std::string &header,
+               const std::vector<double> &table, int ncolumns);
 
 }  // namespace io
 
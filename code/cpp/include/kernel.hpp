@@ -0,0 +1,205 @@
+#ifndef __KERNEL_H_
+#define __KERNEL_H_
+
+#include <math.h>
+#include <stdint.h>
+#include <algorithm>
+#include <array>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+/*! \file kernel.hpp
+    \brief This header file contains the vectorized distance-and-binning
+   kernel of the \f$g(r)\f$ pair loop.
+
+    Details.
+*/
+
+/*!
+ *  \addtogroup rdf
+ *  @{
+ */
+
+/*! \brief Distance-and-binning kernel for 3D periodic boxes.
+ *
+ The kernel bins the distances between one particle and a contiguous range of
+ particles, held in structure-of-arrays form. Depending on the instruction set
+ the code is compiled for, 8 (AVX-512), 4 (AVX2) or 1 (scalar) particles are
+ handled at a time; use the use_SIMD CMake option to compile for the host CPU.
+
+ The squared distances are first compared against a slightly enlarged squared
+ cutoff, so that the square root is only taken for pairs which may be within
+ the cutoff. The bins of the surviving lanes are then incremented one lane at
+ a time, which cannot conflict even when several lanes fall in the same bin.
+ The histograms are integer pair counts, so every pair adds one to a 64-bit
+ integer; the factor of two (each pair is seen from both of its particles) is
+ only applied during normalization.
+ For partial \f$g(r)\f$s, each lane is binned into the histogram of the type
+ pair it belongs to, found from a per-row table of histogram offsets.
+
+ Every vector operation rounds exactly like its scalar counterpart (including
+ round(), which rounds halves away from zero), and the kernel is compiled
+ without floating-point contraction, so all code paths give identical
+ histograms.
+
+ Triclinic boxes are handled by rdf::binRowTriclinic, which works on
+ fractional coordinates (see rdf::CellMatrix). The minimum image is found by
+ rounding the fractional separations, without any division, and the separations
+ are turned back into distances by the (upper-triangular) cell matrix. This
+ gives the true minimum image distance of every pair closer than half the
+ smallest perpendicular width of the box, which the cutoff must not exceed.
+ The squared distances of a block of particles are found first, in a loop
+ without branches which the compiler vectorizes, and only then binned.
+
+ Both kernels also come in a single-precision variant (rdf::binRowFloat, and
+ rdf::binRowTriclinic on floats), which reads float coordinates and finds the
+ separations and squared distances in float, with twice as many lanes per
+ vector register. Only the square root, the cutoff test and the bin are
+ evaluated in double, so the bins are assigned exactly as in double precision
+ for the float distances. The pre-filter on the squared cutoff is enlarged to
+ float rounding, so it never drops a pair the double test would keep.
+ */
+
+namespace rdf {
+
+/*! \brief Cell matrix of a triclinic box, and its inverse.
+ *
+ The cell vectors a = (lx, 0, 0), b = (xy, ly, 0) and c = (xz, yz, lz) are the
+ columns of the upper-triangular cell matrix h. The fractional coordinates of a
+ position r are \f$s = h^{-1} r\f$, and the inverse is upper triangular too.
+ */
+struct CellMatrix {
+  std::array<double, 6> h;    //!< lx, ly, lz, xy, xz and yz
+  std::array<double, 6> hInv; //!< The same elements of the inverse matrix
+};
+
+// Bins the distances between one particle and a range of particles
+void binRow(double xi, double yi, double zi, const double *x, const double *y,
+            const double *z, const int *jType, const int *rowOffset,
+            int jBegin, int jEnd,
+            const std::array<double, 3> &box, double cutoff, double binsize,
+            uint64_t *rdfArray);
+
+// Bins the distances between one particle and a range of particles, with
+// float coordinates
+void binRowFloat(float xi, float yi, float zi, const float *x, const float *y,
+                 const float *z, const int *jType, const int *rowOffset,
+                 int jBegin, int jEnd, const std::array<double, 3> &box,
+                 double cutoff, double binsize, uint64_t *rdfArray);
+
+// Bins the distances between one particle and a range of particles, in
+// fractional coordinates of a triclinic box (double or float)
+template <typename T>
+void binRowTriclinic(T sxi, T syi, T szi, const T *sx, const T *sy,
+                     const T *sz, const int *jType, const int *rowOffset,
+                     int jBegin, int jEnd, const CellMatrix &cell,
+                     double cutoff, double binsize, uint64_t *rdfArray);
+
+// --------------------------------------------
+// INLINE FUNCTIONS
+
+/********************************************/ /**
+ *  Function for getting the cell matrix of a box, and its inverse.
+ *  @param[in] box The box lengths lx, ly and lz
+ *  @param[in] tilt The tilt factors xy, xz and yz
+ ***********************************************/
+inline CellMatrix cellMatrix(const std::array<double, 3> &box,
+                             const std::array<double, 3> &tilt) {
+  CellMatrix cell; // Cell matrix and its inverse
+
+  cell.h = {{box[0], box[1], box[2], tilt[0], tilt[1], tilt[2]}};
+  cell.hInv[0] = 1.0 / box[0];
+  cell.hInv[1] = 1.0 / box[1];
+  cell.hInv[2] = 1.0 / box[2];
+  cell.hInv[3] = -tilt[0] / (box[0] * box[1]);
+  cell.hInv[4] = (tilt[0] * tilt[2] - box[1] * tilt[1]) /
+                 (box[0] * box[1] * box[2]);
+  cell.hInv[5] = -tilt[2] / (box[1] * box[2]);
+  return cell;
+}
+
+/********************************************/ /**
+ *  Function for getting the fractional coordinates of a position.
+ *  @param[in] cell The cell matrix
+ *  @param[in] x The x coordinate
+ *  @param[in] y The y coordinate
+ *  @param[in] z The z coordinate
+ *  @param[out] s The fractional coordinates along a, b and c
+ ***********************************************/
+inline void toFractional(const CellMatrix &cell, double x, double y, double z,
+                         double *s) {
+  s[0] = cell.hInv[0] * x + cell.hInv[3] * y + cell.hInv[4] * z;
+  s[1] = cell.hInv[1] * y + cell.hInv[5] * z;
+  s[2] = cell.hInv[2] * z;
+}
+
+/********************************************/ /**
+ *  Function for binning the distance between two particles, exactly as the
+ original pair loop did. As in rdf::binRow, pairs whose squared distance is
+ beyond the (slightly enlarged) squared cutoff are dropped before taking the
+ square root.
+ *  @param[in] dx The x distance between the particles
+ *  @param[in] dy The y distance between the particles
+ *  @param[in] dz The z distance between the particles
+ *  @param[in] box The simulation box lengths
+ *  @param[in] cutoff The cutoff of the \f$g(r)\f$
+ *  @param[in] binsize The bin width
+ *  @param[in] rdfArray The histogram
+ ***********************************************/
+inline void binPair(double dx, double dy, double dz,
+                    const std::array<double, 3> &box, double cutoff,
+                    double binsize, uint64_t *rdfArray) {
+  double r2;   // Squared distance between the particles
+  double r_ij; // Distance between the particles
+  // Apply PBCs
+  dx -= box[0] * round(dx / box[0]);
+  dy -= box[1] * round(dy / box[1]);
+  dz -= box[2] * round(dz / box[2]);
+  r2 = dx * dx + dy * dy + dz * dz;
+  if (r2 >= cutoff * cutoff * (1.0 + 1e-10)) {
+    return;
+  }
+  r_ij = sqrt(r2);
+  // Only add if r_ij is within the cutoff
+  if (r_ij < cutoff) {
+    rdfArray[(int)(r_ij / binsize)] += 1;
+  }
+}
+
+/********************************************/ /**
+ *  Function for binning the distance between two particles with float
+ separations. The minimum image is found in float, and the distance is binned
+ in double. Pairs beyond the enlarged squared cutoff of rdf::binRowFloat are
+ dropped before taking the square root.
+ *  @param[in] dx The x distance between the particles
+ *  @param[in] dy The y distance between the particles
+ *  @param[in] dz The z distance between the particles
+ *  @param[in] box The simulation box lengths, in float
+ *  @param[in] cutoff The cutoff of the \f$g(r)\f$
+ *  @param[in] binsize The bin width
+ *  @param[in] rdfArray The histogram
+ ***********************************************/
+inline void binPairFloat(float dx, float dy, float dz, const float *box,
+                         double cutoff, double binsize, uint64_t *rdfArray) {
+  float r2;    // Squared distance between the particles
+  double r_ij; // Distance between the particles
+  // Apply PBCs
+  dx -= box[0] * roundf(dx / box[0]);
+  dy -= box[1] * roundf(dy / box[1]);
+  dz -= box[2] * roundf(dz / box[2]);
+  r2 = dx * dx + dy * dy + dz * dz;
+  if (r2 >= (float)(cutoff * cutoff * (1.0 + 1e-5))) {
+    return;
+  }
+  r_ij = sqrt((double)r2);
+  // Only add if r_ij is within the cutoff
+  if (r_ij < cutoff) {
+    rdfArray[(int)(r_ij / binsize)] += 1;
+  }
+}
+
+} // namespace rdf
+
+#endif // __KERNEL_H_
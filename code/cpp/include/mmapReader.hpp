@@ -0,0 +1,141 @@
+#ifndef __MMAPREADER_H_
+#define __MMAPREADER_H_
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <iostream>
+#include <string>
+
+// Internal
+#include <generic.hpp>
+#include <profiler.hpp>
+
+/*! \file mmapReader.hpp
+    \brief This header file contains the zero-copy reader for lammps
+   trajectory files.
+
+    Details.
+*/
+
+/*!
+ *  \addtogroup io
+ *  @{
+ */
+
+namespace io {
+
+// Forward declaration (defined in inputOutput.hpp)
+struct FrameIndexEntry;
+
+/*! \brief Columns of the atom lines of a lammps trajectory file.
+ *
+ Found from the "ITEM: ATOMS id type x y z" line. A column which is not in the
+ file is -1.
+ */
+struct AtomColumns {
+  int id = -1;   //!< Column of the atom ID
+  int type = -1; //!< Column of the atom type
+  int x = -1;    //!< Column from which x y z starts
+  int last = -1; //!< Last column which must be parsed
+};
+
+/*! \brief Read-only memory map of a whole file.
+ *
+ The file is mapped once, and frames are parsed straight out of the mapped
+ pages, without copying lines into strings. The map is released when the
+ object goes out of scope.
+ */
+class MappedFile {
+public:
+  MappedFile() {}
+  ~MappedFile() { close(); }
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  // Maps a file; returns 0 (success) or 1 (error)
+  int open(const std::string &filename);
+  // Releases the map
+  void close();
+
+  const char *data() const { return data_; }   //!< Start of the file
+  std::size_t size() const { return size_; }   //!< Size of the file in bytes
+  const char *end() const { return data_ + size_; } //!< End of the file
+
+private:
+  const char *data_ = nullptr; // Start of the mapped file
+  std::size_t size_ = 0;       // Size of the mapped file
+};
+
+// --------------------------------------------
+// INLINE FUNCTIONS
+
+/********************************************/ /**
+ *  Function for getting the end of the line starting at ptr (the position of
+ its newline, or end).
+ *  @param[in] ptr The start of the line
+ *  @param[in] end The end of the buffer
+ ***********************************************/
+inline const char *lineEnd(const char *ptr, const char *end) {
+  const char *newline =
+      static_cast<const char *>(memchr(ptr, '\n', end - ptr));
+  return (newline == nullptr) ? end : newline;
+}
+
+/********************************************/ /**
+ *  Function for getting the start of the next line.
+ *  @param[in] ptr Any position inside the current line
+ *  @param[in] end The end of the buffer
+ ***********************************************/
+inline const char *nextLine(const char *ptr, const char *end) {
+  ptr = io::lineEnd(ptr, end);
+  return (ptr == end) ? end : ptr + 1;
+}
+
+/********************************************/ /**
+ *  Function for parsing a number in place, skipping leading blanks. This uses
+ std::from_chars, which is locale-independent, does not allocate, and rounds
+ exactly like strtod.
+ *  @param[in] ptr The position from which to parse
+ *  @param[in] end The end of the buffer
+ *  @param[out] value The number parsed
+ *  \return the position after the number, or nullptr if there was no number
+ ***********************************************/
+template <typename T>
+inline const char *parseNumber(const char *ptr, const char *end, T *value) {
+  // Skip blanks (and a leading plus, which from_chars rejects)
+  while (ptr < end && (*ptr == ' ' || *ptr == '\t' || *ptr == '\r')) {
+    ptr++;
+  }
+  if (ptr < end && *ptr == '+') {
+    ptr++;
+  }
+  std::from_chars_result result = std::from_chars(ptr, end, *value);
+  if (result.ec != std::errc()) {
+    return nullptr;
+  }
+  return result.ptr;
+}
+
+// --------------------------------------------
+
+// Parses the header of a frame, up to and including the ITEM: ATOMS line
+int parseFrameHeader(const char **cursor, const char *end,
+                     FrameIndexEntry *entry, AtomColumns *columns);
+
+// Parses the atom lines of a frame into a frame
+int parseAtoms(const char **cursor, const char *end,
+               const AtomColumns &columns, gen::Frame *frame);
+
+// Parses a whole frame, starting at its ITEM: TIMESTEP line
+int parseFrame(const char **cursor, const char *end, gen::Frame *frame);
+
+} // namespace io
+
+#endif // __MMAPREADER_H_
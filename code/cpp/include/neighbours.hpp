@@ -0,0 +1,192 @@
+#ifndef __NEIGHBOURS_H_
+#define __NEIGHBOURS_H_
+
+#include <math.h>
+#include <array>
+#include <vector>
+
+#include <generic.hpp>
+#include <kernel.hpp>
+#include <profiler.hpp>
+
+/*! \file neighbours.hpp
+    \brief This header file contains the linked-cell neighbour search.
+
+    Details.
+*/
+
+/*!
+ *  \addtogroup nlist
+ *  @{
+ */
+
+/*! \brief Linked-cell (binned-box) neighbour search.
+ *
+ The simulation box is divided into cells whose edge is at least as long as the
+ cutoff. Every particle can then only have neighbours within the cutoff inside
+ its own cell or one of the 26 cells surrounding it. This is the linked-cell
+ scheme described in Allen and Tildesley. Instead of linked lists, however, the
+ particles are sorted by cell (with a counting sort), and copies of their
+ coordinates are kept in that order. The particles of a cell are then a
+ contiguous range, which the vectorized kernel (see rdf::binRow) reads with
+ unit stride.
+
+ Visiting only the neighbouring cells makes the cost of going through all the
+ pairs within the cutoff scale as \f$O(N)\f$ for a fixed density and cutoff,
+ instead of \f$O(N^2)\f$.
+
+ For a triclinic box, the cells are slices of the box along its cell vectors,
+ and the particles are binned by their fractional coordinates (which are the
+ coordinates kept in the cell list). The number of cells along each cell vector
+ is then set by the perpendicular width of the box (see nlist::boxWidths), so
+ that the cells are at least as thick as the cutoff. At least three cells are
+ needed along every dimension, so that the 27 cells surrounding a particle are
+ all distinct and no pair is counted twice.
+ */
+
+namespace nlist {
+
+/*! \brief The cell list of a frame, with the particles sorted by cell.
+ */
+struct CellList {
+  std::array<int, 3> ncell; //!< Number of cells along each dimension
+  std::array<double, 3> cellWidth; //!< Width of a cell along each dimension
+                                   //!< (perpendicular width if triclinic)
+  std::vector<int> cellStart; //!< First sorted particle of each cell, and the
+                              //!< total number of particles at the end
+  std::vector<int> atoms; //!< Index in the frame of each sorted particle
+  bool singlePrecision = false; //!< Keep float copies of the coordinates
+                                //!< (xf, yf and zf) instead of x, y and z
+  gen::alignedVector x, y, z; //!< Coordinates of the sorted particles
+                              //!< (fractional if the box is triclinic)
+  gen::alignedFloatVector xf, yf, zf; //!< Coordinates of the sorted particles
+                                      //!< in float, wrapped into the box
+  std::vector<int> type; //!< Atom types of the sorted particles
+  std::vector<int> cellOf; //!< Cell of each particle (in frame order)
+
+  // Total number of cells
+  int size() const { return cellStart.size() - 1; }
+};
+
+// --------------------------------------------
+// INLINE FUNCTIONS
+
+/********************************************/ /**
+ *  Function for getting the number of cells along each dimension for a given
+ box and cutoff. The cell width is never smaller than the cutoff.
+ *  @param[in] box The simulation box lengths (or perpendicular widths)
+ *  @param[in] cutoff The cutoff distance
+ ***********************************************/
+inline std::array<int, 3> numberOfCells(const std::array<double, 3> &box,
+                                        double cutoff) {
+  std::array<int, 3> ncell = {{0, 0, 0}};
+  for (int k = 0; k < 3; k++) {
+    ncell[k] = (int)(box[k] / cutoff);
+  }
+  return ncell;
+}
+
+/********************************************/ /**
+ *  Function for getting the perpendicular widths of the box of a frame, i.e.
+ the distances between its opposite faces. For an orthorhombic box these are
+ the box lengths.
+ *  @param[in] frame The frame, holding the box lengths and tilt factors
+ ***********************************************/
+inline std::array<double, 3> boxWidths(const gen::Frame &frame) {
+  if (!frame.isTriclinic()) {
+    return frame.box;
+  }
+  double lx = frame.box[0], ly = frame.box[1], lz = frame.box[2]; // Lengths
+  double xy = frame.tilt[0], xz = frame.tilt[1], yz = frame.tilt[2]; // Tilts
+  double volume = frame.volume(); // Box volume
+  std::array<double, 3> widths;   // Perpendicular widths
+
+  // The volume divided by the area of the face spanned by the other two
+  // cell vectors
+  widths[0] = volume / sqrt(ly * lz * ly * lz + xy * lz * xy * lz +
+                            (xy * yz - ly * xz) * (xy * yz - ly * xz));
+  widths[1] = volume / (lx * sqrt(lz * lz + yz * yz));
+  widths[2] = lz;
+  return widths;
+}
+
+/********************************************/ /**
+ *  Function for checking whether a cell list can be used for a box and cutoff.
+ This requires at least three cells along every dimension.
+ *  @param[in] box The simulation box lengths (or perpendicular widths, see
+ nlist::boxWidths)
+ *  @param[in] cutoff The cutoff distance
+ ***********************************************/
+inline bool isUsable(const std::array<double, 3> &box, double cutoff) {
+  if (cutoff <= 0) {
+    return false;
+  }
+  std::array<int, 3> ncell = nlist::numberOfCells(box, cutoff);
+  return (ncell[0] >= 3 && ncell[1] >= 3 && ncell[2] >= 3);
+}
+
+/********************************************/ /**
+ *  Function for getting the flattened index of a cell from its 3D indices. The
+ indices are wrapped back into the box, so that neighbouring cells across the
+ periodic boundaries can be addressed directly.
+ *  @param[in] cells The cell list
+ *  @param[in] ix The cell index along x
+ *  @param[in] iy The cell index along y
+ *  @param[in] iz The cell index along z
+ ***********************************************/
+inline int cellIndex(const CellList &cells, int ix, int iy, int iz) {
+  ix = (ix + cells.ncell[0]) % cells.ncell[0];
+  iy = (iy + cells.ncell[1]) % cells.ncell[1];
+  iz = (iz + cells.ncell[2]) % cells.ncell[2];
+  return (iz * cells.ncell[1] + iy) * cells.ncell[0] + ix;
+}
+
+/********************************************/ /**
+ *  Function for getting the 3D index of the cell in which a point lies. The
+ point is wrapped back into the box first, and the cells are measured from the
+ lower bounds of the box (along the cell vectors, if it is triclinic).
+ *  @param[in] cells The cell list, whose numbers and widths of cells are used
+ *  @param[in] frame The frame, holding the box
+ *  @param[in] cell The cell matrix of the box (only used if it is triclinic)
+ *  @param[in] x The x coordinate of the point
+ *  @param[in] y The y coordinate of the point
+ *  @param[in] z The z coordinate of the point
+ ***********************************************/
+inline std::array<int, 3> cellCoordinates(const CellList &cells,
+                                          const gen::Frame &frame,
+                                          const rdf::CellMatrix &cell,
+                                          double x, double y, double z) {
+  // Position from the lower bounds of the box
+  double r[3] = {x - frame.boxLo[0], y - frame.boxLo[1], z - frame.boxLo[2]};
+  double pos; // Wrapped coordinate of the point
+  std::array<int, 3> cellIdx; // 3D index of the cell
+
+  if (frame.isTriclinic()) {
+    rdf::toFractional(cell, r[0], r[1], r[2], r);
+  }
+  for (int k = 0; k < 3; k++) {
+    if (frame.isTriclinic()) {
+      // Wrap the fractional coordinate back into [0, 1)
+      pos = r[k] - floor(r[k]);
+      cellIdx[k] = (int)(pos * cells.ncell[k]);
+    } else {
+      // Wrap the coordinate back into [0, box)
+      pos = r[k] - frame.box[k] * floor(r[k] / frame.box[k]);
+      cellIdx[k] = (int)(pos / cells.cellWidth[k]);
+    }
+    // Guard against rounding at the upper edge of the box
+    if (cellIdx[k] >= cells.ncell[k]) {
+      cellIdx[k] = cells.ncell[k] - 1;
+    }
+  }
+  return cellIdx;
+}
+
+// --------------------------------------------
+
+// Builds the linked-cell list for the particles of a frame
+int buildCellList(CellList *cells, const gen::Frame &frame, double cutoff);
+
+}  // namespace nlist
+
+#endif  // __NEIGHBOURS_H_
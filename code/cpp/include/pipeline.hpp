@@ -0,0 +1,142 @@
+#ifndef __PIPELINE_H_
+#define __PIPELINE_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Internal
+#include <generic.hpp>
+
+/*! \file pipeline.hpp
+    \brief This header file contains the pipeline overlapping frame reading
+   with the \f$g(r)\f$ accumulation.
+
+    Details.
+*/
+
+/*!
+ *  \addtogroup pipeline
+ *  @{
+ */
+
+/*! \brief Producer/consumer pipeline for reading and processing frames.
+ *
+ A reader thread reads frames into a fixed pool of reusable frame buffers,
+ while compute workers process the frames which have been read. Free buffers
+ and filled buffers are passed around through two bounded queues. When all
+ buffers are filled, the reader waits for a worker to hand one back, so memory
+ stays bounded and the wall time approaches the larger of the I/O and compute
+ times, rather than their sum.
+
+ For batches of independent tasks of uneven cost (e.g. chunks of frames of
+ many trajectories), pipeline::runStealing runs the tasks on a pool of workers
+ with work stealing, and a pipeline::Semaphore caps how many of them read at
+ once.
+ */
+
+namespace pipeline {
+
+/*! \brief Thread-safe bounded FIFO queue.
+ *
+ push() blocks while the queue is full, and pop() blocks while it is empty.
+ Once the queue has been closed, pop() returns false as soon as it is empty.
+ */
+template <typename T> class BoundedQueue {
+public:
+  explicit BoundedQueue(std::size_t capacity) : capacity_(capacity) {}
+
+  // Adds an item, waiting while the queue is full
+  void push(T item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    notFull_.wait(lock, [this] { return items_.size() < capacity_; });
+    items_.push_back(std::move(item));
+    notEmpty_.notify_one();
+  }
+
+  // Removes the oldest item, waiting while the queue is empty; returns false
+  // if the queue is empty and closed
+  bool pop(T *item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    notEmpty_.wait(lock, [this] { return !items_.empty() || closed_; });
+    if (items_.empty()) {
+      return false;
+    }
+    *item = std::move(items_.front());
+    items_.pop_front();
+    notFull_.notify_one();
+    return true;
+  }
+
+  // No more items will be pushed; wakes up every waiting pop()
+  void close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    notEmpty_.notify_all();
+  }
+
+private:
+  std::size_t capacity_;             // Maximum number of items
+  std::deque<T> items_;              // Items in the queue
+  bool closed_ = false;              // true once close() has been called
+  std::mutex mutex_;                 // Guards everything above
+  std::condition_variable notFull_;  // Signalled when an item is removed
+  std::condition_variable notEmpty_; // Signalled when an item is added
+};
+
+/*! \brief Counting semaphore.
+ *
+ At most count threads hold the semaphore at once; acquire() blocks until one
+ of them releases it.
+ */
+class Semaphore {
+public:
+  explicit Semaphore(int count) : count_(count) {}
+
+  // Takes one of the slots, waiting until one is free
+  void acquire() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    free_.wait(lock, [this] { return count_ > 0; });
+    count_--;
+  }
+
+  // Hands a slot back
+  void release() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    count_++;
+    free_.notify_one();
+  }
+
+private:
+  int count_;                    // Free slots
+  std::mutex mutex_;             // Guards count_
+  std::condition_variable free_; // Signalled when a slot is handed back
+};
+
+// Reads in the frame with the given (0-based) task number into a buffer;
+// returns 0 (success), 1 (error) or -1 (no frames left)
+typedef std::function<int(int itask, gen::Frame *frame)> FrameReader;
+// Processes a frame on the given worker
+typedef std::function<int(int iworker, const gen::Frame &frame)>
+    FrameProcessor;
+
+// Reads and processes frames with overlapped I/O and computation; ntasks may
+// be -1 if the number of frames is not known beforehand
+int run(int ntasks, const FrameReader &readFrame,
+        const FrameProcessor &processFrame, int nworkers = 1,
+        int nbuffers = 4);
+
+// Runs a task (numbered from 0) on the given worker; returns 0 (success)
+typedef std::function<int(int iworker, int itask)> TaskRunner;
+
+// Runs independent tasks on a pool of workers, which steal tasks from each
+// other once they run out of their own
+int runStealing(int ntasks, const TaskRunner &runTask, int nworkers = 1);
+
+} // namespace pipeline
+
+#endif // __PIPELINE_H_
@@ -0,0 +1,118 @@
+#ifndef __PROFILER_H_
+#define __PROFILER_H_
+
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/*! \file profiler.hpp
+    \brief This header file contains the scoped timers and counters of the hot
+   paths.
+
+    Details.
+*/
+
+/*!
+ *  \addtogroup prof
+ *  @{
+ */
+
+/*! \brief Low-overhead instrumentation of the stages of a run.
+ *
+ The hot paths are instrumented with two macros:
+
+ - <b>PROF_SCOPE(name)</b> times the enclosing scope as the stage called name
+ (a string literal).
+ - <b>PROF_COUNT(counter, n)</b> adds n to one of the counters of
+ prof::Counter.
+
+ Every thread keeps its own log of timed scopes and its own counters, so
+ nothing is shared or locked while a run is timed. At exit, prof::report
+ prints the wall time of every stage, its load imbalance between threads and
+ the throughput of the counters, and prof::writeTrace writes every timed
+ scope out in the trace-event format, which trace viewers (such as
+ chrome://tracing or Perfetto) load directly.
+
+ The instrumentation is only built with the CMake option use_Profiling
+ (which defines USE_PROFILING). Otherwise both macros compile to nothing, and
+ their arguments are never evaluated.
+ */
+
+namespace prof {
+
+/*! \brief Counters of the work done.
+ */
+enum Counter {
+  framesRead,     //!< Frames read in
+  bytesParsed,    //!< Bytes of trajectory parsed
+  pairsEvaluated, //!< Pairs of particles whose distance was found
+  pairsInCutoff,  //!< Pairs of particles within the cutoff
+  ncounters       //!< Number of counters
+};
+
+#ifdef USE_PROFILING
+
+/*! \brief A timed scope.
+ */
+struct Event {
+  const char *name; //!< Stage name
+  double start;     //!< Start, in seconds since the start of the run
+  double end;       //!< End, in seconds since the start of the run
+};
+
+/*! \brief Timed scopes and counters of one thread.
+ */
+struct ThreadLog {
+  int thread = 0;            //!< Number of the thread, in order of first use
+  std::vector<Event> events; //!< Timed scopes, in order of completion
+  std::array<unsigned long long, ncounters> counters = {}; //!< Counters
+};
+
+// Seconds since the start of the run
+double now();
+
+// Log of the calling thread, which is set up on first use
+ThreadLog &threadLog();
+
+/*! \brief Timer of the scope in which it is constructed.
+ */
+class ScopedTimer {
+public:
+  explicit ScopedTimer(const char *name) : name_(name), start_(now()) {}
+  ~ScopedTimer() { threadLog().events.push_back({name_, start_, now()}); }
+  ScopedTimer(const ScopedTimer &) = delete;
+  ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+private:
+  const char *name_; // Stage name
+  double start_;     // Start of the scope
+};
+
+// Adds to a counter of the calling thread
+inline void count(Counter counter, unsigned long long n) {
+  threadLog().counters[counter] += n;
+}
+
+// Prints the wall time, load imbalance and throughput of every stage
+void report(std::ostream &out);
+
+// Writes the timed scopes out as trace events
+int writeTrace(const std::string &filename);
+
+#endif // USE_PROFILING
+
+} // namespace prof
+
+#ifdef USE_PROFILING
+#define PROF_CONCAT_(a, b) a##b
+#define PROF_CONCAT(a, b) PROF_CONCAT_(a, b)
+#define PROF_SCOPE(name) prof::ScopedTimer PROF_CONCAT(profTimer, __LINE__)(name)
+#define PROF_COUNT(counter, n) prof::count(prof::counter, (n))
+#else
+#define PROF_SCOPE(name) ((void)0)
+#define PROF_COUNT(counter, n) ((void)sizeof(n))
+#endif // USE_PROFILING
+
+#endif // __PROFILER_H_
@@ -1,8 +1,20 @@
 #ifndef __RDF_H_
 #define __RDF_H_
 
+#include <stdint.h>
+#include <algorithm>
+#include <deque>
+#include <numeric>
+
 #include <generic.hpp>
 #include <inputOutput.hpp>
+#include <kernel.hpp>
+#include <neighbours.hpp>
+#include <profiler.hpp>
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif // USE_OPENMP
 
 /*! \file rdf.hpp
     \brief This contains code specific to radial distribution function
@@ -37,10 +49,33 @@
  1. <b>Initialization:</b> The \f$g(r)\f$ array is initialized to zero.
  2. <b>Sampling:</b> The histogram is added to for a particular bin, if the
  distance of a pair of atoms falls within the \f$r\f$ associated with the bin.
+ When the box holds at least three cells of the cutoff width along every
+ dimension, only the pairs in neighbouring cells of a linked-cell list are
+ visited (see nlist). The distances are binned by a vectorized kernel (see
+ rdf::binRow), a row of pairs at a time. When built with OpenMP, the pairs are
+ split between threads, each of which fills a private histogram.
  3. <b>Normalization:</b> Every bin of the \f$g(r)\f$ array is normalized by the
  product of the number of ideal gas particles in that bin, and the number of
  particles and number of frames.
 
+ These steps are the construction, rdf::RdfAccumulator::addFrame and
+ rdf::RdfAccumulator::result of an rdf::RdfAccumulator.
+
+ For mixtures of several atom types, the partial \f$g_{ab}(r)\f$ of every pair
+ of types is sampled in the same pass over the pairs, into its own column (see
+ rdf::pairColumn). The partial of types \f$a\f$ and \f$b\f$ is normalized with
+ \f$N_a\f$ reference particles and the number density \f$N_b/V\f$ of the other
+ type, and the total \f$g(r)\f$ is the sum of the partials, normalized as for
+ a single type.
+
+ For interfaces and solutions, the \f$g(r)\f$ may be restricted to a subset of
+ reference atoms (such as the ions within a slab) and of target atoms around
+ them (see sel::Selection). Only the \f$N_{ref} N_{target}\f$ pairs of
+ selected atoms are then visited, and the histogram is normalized with
+ \f$N_{ref}\f$ reference particles and the number density
+ \f$N_{target}/V\f$ of the targets. Selecting all atoms as both gives the
+ usual \f$g(r)\f$.
+
   ### Changelog ###
 
   - Amrita Goswami [amrita16thaug646@gmail.com]; date modified: Oct 9, 2019
@@ -48,10 +83,188 @@
 
 namespace rdf {
 
-// Calculates the RDF for a bulk volume with particles of a single type only
-int gr(double *rdfArray, int *nframes, double binsize, int nbin,
-       std::vector<double> box, std::vector<std::vector<double>> coord,
-       double cutoff, int nop, int switchVar);
+/*! \brief Unnormalized state of a \f$g(r)\f$ accumulation.
+ *
+ Holds everything needed to normalize the \f$g(r)\f$ at the end, or to carry
+ on accumulating later: the raw histograms, the number of frames, and the box
+ volume and numbers of particles summed over the frames (the normalization
+ uses their averages). States of separate runs over the same settings can be
+ merged by adding them up (see rdf::mergeState), and saved to checkpoint files
+ (see io::writeCheckpoint). Frames are added through an rdf::RdfAccumulator.
+
+ With a single atom type (the default), all particles are treated as
+ identical. With several atom types, the histogram holds
+ rdf::numberOfColumns(ntypes) histograms of nbin bins one after the other: the
+ total \f$g(r)\f$ followed by the partial \f$g_{ab}(r)\f$ of every pair of
+ types (see rdf::pairColumn). During sampling, only the partials are filled;
+ the total is their sum, which is found during normalization.
+
+ The raw histograms count every pair within the cutoff once, as a 64-bit
+ integer. Integer counts add up exactly in any order, so merged, threaded and
+ distributed accumulations are always identical. The factor of two (every
+ pair is seen from both of its particles) and the conversion to double are
+ left to rdf::normalizeState.
+
+ When only the pairs of selected reference and target atoms are binned (see
+ rdf::accumulateSelected), there is a single histogram, and every ordered pair
+ of a reference and a different target atom counts once. The numbers of
+ reference and target atoms are then also summed, in sumSelected, for the
+ normalization.
+ */
+struct RdfState {
+  double binsize = 0; //!< Bin width
+  double cutoff = 0;  //!< Cutoff of the \f$g(r)\f$
+  int nbin = 0;       //!< Number of bins of each histogram
+  int ntypes = 1;     //!< Number of atom types (1 if the types are ignored)
+  int nframes = 0;    //!< Number of frames accumulated
+  double sumVolume = 0; //!< Box volume summed over the frames
+  std::vector<double> sumCount; //!< Total number of particles (element 0)
+                                //!< and number of each type, summed over the
+                                //!< frames
+  std::vector<uint64_t> histogram; //!< Raw histograms (pairs in every bin)
+  std::vector<double> sumSelected; //!< Reference and target particles,
+                                   //!< summed over the frames (empty unless
+                                   //!< atoms are selected)
+  std::string selection; //!< Reference and target selections, normalized
+                         //!< (see sel::formatSelection) and separated by
+                         //!< "; "; empty unless atoms are selected
+  long long lastTimestep = -1; //!< Largest timestep accumulated; -1 if none
+  long long lastOffset = -1;   //!< Offset of that frame in its trajectory
+};
+
+/*! \brief Block averages of the \f$g(r)\f$, for its statistical errors.
+ *
+ The frames are split into consecutive blocks, and the normalized \f$g(r)\f$
+ of every block is added with rdf::addBlock. Welford's running mean and sum of
+ squared deviations are kept for every bin, so the blocks themselves are never
+ stored. The spread of the block averages gives the standard error of the
+ \f$g(r)\f$ of all the frames (see rdf::standardError), provided the blocks are
+ long compared to the correlation time of the trajectory.
+ */
+struct BlockStats {
+  int nblocks = 0;           //!< Number of blocks added
+  std::vector<double> mean;  //!< Mean over the blocks, in every bin
+  std::vector<double> m2;    //!< Sum of squared deviations from the mean
+};
+
+/*! \brief Sliding window over the latest segments of frames, for a
+ time-resolved \f$g(r)\f$.
+ *
+ The frames are split into consecutive segments, and a window is made up of
+ the last nsegments of them. Every segment is added with rdf::addSegment,
+ which also takes the oldest segment away once the window is full. Windows
+ which overlap thus cost one addition and one subtraction of the raw
+ histograms per segment, however many frames they span, and the trajectory is
+ only read once.
+ */
+struct WindowStats {
+  int nsegments = 1; //!< Segments per window
+  RdfState sum;      //!< Accumulation of the segments in the window
+  std::deque<RdfState> segments; //!< Segments in the window, oldest first
+  std::deque<long long> firstTimesteps; //!< First timestep of every segment
+};
+
+// Normalizes the histograms with respect to an ideal gas
+int normalize(double *rdfArray, int nframes, double binsize, int nbin,
+              double volume, const double *count, int ntypes);
+
+// Normalizes the histogram of selected reference and target atoms
+int normalizeSelected(double *rdfArray, int nframes, double binsize, int nbin,
+                      double volume, double nreference, double ntarget);
+
+// Sets up an empty accumulation state
+void initState(RdfState *state, double binsize, double cutoff, int nbin,
+               int ntypes, std::string selection = "");
+
+// Adds one accumulation state to another
+int mergeState(RdfState *state, const RdfState &other);
+
+// Gets the normalized g(r) of an accumulation state
+std::vector<double> normalizeState(const RdfState &state);
+
+// Takes an earlier accumulation state away from a later one
+int subtractState(RdfState *state, const RdfState &earlier);
+
+// Adds the normalized g(r) of a block of frames to the block averages
+void addBlock(BlockStats *blocks, const std::vector<double> &rdfArray);
+
+// Adds a segment of frames to a sliding window, dropping the oldest segment
+int addSegment(WindowStats *window, const RdfState &segment,
+               long long firstTimestep);
+
+// Gets the standard error of the g(r) in every bin, from the block averages
+std::vector<double> standardError(const BlockStats &blocks);
+
+// Gets the histogram offsets of every pair of atom types
+std::vector<int> pairOffsets(int ntypes, int nbin);
+
+// Gets the fractional coordinates of every particle of a triclinic frame
+void fractionalCoordinates(const gen::Frame &frame, gen::alignedVector *sx,
+                           gen::alignedVector *sy, gen::alignedVector *sz);
+
+// Adds the pairs of a range of rows to the histogram, visiting every pair
+int accumulatePairs(uint64_t *rdfArray, double binsize, int nbin,
+                    const gen::Frame &frame, double cutoff, int ntypes,
+                    int iBegin, int iEnd, const double *sx = nullptr,
+                    const double *sy = nullptr, const double *sz = nullptr);
+
+// Adds the pairs of a frame to the histogram using a linked-cell list
+int accumulateCellList(uint64_t *rdfArray, double binsize, int nbin,
+                       const gen::Frame &frame, double cutoff, int ntypes,
+                       bool singlePrecision = false);
+
+// Adds the pairs of a range of cells of a linked-cell list to the histogram
+int accumulateCells(uint64_t *rdfArray, double binsize, int nbin,
+                    const gen::Frame &frame, double cutoff, int ntypes,
+                    const nlist::CellList &cells, int cellBegin, int cellEnd);
+
+// Adds the pairs of selected reference and target atoms to the histogram
+int accumulateSelected(uint64_t *rdfArray, double binsize, int nbin,
+                       const gen::Frame &frame, double cutoff,
+                       const std::vector<int> &reference,
+                       const std::vector<int> &target, gen::Frame *targets,
+                       nlist::CellList *cells);
+
+// Splits the rows of the pair matrix into chunks with equal numbers of pairs
+std::vector<int> balancedRows(int nop, int nchunks);
+
+#ifdef USE_OPENMP
+// Adds the pairs of a frame to the histogram using all OpenMP threads
+int accumulateThreaded(uint64_t *rdfArray, double binsize, int nbin,
+                       const gen::Frame &frame, double cutoff, int ntypes,
+                       const nlist::CellList *cells);
+#endif // USE_OPENMP
+
+// --------------------------------------------
+// INLINE FUNCTIONS
+
+/********************************************/ /**
+ *  Function for getting the number of columns (histograms of nbin bins) of
+ the \f$g(r)\f$ array. With a single atom type there is only the \f$g(r)\f$;
+ otherwise the total \f$g(r)\f$ is followed by one partial \f$g_{ab}(r)\f$
+ for every pair of types \f$a \leq b\f$.
+ *  @param[in] ntypes The number of atom types
+ ***********************************************/
+inline int numberOfColumns(int ntypes) {
+  if (ntypes <= 1) {
+    return 1;
+  }
+  return 1 + ntypes * (ntypes + 1) / 2;
+}
+
+/********************************************/ /**
+ *  Function for getting the column of the partial \f$g_{ab}(r)\f$ of a pair
+ of atom types. The pairs \f$a \leq b\f$ are in the order 1-1, 1-2, ..., 1-n,
+ 2-2, 2-3, ..., n-n, after the total \f$g(r)\f$ in column 0.
+ *  @param[in] itype The first atom type (starting from 1)
+ *  @param[in] jtype The second atom type (starting from 1)
+ *  @param[in] ntypes The number of atom types
+ ***********************************************/
+inline int pairColumn(int itype, int jtype, int ntypes) {
+  int a = std::min(itype, jtype) - 1; // Smaller type, from 0
+  int b = std::max(itype, jtype) - 1; // Larger type, from 0
+  return 1 + a * ntypes - a * (a - 1) / 2 + (b - a);
+}
 
 } // namespace rdf
 
@@ -0,0 +1,142 @@
+#ifndef __SELECTION_H_
+#define __SELECTION_H_
+
+#include <math.h>
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Internal
+#include <generic.hpp>
+#include <inputOutput.hpp>
+
+/*! \file selection.hpp
+    \brief This header file contains the selections of atom subsets, by id,
+   type and region.
+
+    Details.
+*/
+
+/*!
+ *  \addtogroup sel
+ *  @{
+ */
+
+/*! \brief Selections of subsets of the atoms of a frame.
+ *
+ A selection is written as a short expression of clauses, all of which an atom
+ must satisfy:
+
+ - <b>all</b> selects every atom (as does an empty expression).
+ - <b>id 1-100 250</b> selects the atom ids in any of the given ranges (both
+ ends included) or single ids.
+ - <b>type 2 3</b> selects the atoms of any of the given types.
+ - <b>z 10.0 20.0</b> selects the atoms whose z coordinate lies in
+ \f$[10, 20)\f$, and likewise for x and y. For an orthorhombic box, the
+ coordinate is first wrapped back into the box, so unwrapped trajectories give
+ the same slab; for a triclinic box the coordinate is taken as it is.
+
+ The clauses may be joined with "and", and commas may be used between ranges,
+ e.g. "type 1 and z 10 20" or "id 1-10,20-30". An id or type clause may be
+ given once, while region clauses along different dimensions (or several along
+ the same one) all have to be satisfied.
+
+ A selection is parsed once (sel::parseSelection), and evaluated for every
+ frame into a list of atom indices (sel::selectAtoms), since the atoms inside
+ a region change from frame to frame. A parsed selection is written back out
+ in a normalized form by sel::formatSelection, so that the same selection
+ written differently can be recognized, e.g. when resuming from a checkpoint.
+ */
+
+namespace sel {
+
+/*! \brief A slab of the box along one dimension.
+ */
+struct Region {
+  int dim = 0;   //!< Dimension (0, 1 or 2 for x, y or z)
+  double lo = 0; //!< Lower bound (included)
+  double hi = 0; //!< Upper bound (excluded)
+};
+
+/*! \brief A parsed selection expression; empty lists do not restrict the
+ atoms.
+ */
+struct Selection {
+  std::vector<std::array<int, 2>> idRanges; //!< Ranges of ids, both ends
+                                            //!< included
+  std::vector<int> types;     //!< Atom types
+  std::vector<Region> regions; //!< Slabs the atoms must lie in
+
+  // true if every atom is selected
+  bool isAll() const {
+    return idRanges.empty() && types.empty() && regions.empty();
+  }
+};
+
+// Parses a selection expression
+int parseSelection(const std::string &expression, Selection *selection);
+
+// Writes a parsed selection as an expression, in a normalized form
+std::string formatSelection(const Selection &selection);
+
+// Gets the indices of the atoms of a frame which a selection selects
+void selectAtoms(const Selection &selection, const gen::Frame &frame,
+                 std::vector<int> *indices);
+
+// --------------------------------------------
+// INLINE FUNCTIONS
+
+/********************************************/ /**
+ *  Function for checking whether an atom of a frame is selected.
+ *  @param[in] selection The selection
+ *  @param[in] frame The frame
+ *  @param[in] iatom The index of the atom in the frame
+ ***********************************************/
+inline bool isSelected(const Selection &selection, const gen::Frame &frame,
+                       int iatom) {
+  bool found; // true if a range or type of the clause matches
+  double pos; // Coordinate of the atom along a region's dimension
+
+  if (!selection.idRanges.empty()) {
+    found = false;
+    for (const std::array<int, 2> &range : selection.idRanges) {
+      found = found || (frame.id[iatom] >= range[0] &&
+                        frame.id[iatom] <= range[1]);
+    }
+    if (!found) {
+      return false;
+    }
+  }
+  if (!selection.types.empty()) {
+    found = false;
+    for (int type : selection.types) {
+      found = found || frame.type[iatom] == type;
+    }
+    if (!found) {
+      return false;
+    }
+  }
+  for (const Region &region : selection.regions) {
+    const gen::alignedVector &coord = (region.dim == 0)   ? frame.x
+                                      : (region.dim == 1) ? frame.y
+                                                          : frame.z;
+    pos = coord[iatom];
+    // Wrap the coordinate back into [boxLo, boxLo + box)
+    if (!frame.isTriclinic() && frame.box[region.dim] > 0) {
+      pos -= frame.boxLo[region.dim];
+      pos -= frame.box[region.dim] * floor(pos / frame.box[region.dim]);
+      pos += frame.boxLo[region.dim];
+    }
+    if (pos < region.lo || pos >= region.hi) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+} // namespace sel
+
+#endif // __SELECTION_H_
@@ -0,0 +1,118 @@
+#ifndef __STREAMREADER_H_
+#define __STREAMREADER_H_
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// zlib, for gzip-compressed trajectories
+#include <zlib.h>
+
+// Internal
+#include <generic.hpp>
+#include <inputOutput.hpp>
+#include <mmapReader.hpp>
+
+/*! \file streamReader.hpp
+    \brief This header file contains the single-pass reader for streamed and
+   compressed lammps trajectory files.
+
+    Details.
+*/
+
+/*!
+ *  \addtogroup io
+ *  @{
+ */
+
+/*! \brief Single-pass reader for lammps trajectories which cannot be mapped.
+ *
+ Trajectories piped in through stdin, or compressed with gzip or zstd, cannot
+ be seeked through or indexed beforehand. They are read front to back instead,
+ one frame at a time, into a buffer which only ever holds the current frame
+ (and whatever has been read in after it). The number of frames is never
+ needed, so frames are selected on the fly (see io::FrameSelection).
+
+ Everything is read through zlib, which passes uncompressed data through
+ untouched, so stdin may hold a plain or a gzip-compressed trajectory. zstd
+ files are decompressed by the zstd program, in a separate process, so
+ decompression overlaps with parsing.
+
+ Frames are read in two steps: io::FrameStream::nextHeader reads in the header
+ and all the atom lines of the next frame, and io::FrameStream::parse parses
+ the atom lines into a frame. Frames which are not selected are skipped without
+ parsing their atom lines.
+ */
+
+namespace io {
+
+/*! \brief Reader of a lammps trajectory from stdin or a compressed file.
+ */
+class FrameStream {
+public:
+  FrameStream() {}
+  ~FrameStream() { close(); }
+  FrameStream(const FrameStream &) = delete;
+  FrameStream &operator=(const FrameStream &) = delete;
+
+  // Opens stdin ("-"), a gzip (.gz) or zstd (.zst) file; returns 0 (success)
+  // or 1 (error)
+  int open(const std::string &source);
+  // Closes the stream
+  void close();
+
+  // Reads in the next frame; returns 0 (success), 1 (error) or -1 (no frames
+  // left)
+  int nextHeader(FrameIndexEntry *entry);
+  // Parses the atom lines of the frame read in by nextHeader
+  int parse(gen::Frame *frame);
+
+private:
+  // Reads more of the stream into the buffer; returns 1 on a read error
+  int fill();
+  // Finds the end of nlines whole lines, starting at offset *pos
+  int findLines(std::size_t *pos, int nlines);
+
+  gzFile gz_ = nullptr;         // Decompressing reader
+  FILE *pipe_ = nullptr;        // Output of the zstd program, if used
+  std::vector<char> buffer_;    // Data read in, from the current frame on
+  std::size_t begin_ = 0;       // Start of the current frame
+  std::size_t atoms_ = 0;       // Start of the atom lines of the frame
+  std::size_t frameEnd_ = 0;    // End of the current frame
+  std::size_t end_ = 0;         // End of the data read in
+  std::streamoff dropped_ = 0;  // Bytes of the stream dropped before buffer_
+  bool eof_ = false;            // true once the stream has been read to the end
+  FrameIndexEntry entry_;       // Header of the current frame
+  AtomColumns columns_;         // Columns of the atom lines of the frame
+};
+
+// --------------------------------------------
+// INLINE FUNCTIONS
+
+/********************************************/ /**
+ *  Function for checking if a file name ends with a suffix.
+ *  @param[in] filename The file name
+ *  @param[in] suffix The suffix, such as ".gz"
+ ***********************************************/
+inline bool hasSuffix(const std::string &filename, const std::string &suffix) {
+  return filename.size() >= suffix.size() &&
+         filename.compare(filename.size() - suffix.size(), suffix.size(),
+                          suffix) == 0;
+}
+
+/********************************************/ /**
+ *  Function for checking if a trajectory has to be streamed: stdin (given as
+ "-"), or a gzip or zstd compressed file.
+ *  @param[in] filename The path of the trajectory file
+ ***********************************************/
+inline bool isStreamInput(const std::string &filename) {
+  return (filename == "-" || io::hasSuffix(filename, ".gz") ||
+          io::hasSuffix(filename, ".zst") || io::hasSuffix(filename, ".zstd"));
+}
+
+} // namespace io
+
+#endif // __STREAMREADER_H_
@@ -0,0 +1,74 @@
+#ifndef __STRUCTURE_H_
+#define __STRUCTURE_H_
+
+#include <math.h>
+#include <vector>
+
+// Internal
+#include <rdf.hpp>
+
+/*! \file structure.hpp
+    \brief This header file contains the quantities derived from the
+   \f$g(r)\f$: running coordination numbers and the static structure factor.
+
+    Details.
+*/
+
+/*!
+ *  \addtogroup rdf
+ *  @{
+ */
+
+/*! \brief Quantities derived from an accumulated \f$g(r)\f$.
+ *
+ Both are found from the same accumulation state as the \f$g(r)\f$, so the
+ output file never has to be read back in.
+
+ - The <b>running coordination number</b> \f$n(r)\f$ is the mean number of
+ particles within \f$r\f$ of a particle,
+ \f[ n(r) = 4 \pi \rho \int_0^r r'^2 g(r') dr'. \f]
+ It is simply the running sum of the raw histogram, divided by the number of
+ reference particles, so it is exact at the upper edge of every bin. For a
+ pair of types \f$a\f$ and \f$b\f$, it is the number of particles of type
+ \f$b\f$ around a particle of type \f$a\f$.
+ - The <b>static structure factor</b> is the sine transform of the
+ \f$g(r)\f$,
+ \f[ S(q) = 1 + 4 \pi \rho \int_0^{r_c} r^2 (g(r) - 1)
+ \frac{\sin(qr)}{qr} dr, \f]
+ found as a direct sum over the bins (at their centres) for every \f$q\f$.
+ Partial structure factors use the total number density \f$\rho\f$ (the
+ Faber-Ziman convention). Since the integral stops at the cutoff, the cutoff
+ should be large enough for \f$g(r)\f$ to have levelled off at 1.
+ */
+
+namespace rdf {
+
+// Gets the running coordination numbers at the upper edge of every bin
+std::vector<double> coordinationNumbers(const RdfState &state);
+
+// Gets the static structure factors on a grid of q values
+std::vector<double> structureFactor(const RdfState &state,
+                                    const std::vector<double> &rdfArray,
+                                    const std::vector<double> &q);
+
+// --------------------------------------------
+// INLINE FUNCTIONS
+
+/********************************************/ /**
+ *  Function for getting an evenly spaced grid of q values, from qStep up to
+ qMax.
+ *  @param[in] qStep The spacing of the grid (and the smallest q)
+ *  @param[in] qMax The largest q
+ ***********************************************/
+inline std::vector<double> qGrid(double qStep, double qMax) {
+  std::vector<double> q; // Grid of q values
+
+  for (int iq = 1; qStep > 0 && iq * qStep <= qMax * (1 + 1e-12); iq++) {
+    q.push_back(iq * qStep);
+  }
+  return q;
+}
+
+} // namespace rdf
+
+#endif // __STRUCTURE_H_
@@ -0,0 +1,93 @@
+#ifndef __WINDOW_H_
+#define __WINDOW_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Internal
+#include <rdf.hpp>
+
+/*! \file window.hpp
+    \brief This header file contains the output file of the time-resolved
+   \f$g(r)\f$.
+
+    Details.
+*/
+
+/*!
+ *  \addtogroup io
+ *  @{
+ */
+
+/*! \brief Output file of the time-resolved \f$g(r)\f$ of sliding windows.
+ *
+ A windowed run (see rdf::WindowStats) gives a normalized \f$g(r)\f$ for every
+ window of frames. Instead of a text file per window, all of them are written
+ one after the other to a single binary file, as they are found.
+
+ The layout of a window file is:
+
+ 1. <b>Header</b> (io::WindowHeader): a signature, the version, the settings
+ and the number of windows.
+ 2. <b>Windows</b>, one after the other, each of the same size: the first and
+ last timesteps of the window as int64, followed by its \f$g(r)\f$ as ncolumns
+ columns of nbin float32 values, in the column order of rdf.dat (the total,
+ then every pair of atom types). Bin i is centred on (i + 0.5) binsize.
+
+ The file is a 2D array of nwindows rows, and can be read with e.g.
+ numpy.fromfile (with an offset of the header). It is written to a temporary
+ file which is renamed once the last window is in, so the file is never seen
+ half-written. All numbers are stored in the byte order of the machine which
+ wrote the file.
+ */
+
+namespace io {
+
+// Signature at the start of every window file
+const char windowMagic[9] = "YODAWIN1";
+
+/*! \brief Header at the start of a window file.
+ */
+struct WindowHeader {
+  char magic[8];            //!< Signature, io::windowMagic
+  uint32_t version = 1;     //!< Version of the format
+  int32_t nbin = 0;         //!< Number of bins of each column
+  int32_t ntypes = 1;       //!< Number of atom types
+  int32_t ncolumns = 1;     //!< Columns of every window (see rdf.dat)
+  int32_t windowFrames = 0; //!< Frames per window
+  int32_t windowStride = 0; //!< Frames between the starts of windows
+  double binsize = 0;       //!< Bin width
+  double cutoff = 0;        //!< Cutoff of the g(r)
+  uint64_t nwindows = 0;    //!< Number of windows
+};
+
+/*! \brief Writer of the windows of a time-resolved \f$g(r)\f$, one at a time.
+ */
+class WindowWriter {
+public:
+  // Starts a window file, for the settings of an accumulation state
+  int open(const std::string &filename, const rdf::RdfState &state,
+           int windowFrames, int windowStride);
+  // Appends the normalized g(r) of a window
+  int write(long long firstTimestep, long long lastTimestep,
+            const std::vector<double> &rdfArray);
+  // Fills in the number of windows and moves the file into place
+  int close();
+  // Number of windows written
+  uint64_t nwindows() const { return header_.nwindows; }
+
+private:
+  std::string filename_;    // Path of the finished file
+  std::ofstream file_;      // Temporary file being written
+  WindowHeader header_;     // Header of the file
+  std::vector<float> row_;  // g(r) of the current window, in float32
+};
+
+} // namespace io
+
+#endif // __WINDOW_H_
@@ -0,0 +1,303 @@
+#include <accumulator.hpp>
+
+/********************************************/ /**
+ *  Pair kernel which bins every pair of particles of the frame.
+ *  @param[in] histogram The raw histograms, which are added to
+ *  @param[in] frame The frame
+ *  @param[in] settings The bins, cutoff and number of atom types
+ *  @param[in] cells Not used
+ *  \return an int value of 0 (success)
+ ***********************************************/
+int rdf::bruteForceKernel(uint64_t *histogram, const gen::Frame &frame,
+                          const rdf::RdfState &settings,
+                          nlist::CellList * /*cells*/) {
+  return rdf::accumulatePairs(histogram, settings.binsize, settings.nbin,
+                              frame, settings.cutoff, settings.ntypes, 0,
+                              frame.nop);
+}
+
+/********************************************/ /**
+ *  Pair kernel which bins the pairs in neighbouring cells of a linked-cell
+ list, or every pair if the box is too small for one.
+ *  @param[in] histogram The raw histograms, which are added to
+ *  @param[in] frame The frame
+ *  @param[in] settings The bins, cutoff and number of atom types
+ *  @param[in] cells The cell list, which is rebuilt for the frame (reusing its
+ memory)
+ *  \return an int value of 0 (success)
+ ***********************************************/
+int rdf::cellListKernel(uint64_t *histogram, const gen::Frame &frame,
+                        const rdf::RdfState &settings,
+                        nlist::CellList *cells) {
+  if (nlist::buildCellList(cells, frame, settings.cutoff) != 0) {
+    return rdf::bruteForceKernel(histogram, frame, settings, cells);
+  }
+  return rdf::accumulateCells(histogram, settings.binsize, settings.nbin,
+                              frame, settings.cutoff, settings.ntypes, *cells,
+                              0, cells->size());
+}
+
+/********************************************/ /**
+ *  Default pair kernel. A linked-cell list is used whenever the box holds at
+ least three cells of the cutoff width along every dimension. When built with
+ OpenMP and more than one thread is available, the pairs are split between the
+ threads (see rdf::accumulateThreaded).
+ *  @param[in] histogram The raw histograms, which are added to
+ *  @param[in] frame The frame
+ *  @param[in] settings The bins, cutoff and number of atom types
+ *  @param[in] cells The cell list, which is rebuilt for the frame (reusing its
+ memory)
+ *  \return an int value of 0 (success) or 1 (failure)
+ ***********************************************/
+int rdf::defaultKernel(uint64_t *histogram, const gen::Frame &frame,
+                       const rdf::RdfState &settings, nlist::CellList *cells) {
+#ifdef USE_OPENMP
+  // Split the pairs between threads
+  if (omp_get_max_threads() > 1) {
+    bool useCells = nlist::buildCellList(cells, frame, settings.cutoff) == 0;
+    return rdf::accumulateThreaded(histogram, settings.binsize, settings.nbin,
+                                   frame, settings.cutoff, settings.ntypes,
+                                   useCells ? cells : nullptr);
+  }
+#endif // USE_OPENMP
+  return rdf::cellListKernel(histogram, frame, settings, cells);
+}
+
+/********************************************/ /**
+ *  Function for binning the pairs in neighbouring cells of a cell list which
+ has already been built for the frame, e.g. one shared by several accumulators
+ (see rdf::AnalysisSet). When built with OpenMP and more than one thread is
+ available, the cells are split between the threads.
+ *  @param[in] histogram The raw histograms, which are added to
+ *  @param[in] frame The frame
+ *  @param[in] settings The bins, cutoff and number of atom types
+ *  @param[in] cells The cell list of the frame, whose cells are at least as
+ wide as the cutoff
+ *  \return an int value of 0 (success) or 1 (error)
+ ***********************************************/
+int rdf::builtCellKernel(uint64_t *histogram, const gen::Frame &frame,
+                         const rdf::RdfState &settings,
+                         const nlist::CellList &cells) {
+#ifdef USE_OPENMP
+  // Split the cells between threads
+  if (omp_get_max_threads() > 1) {
+    return rdf::accumulateThreaded(histogram, settings.binsize, settings.nbin,
+                                   frame, settings.cutoff, settings.ntypes,
+                                   &cells);
+  }
+#endif // USE_OPENMP
+  return rdf::accumulateCells(histogram, settings.binsize, settings.nbin,
+                              frame, settings.cutoff, settings.ntypes, cells,
+                              0, cells.size());
+}
+
+/********************************************/ /**
+ *  Constructor of an empty accumulator.
+ *  @param[in] binsize The bin width
+ *  @param[in] cutoff This is the maximum length upto which the \f$g(r)\f$ will
+ be calculated, and should be less than half the box length
+ *  @param[in] ntypes (Optional argument) The number of atom types. The types
+ in the frames must be from 1 to ntypes. If this is 1, the types are ignored
+ *  @param[in] kernel (Optional argument) The pair kernel
+ ***********************************************/
+rdf::RdfAccumulator::RdfAccumulator(double binsize, double cutoff, int ntypes,
+                                    rdf::PairKernel kernel)
+    : kernel_(kernel) {
+  rdf::initState(&state_, binsize, cutoff, (int)(cutoff / binsize) + 1,
+                 std::max(ntypes, 1));
+  blockStart_ = state_;
+}
+
+/********************************************/ /**
+ *  Constructor of an accumulator which carries on from a saved state.
+ *  @param[in] state The accumulation state, e.g. read from a checkpoint
+ *  @param[in] kernel (Optional argument) The pair kernel
+ ***********************************************/
+rdf::RdfAccumulator::RdfAccumulator(const rdf::RdfState &state,
+                                    rdf::PairKernel kernel)
+    : state_(state), kernel_(kernel), blockStart_(state) {}
+
+/********************************************/ /**
+ *  Function for restricting the \f$g(r)\f$ to selected reference and target
+ atoms. From then on, the pair kernel is not used, and the g(r) of the target
+ atoms around the reference atoms is accumulated instead (see
+ rdf::accumulateSelected). The types are ignored, so the accumulator must have
+ a single atom type, and no frames may have been added yet (unless it carries
+ on from the saved state of selected atoms).
+ *  @param[in] reference The selection of the reference atoms
+ *  @param[in] target The selection of the target atoms
+ *  \return an int value of 0 (success) or 1 (failure)
+ ***********************************************/
+int rdf::RdfAccumulator::setSelection(const sel::Selection &reference,
+                                      const sel::Selection &target) {
+  if (cells_.singlePrecision) {
+    std::cerr << "Atoms cannot be selected in single precision.\n";
+    return 1;
+  }
+  if (state_.ntypes != 1 ||
+      (state_.nframes != 0 && state_.sumSelected.empty())) {
+    std::cerr << "Atoms can only be selected for an empty g(r) accumulation "
+                 "of a single atom type.\n";
+    return 1;
+  }
+  std::string selection = sel::formatSelection(reference) + "; " +
+                          sel::formatSelection(target); // Both, normalized
+  if (!state_.sumSelected.empty() && state_.selection != selection) {
+    std::cerr << "The atoms selected differ from those of the saved g(r) "
+                 "accumulation.\n";
+    return 1;
+  }
+  selecting_ = true;
+  reference_ = reference;
+  target_ = target;
+  if (state_.sumSelected.empty()) {
+    state_.sumSelected.assign(2, 0.0);
+    state_.selection = selection;
+    blockStart_ = state_;
+  }
+  return 0;
+}
+
+/********************************************/ /**
+ *  Function for switching the accumulator to single precision: the cell lists
+ it builds keep float copies of the coordinates, and their pairs are binned by
+ the float kernels (see rdf::binRowFloat), with the bins and the normalization
+ still in double. Frames whose box is too small for a cell list are binned in
+ double precision.
+ *  @param[in] singlePrecision true for float coordinates
+ *  \return an int value of 0 (success) or 1 (atoms are selected)
+ ***********************************************/
+int rdf::RdfAccumulator::setSinglePrecision(bool singlePrecision) {
+  if (selecting_ && singlePrecision) {
+    std::cerr << "Atoms cannot be selected in single precision.\n";
+    return 1;
+  }
+  cells_.singlePrecision = singlePrecision;
+  return 0;
+}
+
+/********************************************/ /**
+ *  Function for adding a frame: its pairs are binned by the pair kernel (or
+ only those of the selected atoms, see rdf::RdfAccumulator::setSelection), and
+ its volume and numbers of particles are added to the sums. The frame is only
+ read. A triclinic frame is rejected if the cutoff is more than half the
+ smallest perpendicular width of its box (see nlist::boxWidths).
+ *  @param[in] frame The frame
+ *  @param[in] cells (Optional argument) A cell list already built for the
+ frame, with cells at least as wide as the cutoff. If given, the pairs are
+ binned from it (see rdf::builtCellKernel) instead of by the pair kernel,
+ unless atoms are selected
+ *  \return an int value of 0 (success) or 1 (failure)
+ ***********************************************/
+int rdf::RdfAccumulator::addFrame(const gen::Frame &frame,
+                                  const nlist::CellList *cells) {
+  int ntypes = state_.ntypes; // Number of atom types
+
+  // Several atom types: check that every type is from 1 to ntypes
+  for (int iatom = 0; iatom < frame.nop && ntypes > 1; iatom++) {
+    if (frame.type[iatom] < 1 || frame.type[iatom] > ntypes) {
+      std::cerr << "The atom type " << frame.type[iatom]
+                << " is not between 1 and " << ntypes << ".\n";
+      return 1;
+    }
+  } // end of type check
+
+  // Triclinic box: the minimum image is only unique up to half the smallest
+  // perpendicular width of the box
+  if (frame.isTriclinic()) {
+    std::array<double, 3> widths = nlist::boxWidths(frame); // Box widths
+    if (2 * state_.cutoff >
+        *std::min_element(widths.begin(), widths.end())) {
+      std::cerr << "The cutoff " << state_.cutoff
+                << " is more than half the smallest width of the triclinic "
+                   "box of timestep "
+                << frame.timestep << ".\n";
+      return 1;
+    }
+  }
+
+#ifdef USE_PROFILING
+  // Every pair within the cutoff adds 1 to the histograms
+  uint64_t before = std::accumulate(state_.histogram.begin(),
+                                    state_.histogram.end(), (uint64_t)0);
+#endif // USE_PROFILING
+  if (selecting_) {
+    sel::selectAtoms(reference_, frame, &referenceAtoms_);
+    sel::selectAtoms(target_, frame, &targetAtoms_);
+    if (rdf::accumulateSelected(state_.histogram.data(), state_.binsize,
+                                state_.nbin, frame, state_.cutoff,
+                                referenceAtoms_, targetAtoms_, &targets_,
+                                &cells_) != 0) {
+      return 1;
+    }
+    state_.sumSelected[0] += referenceAtoms_.size();
+    state_.sumSelected[1] += targetAtoms_.size();
+  } else if (cells) {
+    if (rdf::builtCellKernel(state_.histogram.data(), frame, state_,
+                             *cells) != 0) {
+      return 1;
+    }
+  } else if (kernel_(state_.histogram.data(), frame, state_, &cells_) != 0) {
+    return 1;
+  }
+#ifdef USE_PROFILING
+  PROF_COUNT(pairsInCutoff, std::accumulate(state_.histogram.begin(),
+                                            state_.histogram.end(),
+                                            (uint64_t)0) -
+                                before);
+#endif // USE_PROFILING
+
+  state_.nframes++;
+  state_.sumVolume += frame.volume();
+  state_.sumCount[0] += frame.nop;
+  for (int iatom = 0; iatom < frame.nop && ntypes > 1; iatom++) {
+    state_.sumCount[frame.type[iatom]] += 1;
+  }
+  state_.lastTimestep = std::max(state_.lastTimestep, frame.timestep);
+
+  return 0;
+}
+
+/********************************************/ /**
+ *  Function for adding the accumulation of another accumulator, which must
+ have the same bins, cutoff and number of atom types (see rdf::mergeState).
+ *  @param[in] other The other accumulator
+ *  \return an int value of 0 (success) or 1 (the settings differ)
+ ***********************************************/
+int rdf::RdfAccumulator::merge(const rdf::RdfAccumulator &other) {
+  return rdf::mergeState(&state_, other.state_);
+}
+
+/********************************************/ /**
+ *  Function for getting the normalized \f$g(r)\f$ of the frames added so far.
+ *  \return the normalized histograms (see rdf::RdfState for the layout)
+ ***********************************************/
+std::vector<double> rdf::RdfAccumulator::result() const {
+  return rdf::normalizeState(state_);
+}
+
+/********************************************/ /**
+ *  Function for emptying the histograms, sums and block averages, keeping the
+ settings, the pair kernel and the atom selections.
+ ***********************************************/
+void rdf::RdfAccumulator::reset() {
+  rdf::initState(&state_, state_.binsize, state_.cutoff, state_.nbin,
+                 state_.ntypes, state_.selection);
+  blockStart_ = state_;
+  blocks_ = rdf::BlockStats();
+}
+
+/********************************************/ /**
+ *  Function for closing the current block of frames: the normalized
+ \f$g(r)\f$ of the frames added since the last block was closed is added to
+ the block averages (see rdf::addBlock). Nothing is added if no frames were.
+ ***********************************************/
+void rdf::RdfAccumulator::endBlock() {
+  rdf::RdfState block = state_; // Accumulation of the block
+
+  rdf::subtractState(&block, blockStart_);
+  if (block.nframes > 0) {
+    rdf::addBlock(&blocks_, rdf::normalizeState(block));
+  }
+  blockStart_ = state_;
+}
@@ -0,0 +1,73 @@
+#include <analysis.hpp>
+
+/********************************************/ /**
+ *  Function for adding an analysis to the set, with an empty accumulator.
+ *  @param[in] analysis The settings of the analysis
+ *  @param[in] ntypes The number of atom types of its accumulation
+ *  \return an int value of 0 (success) or 1 (failure)
+ ***********************************************/
+int rdf::AnalysisSet::add(const rdf::Analysis &analysis, int ntypes) {
+  rdf::RdfAccumulator accumulator(analysis.binsize, analysis.cutoff, ntypes);
+
+  if (analysis.isSelecting() &&
+      accumulator.setSelection(analysis.reference, analysis.target) != 0) {
+    return 1;
+  }
+  if (accumulator.setSinglePrecision(analysis.singlePrecision) != 0) {
+    return 1;
+  }
+  accumulators_.push_back(accumulator);
+  sharing_.push_back(!analysis.isSelecting());
+  return 0;
+}
+
+/********************************************/ /**
+ *  Function for adding a frame to every analysis of the set.
+ *
+ * For every analysis without atom selections whose box holds a cell list (see
+ nlist::isUsable), the grid of cells of its cutoff is found. The first analysis
+ with a new grid (or precision) builds the cell list of the frame, which every
+ later analysis with the same grid and precision bins its pairs from. The cell
+ lists are reused from frame to frame.
+ *
+ *  @param[in] frame The frame
+ *  \return an int value of 0 (success) or 1 (failure)
+ ***********************************************/
+int rdf::AnalysisSet::addFrame(const gen::Frame &frame) {
+  std::array<double, 3> widths = nlist::boxWidths(frame); // Box widths
+  std::array<int, 3> ncell; // Cells of the current analysis
+  std::array<int, 4> grid;  // Cells and precision of the current analysis
+  int igrid;               // Shared cell list of the current analysis
+  double cutoff;           // Cutoff of the current analysis
+
+  grids_.clear();
+  for (int ianalysis = 0; ianalysis < accumulators_.size(); ianalysis++) {
+    cutoff = accumulators_[ianalysis].state().cutoff;
+    if (!sharing_[ianalysis] || !nlist::isUsable(widths, cutoff)) {
+      if (accumulators_[ianalysis].addFrame(frame) != 0) {
+        return 1;
+      }
+      continue;
+    }
+    // Find the cell list with the same cells, or build a new one
+    ncell = nlist::numberOfCells(widths, cutoff);
+    grid = {{ncell[0], ncell[1], ncell[2],
+             accumulators_[ianalysis].singlePrecision() ? 1 : 0}};
+    igrid = std::find(grids_.begin(), grids_.end(), grid) - grids_.begin();
+    if (igrid == grids_.size()) {
+      grids_.push_back(grid);
+      if (cells_.size() < grids_.size()) {
+        cells_.resize(grids_.size());
+      }
+      cells_[igrid].singlePrecision = (grid[3] == 1);
+      if (nlist::buildCellList(&cells_[igrid], frame, cutoff) != 0) {
+        return 1;
+      }
+    }
+    if (accumulators_[ianalysis].addFrame(frame, &cells_[igrid]) != 0) {
+      return 1;
+    }
+  } // end of loop through analyses
+
+  return 0;
+}
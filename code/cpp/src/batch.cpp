@@ -0,0 +1,314 @@
+#include <batch.hpp>
+#include <profiler.hpp>
+#include <streamReader.hpp>
+
+/********************************************/ /**
+ *  Function for reading the list of trajectories of a batch, one path per
+ line. Blank lines and everything after a # are skipped.
+ *  @param[in] filename The path of the list
+ *  @param[out] trajectories The paths of the trajectories, which are
+ overwritten
+ *  \return an int value of 0 (success) or 1 (error)
+ ***********************************************/
+int batch::readTrajectoryList(const std::string &filename,
+                              std::vector<std::string> *trajectories) {
+  std::ifstream inFile(filename); // List of trajectories
+  std::string line;               // Current line
+  std::vector<std::string> tokens; // Words of the current line
+
+  if (!inFile.is_open()) {
+    std::cerr << "Could not open the list of trajectories " << filename
+              << "\n";
+    return 1;
+  }
+  trajectories->clear();
+  while (std::getline(inFile, line)) {
+    tokens = io::tokenizer(line.substr(0, line.find('#')));
+    if (tokens.size() > 1) {
+      std::cerr << "The line '" << line << "' of " << filename
+                << " is not a single path.\n";
+      return 1;
+    }
+    if (!tokens.empty()) {
+      trajectories->push_back(tokens[0]);
+    }
+  }
+  if (trajectories->empty()) {
+    std::cerr << "There are no trajectories in " << filename << "\n";
+    return 1;
+  }
+
+  return 0;
+}
+
+/********************************************/ /**
+ *  Function for reading in a frame of a trajectory of the batch.
+ *  @param[in] trajectory The trajectory
+ *  @param[in] iframe The frame (from 0)
+ *  @param[out] frame The reusable frame, which is overwritten
+ *  \return an int value of 0 (success) or 1 (error)
+ ***********************************************/
+static int readFrame(const batch::Trajectory &trajectory, int iframe,
+                     gen::Frame *frame) {
+  if (trajectory.isBinary) {
+    return trajectory.binaryTraj.readFrame(iframe, frame);
+  }
+  const char *cursor =
+      trajectory.dumpFile.data() + trajectory.frameIndex[iframe].offset;
+  return io::parseFrame(&cursor, trajectory.dumpFile.end(), frame);
+}
+
+/********************************************/ /**
+ *  Function for opening a trajectory of the batch, and setting up its
+ accumulations. The frame index is read (or built), the frames are selected
+ just as for a single run, and the largest atom type of the last selected
+ frame gives the number of types. The index is read while holding one of the
+ reader slots.
+ *  @param[in, out] trajectory The trajectory, whose filename is set
+ *  @param[in] selection The frames to be analysed
+ *  @param[in] config The run settings
+ *  @param[in] analyses The settings of every analysis
+ *  @param[in] readers The reader slots
+ *  @param[in] frame A reusable frame, which is overwritten
+ *  \return an int value of 0 (success) or 1 (error)
+ ***********************************************/
+static int openTrajectory(batch::Trajectory *trajectory,
+                          const io::FrameSelection &selection,
+                          const io::RunConfig &config,
+                          const std::vector<rdf::Analysis> &analyses,
+                          pipeline::Semaphore *readers, gen::Frame *frame) {
+  int maxType = 1; // Largest atom type of the trajectory
+  int fail = 0;    // Non-zero if the trajectory could not be read
+
+  if (io::isStreamInput(trajectory->filename)) {
+    std::cerr << "The trajectory " << trajectory->filename
+              << " cannot be streamed in batch mode.\n";
+    return 1;
+  }
+  readers->acquire();
+  trajectory->isBinary = io::isBinaryTrajectory(trajectory->filename);
+  if (trajectory->isBinary) {
+    fail = trajectory->binaryTraj.open(trajectory->filename);
+    if (fail == 0) {
+      trajectory->frameIndex = trajectory->binaryTraj.frameIndex();
+    }
+  } else {
+    fail = io::getFrameIndex(trajectory->filename, &trajectory->frameIndex);
+    if (fail == 0) {
+      fail = trajectory->dumpFile.open(trajectory->filename);
+    }
+  }
+  // Check to make sure that the trajectory has the frames asked for
+  if (fail == 0) {
+    trajectory->selectedFrames =
+        io::selectFrames(trajectory->frameIndex, selection);
+    if (trajectory->selectedFrames.empty() ||
+        (!config.selectByTimestep &&
+         trajectory->selectedFrames.size() < config.numCalcSteps)) {
+      std::cerr << "The trajectory " << trajectory->filename << " only has "
+                << trajectory->frameIndex.size()
+                << " frames, too few for the frames asked for.\n";
+      fail = 1;
+    }
+  }
+  if (fail == 0) {
+    fail = readFrame(*trajectory, trajectory->selectedFrames.back(), frame);
+  }
+  readers->release();
+  if (fail != 0) {
+    return 1;
+  }
+
+  // Set up the accumulations, with one histogram per pair of types
+  if (frame->nop > 0) {
+    maxType = *std::max_element(frame->type.begin(), frame->type.end());
+  }
+  trajectory->ntypes.resize(analyses.size());
+  trajectory->total.resize(analyses.size());
+  for (int ianalysis = 0; ianalysis < analyses.size(); ianalysis++) {
+    const rdf::Analysis &analysis = analyses[ianalysis];
+    trajectory->ntypes[ianalysis] = analysis.numberOfTypes(maxType);
+    rdf::initState(&trajectory->total[ianalysis], analysis.binsize,
+                   analysis.cutoff, analysis.nbin(),
+                   trajectory->ntypes[ianalysis], analysis.selection());
+  }
+
+  return 0;
+}
+
+/********************************************/ /**
+ *  Function for analysing every trajectory of a batch (see the batch
+ namespace). The trajectories are analysed with the frame selection and
+ analyses of the run settings, and the results of each are written to a
+ directory of the output directory, named after the trajectory. A trajectory
+ which cannot be read is reported, and the others are still analysed.
+ *  @param[in] config The run settings
+ *  @param[in] analyses The settings of every analysis
+ *  @param[in] trajectories The paths of the trajectories
+ *  @param[in] rank (Optional argument) The rank of this process, which
+ analyses the trajectories rank, rank + nranks, ...
+ *  @param[in] nranks (Optional argument) The number of processes
+ *  \return an int value of 0 (success) or 1 (a trajectory could not be
+ analysed)
+ ***********************************************/
+int batch::run(const io::RunConfig &config,
+               const std::vector<rdf::Analysis> &analyses,
+               const std::vector<std::string> &trajectories, int rank,
+               int nranks) {
+  // Trajectories of this rank
+  std::vector<std::unique_ptr<batch::Trajectory>> rankTrajectories;
+  io::FrameSelection selection; // Frames to be analysed
+  int nworkers = config.batchWorkers; // Threads of the pool
+  int chunk = config.batchChunk; // Frames per task
+  pipeline::Semaphore readers(config.maxReaders); // Reader slots
+  // Trajectory, first selected frame and number of frames of every task
+  std::vector<std::array<int, 3>> tasks;
+  std::vector<gen::Frame> buffers; // Frame buffer of every thread
+  std::mutex outputMutex;          // Guards writing out the results
+  int fail = 0;                    // Non-zero if anything failed
+
+  if (!config.checkpoint.empty() || config.blockFrames > 0 ||
+      config.windowFrames > 0) {
+    std::cerr << "Checkpoints, block averages and windows are not available "
+                 "in batch mode.\n";
+    return 1;
+  }
+  if (nworkers <= 0) {
+    nworkers = std::max<int>(std::thread::hardware_concurrency(), 1);
+  }
+  buffers.resize(nworkers);
+  selection.firstFrame = config.equiliSteps;
+  selection.frameStride = config.stepGap;
+  selection.maxFrames = config.selectByTimestep ? -1 : config.numCalcSteps;
+  selection.byTimestep = config.selectByTimestep;
+  selection.firstTimestep = config.firstTimestep;
+  selection.lastTimestep = config.lastTimestep;
+  selection.timestepStride = config.timestepStride;
+  if (!selection.isValid()) {
+    std::cerr << "You have entered an unfeasible number of calculation or "
+                 "equilibrium steps.\n";
+    return 1;
+  }
+
+  // The output directories are named after the trajectories, so the names
+  // must differ
+  for (int itraj = 0; itraj < trajectories.size(); itraj++) {
+    std::string name =
+        boost::filesystem::path(trajectories[itraj]).filename().string();
+    for (int iother = 0; iother < itraj; iother++) {
+      if (boost::filesystem::path(trajectories[iother]).filename().string() ==
+          name) {
+        std::cerr << "The trajectories " << trajectories[iother] << " and "
+                  << trajectories[itraj] << " have the same name.\n";
+        return 1;
+      }
+    }
+    if (itraj % nranks == rank) {
+      rankTrajectories.emplace_back(new batch::Trajectory());
+      rankTrajectories.back()->filename = trajectories[itraj];
+      rankTrajectories.back()->name = name;
+    }
+  } // end of loop through trajectories
+
+  // Index every trajectory
+  pipeline::runStealing(
+      rankTrajectories.size(),
+      [&](int iworker, int itraj) {
+        PROF_SCOPE("index");
+        batch::Trajectory *trajectory = rankTrajectories[itraj].get();
+        trajectory->fail = openTrajectory(trajectory, selection, config,
+                                          analyses, &readers,
+                                          &buffers[iworker]);
+        return trajectory->fail.load();
+      },
+      nworkers);
+
+  // Split the selected frames of every trajectory into tasks
+  for (int itraj = 0; itraj < rankTrajectories.size(); itraj++) {
+    batch::Trajectory &trajectory = *rankTrajectories[itraj]; // Current one
+    if (trajectory.fail != 0) {
+      std::cerr << "The trajectory " << trajectory.filename
+                << " could not be analysed.\n";
+      fail = 1;
+      continue;
+    }
+    for (int first = 0; first < trajectory.selectedFrames.size();
+         first += chunk) {
+      tasks.push_back(
+          {{itraj, first,
+            std::min<int>(chunk, trajectory.selectedFrames.size() - first)}});
+      trajectory.remaining++;
+    }
+  } // end of loop through trajectories
+
+  // Analyse the frames. The frames of a task are added to a scratch
+  // accumulation, which is added to the trajectory at the end
+  fail |= pipeline::runStealing(
+      tasks.size(),
+      [&](int iworker, int itask) {
+        batch::Trajectory &trajectory = *rankTrajectories[tasks[itask][0]];
+        gen::Frame &frame = buffers[iworker]; // Buffer of this thread
+        rdf::AnalysisSet scratch;             // Accumulations of the task
+        int status = 0;                       // Result of the task
+#ifdef USE_OPENMP
+        // The pool already keeps every core busy
+        omp_set_num_threads(1);
+#endif // USE_OPENMP
+        for (int ianalysis = 0; ianalysis < analyses.size(); ianalysis++) {
+          status |= scratch.add(analyses[ianalysis],
+                                trajectory.ntypes[ianalysis]);
+        }
+        for (int iframe = tasks[itask][1];
+             status == 0 && iframe < tasks[itask][1] + tasks[itask][2];
+             iframe++) {
+          readers.acquire();
+          {
+            PROF_SCOPE("read");
+            status = readFrame(trajectory, trajectory.selectedFrames[iframe],
+                               &frame);
+          }
+          readers.release();
+          PROF_COUNT(framesRead, status == 0);
+          if (status == 0) {
+            PROF_SCOPE("accumulate");
+            status = scratch.addFrame(frame);
+          }
+        } // end of loop through frames
+        if (status != 0) {
+          trajectory.fail = 1;
+        } else {
+          PROF_SCOPE("merge");
+          std::lock_guard<std::mutex> lock(trajectory.mutex);
+          for (int ianalysis = 0; ianalysis < analyses.size(); ianalysis++) {
+            rdf::mergeState(&trajectory.total[ianalysis],
+                            scratch[ianalysis].state());
+          }
+        }
+        if (--trajectory.remaining > 0) {
+          return status;
+        }
+        // The last task of the trajectory writes out its results, and
+        // releases everything else
+        trajectory.dumpFile.close();
+        trajectory.binaryTraj.close();
+        if (trajectory.fail == 0) {
+          std::lock_guard<std::mutex> lock(outputMutex);
+          for (int ianalysis = 0; ianalysis < analyses.size(); ianalysis++) {
+            status |= io::writeResults(
+                config, analyses[ianalysis].name, trajectory.total[ianalysis],
+                rdf::BlockStats(),
+                (boost::filesystem::path(config.outputDir) / trajectory.name)
+                    .string());
+          }
+        } else {
+          std::cerr << "The trajectory " << trajectory.filename
+                    << " could not be analysed.\n";
+        }
+        std::vector<rdf::RdfState>().swap(trajectory.total);
+        std::vector<io::FrameIndexEntry>().swap(trajectory.frameIndex);
+        return status | trajectory.fail.load();
+      },
+      nworkers);
+
+  return (fail != 0) ? 1 : 0;
+}
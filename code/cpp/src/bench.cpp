@@ -0,0 +1,411 @@
+// Standard Library
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Internal Libraries
+#include <accumulator.hpp>
+#include <benchmark.hpp>
+#include <mmapReader.hpp>
+#include <neighbours.hpp>
+#include <pipeline.hpp>
+#include <rdf.hpp>
+
+/********************************************/ /**
+ *  Benchmarks the stages of the g(r) calculation on synthetic systems.
+ *
+ * Usage: yodaBench [--sizes 1000,10000,...] [--systems gas,fcc,liquid]
+ [--threads 1,2,4] [--min-time seconds] [--max-pairs n] [--scaling-size n]
+ [--frames n] [--cutoff r] [--output file] [--quick]
+ *
+ * For every system and size, parsing, the pair accumulation of every backend
+ (serial, cell list, and with OpenMP the threaded ones for every thread count)
+ and the normalization are timed separately. Strong and weak scaling curves are
+ measured at the scaling size: over frames for the compute workers of the
+ pipeline, which are always available, and over the atoms of a frame for the
+ OpenMP threads. Brute-force backends are left out beyond max-pairs pairs.
+ *
+ * The results are written as JSON (to stdout, or the output file), with one
+ record per measurement, while a summary is printed to stderr. The pairs per
+ second are effective: every backend is credited with all N(N-1)/2 pairs of a
+ frame, so that backends can be compared directly.
+ ***********************************************/
+int main(int argc, char *argv[]) {
+  // -------------------------------------------- // Options
+  std::vector<int> sizes = {1000, 10000, 100000, 1000000}; // Numbers of atoms
+  std::vector<std::string> systems = {"gas", "fcc", "liquid"}; // Systems
+  std::vector<int> threads;  // Thread counts for the scaling curves
+  double minTime = 0.5;      // Minimum time spent on each measurement
+  double maxPairs = 5e9;     // Largest brute-force pass
+  int scalingSize = 100000;  // Number of atoms for the scaling curves
+  int framesPerWorker = 4;   // Frames per worker for the pipeline curves
+  double cutoff = 10;        // Cutoff of the g(r)
+  double binsize = 0.01;     // Bin width
+  std::string outputFile = ""; // JSON output; empty for stdout
+  // -------------------------------------------- // Variables
+  std::string option;        // Current option
+  int nbin;                  // Number of bins
+  int maxThreads;            // Largest thread count
+  gen::Frame frame;          // Synthetic system
+  gen::Frame parsed;         // Frame parsed back in
+  std::vector<uint64_t> hist; // Histogram being accumulated into
+  nlist::CellList threadCells; // Cell list rebuilt by the threaded pass
+  bench::Timing timing;      // Result of the current measurement
+  std::ostringstream records; // JSON records
+  int nrecords = 0;          // Number of JSON records
+  // -------------------------------------------- // Main logic
+
+  for (int t = 1; t <= std::max(1u, std::thread::hardware_concurrency());
+       t *= 2) {
+    threads.push_back(t);
+  }
+  // Read in the options
+  try {
+    for (int iarg = 1; iarg < argc; iarg++) {
+      option = argv[iarg];
+      bool hasValue = (iarg + 1 < argc); // An argument follows
+      if (option == "--quick") {
+        sizes = {1000, 8000};
+        systems = {"liquid"};
+        minTime = 0.05;
+        scalingSize = 8000;
+        framesPerWorker = 2;
+      } else if (option == "--sizes" && hasValue) {
+        sizes.clear();
+        for (const std::string &item : bench::splitList(argv[++iarg])) {
+          sizes.push_back(std::stoi(item));
+        }
+      } else if (option == "--systems" && hasValue) {
+        systems = bench::splitList(argv[++iarg]);
+      } else if (option == "--threads" && hasValue) {
+        threads.clear();
+        for (const std::string &item : bench::splitList(argv[++iarg])) {
+          threads.push_back(std::stoi(item));
+        }
+      } else if (option == "--min-time" && hasValue) {
+        minTime = std::stod(argv[++iarg]);
+      } else if (option == "--max-pairs" && hasValue) {
+        maxPairs = std::stod(argv[++iarg]);
+      } else if (option == "--scaling-size" && hasValue) {
+        scalingSize = std::stoi(argv[++iarg]);
+      } else if (option == "--frames" && hasValue) {
+        framesPerWorker = std::stoi(argv[++iarg]);
+      } else if (option == "--cutoff" && hasValue) {
+        cutoff = std::stod(argv[++iarg]);
+      } else if (option == "--output" && hasValue) {
+        outputFile = argv[++iarg];
+      } else {
+        std::cerr << "Unknown option " << option << "\n";
+        return 1;
+      }
+    }
+  } catch (const std::exception &) {
+    std::cerr << "Invalid value for the option " << option << "\n";
+    return 1;
+  }
+  for (int t : threads) {
+    if (t < 1) {
+      std::cerr << "Thread counts must be at least 1.\n";
+      return 1;
+    }
+  }
+  if (sizes.empty() || systems.empty() || threads.empty() || cutoff <= 0 ||
+      framesPerWorker < 1) {
+    std::cerr << "Nothing to benchmark with these options.\n";
+    return 1;
+  }
+#ifndef __OPTIMIZE__
+  std::cerr << "Warning: yodaBench was built without optimization; build with "
+               "-DCMAKE_BUILD_TYPE=Release for meaningful timings.\n";
+#endif // __OPTIMIZE__
+  std::sort(threads.begin(), threads.end());
+  maxThreads = threads.back();
+  nbin = (int)(cutoff / binsize) + 1;
+  hist.assign(nbin, 0);
+
+  // Adds a record to the JSON output, and a line to the summary
+  auto record = [&](const std::string &test, const std::string &system,
+                    int natoms, const std::string &backend, int nthreads,
+                    int nframes, const bench::Timing &result, double pairs,
+                    double efficiency) {
+    double pairsPerSecond = (pairs > 0) ? pairs / result.seconds : 0;
+    records << (nrecords++ ? ",\n" : "") << "    {\"test\": \"" << test
+            << "\", \"system\": \"" << system << "\", \"natoms\": " << natoms
+            << ", \"backend\": \"" << backend << "\", \"threads\": "
+            << nthreads << ", \"frames\": " << nframes
+            << ", \"reps\": " << result.reps
+            << ", \"seconds\": " << result.seconds
+            << ", \"pairs\": " << pairs
+            << ", \"pairsPerSecond\": " << pairsPerSecond
+            << ", \"efficiency\": " << efficiency << "}";
+    fprintf(stderr,
+            "%-10s %-7s %8d %-15s %3d thr %4d fr  %11.4e s  %10.3e pairs/s\n",
+            test.c_str(), system.c_str(), natoms, backend.c_str(), nthreads,
+            nframes, result.seconds, pairsPerSecond);
+  };
+
+  // Times nframes frames through the pipeline with nworkers compute workers,
+  // using the cell list whenever the box allows it
+  auto timePipeline = [&](const gen::Frame &base, int nframes, int nworkers,
+                          bench::Timing *result) {
+#ifdef USE_OPENMP
+    // Each worker runs on one thread
+    omp_set_num_threads(1);
+#endif // USE_OPENMP
+    // Accumulator of every worker
+    std::vector<rdf::RdfAccumulator> workers(
+        nworkers, rdf::RdfAccumulator(binsize, cutoff));
+    return bench::timeIt(
+        [&]() {
+          return pipeline::run(
+              nframes,
+              [&](int /*itask*/, gen::Frame *buffer) {
+                *buffer = base;
+                return 0;
+              },
+              [&](int iworker, const gen::Frame &buffer) {
+                return workers[iworker].addFrame(buffer);
+              },
+              nworkers);
+        },
+        minTime, result);
+  };
+
+#ifdef USE_OPENMP
+  // Times the OpenMP pass over a frame with nthreads threads
+  auto timeThreaded = [&](const gen::Frame &base, int nthreads,
+                          bool useCellList, bench::Timing *result) {
+    omp_set_num_threads(nthreads);
+    return bench::timeIt(
+        [&]() {
+          if (useCellList &&
+              nlist::buildCellList(&threadCells, base, cutoff) != 0) {
+            return 1;
+          }
+          return rdf::accumulateThreaded(hist.data(), binsize, nbin, base,
+                                         cutoff, 1,
+                                         useCellList ? &threadCells : nullptr);
+        },
+        minTime, result);
+  };
+#endif // USE_OPENMP
+
+  // ---------------------------
+  // Stages, for every system and size
+  for (const std::string &system : systems) {
+    for (int natoms : sizes) {
+      if (bench::makeSystem(&frame, system, natoms) != 0) {
+        return 1;
+      }
+      double pairs = bench::numberOfPairs(frame.nop); // Pairs of a frame
+      bool brute = (pairs <= maxPairs);               // Brute force allowed
+      bool cells = nlist::isUsable(frame.box, cutoff); // Cell list allowed
+      if (2 * cutoff > frame.box[0]) {
+        std::cerr << "Skipping " << system << " with " << frame.nop
+                  << " atoms: the box is smaller than twice the cutoff.\n";
+        continue;
+      }
+
+      // Parsing
+      std::string text = bench::formatFrame(frame); // Frame as text
+      if (bench::timeIt(
+              [&]() {
+                const char *cursor = text.data();
+                return io::parseFrame(&cursor, text.data() + text.size(),
+                                      &parsed);
+              },
+              minTime, &timing) != 0) {
+        return 1;
+      }
+      record("parse", system, frame.nop, "text", 1, 1, timing, 0, 1);
+
+      // Pair accumulation
+      if (brute) {
+        if (bench::timeIt(
+                [&]() {
+                  return rdf::accumulatePairs(hist.data(), binsize, nbin, frame,
+                                              cutoff, 1, 0, frame.nop);
+                },
+                minTime, &timing) != 0) {
+          return 1;
+        }
+        record("accumulate", system, frame.nop, "serial", 1, 1, timing, pairs,
+               1);
+      }
+      if (cells) {
+        if (bench::timeIt(
+                [&]() {
+                  return rdf::accumulateCellList(hist.data(), binsize, nbin, frame,
+                                                 cutoff, 1);
+                },
+                minTime, &timing) != 0) {
+          return 1;
+        }
+        record("accumulate", system, frame.nop, "cells", 1, 1, timing, pairs,
+               1);
+        if (bench::timeIt(
+                [&]() {
+                  return rdf::accumulateCellList(hist.data(), binsize, nbin, frame,
+                                                 cutoff, 1, true);
+                },
+                minTime, &timing) != 0) {
+          return 1;
+        }
+        record("accumulate", system, frame.nop, "cells-float32", 1, 1, timing,
+               pairs, 1);
+      }
+#ifdef USE_OPENMP
+      for (int nthreads : threads) {
+        if (brute) {
+          if (timeThreaded(frame, nthreads, false, &timing) != 0) {
+            return 1;
+          }
+          record("accumulate", system, frame.nop, "threaded", nthreads, 1,
+                 timing, pairs, 1);
+        }
+        if (cells) {
+          if (timeThreaded(frame, nthreads, true, &timing) != 0) {
+            return 1;
+          }
+          record("accumulate", system, frame.nop, "threaded-cells", nthreads,
+                 1, timing, pairs, 1);
+        }
+      }
+#endif // USE_OPENMP
+
+      // Normalization
+      rdf::RdfAccumulator accumulator(binsize, cutoff); // One frame
+      if (accumulator.addFrame(frame) != 0) {
+        return 1;
+      }
+      if (bench::timeIt(
+              [&]() {
+                std::vector<double> rdf = accumulator.result();
+                return (rdf.empty()) ? 1 : 0;
+              },
+              minTime, &timing) != 0) {
+        return 1;
+      }
+      record("normalize", system, frame.nop, "serial", 1, 1, timing, 0, 1);
+    } // end of loop through sizes
+  }   // end of loop through systems
+
+  // ---------------------------
+  // Strong and weak scaling curves at the scaling size. The efficiency is
+  // relative to the smallest thread count
+  for (const std::string &system : systems) {
+    bench::Timing base; // Timing with the smallest thread count
+    if (bench::makeSystem(&frame, system, scalingSize) != 0) {
+      return 1;
+    }
+    if (2 * cutoff > frame.box[0]) {
+      continue;
+    }
+    double pairs = bench::numberOfPairs(frame.nop); // Pairs of a frame
+
+    // Compute workers of the pipeline, over frames
+    int nstrong = framesPerWorker * maxThreads; // Frames of the strong curve
+    for (int nthreads : threads) {
+      if (timePipeline(frame, nstrong, nthreads, &timing) != 0) {
+        return 1;
+      }
+      if (nthreads == threads.front()) {
+        base = timing;
+      }
+      record("strong", system, frame.nop, "pipeline", nthreads, nstrong,
+             timing, pairs * nstrong,
+             base.seconds * threads.front() / (timing.seconds * nthreads));
+    }
+    for (int nthreads : threads) {
+      int nweak = framesPerWorker * nthreads; // Frames of the weak curve
+      if (timePipeline(frame, nweak, nthreads, &timing) != 0) {
+        return 1;
+      }
+      if (nthreads == threads.front()) {
+        base = timing;
+      }
+      record("weak", system, frame.nop, "pipeline", nthreads, nweak, timing,
+             pairs * nweak, base.seconds / timing.seconds);
+    }
+
+#ifdef USE_OPENMP
+    // OpenMP threads, over the atoms of a frame; the weak curve grows the
+    // system with the number of threads, up to the scaling size
+    bool useCellList = nlist::isUsable(frame.box, cutoff); // Backend used
+    std::string backend = useCellList ? "threaded-cells" : "threaded";
+    for (int nthreads : threads) {
+      if (timeThreaded(frame, nthreads, useCellList, &timing) != 0) {
+        return 1;
+      }
+      if (nthreads == threads.front()) {
+        base = timing;
+      }
+      record("strong", system, frame.nop, backend, nthreads, 1, timing, pairs,
+             base.seconds * threads.front() / (timing.seconds * nthreads));
+    }
+    double baseRate = 0; // Seconds per unit of work of the first point
+    for (int nthreads : threads) {
+      gen::Frame grown; // System with atoms in proportion to the threads
+      int ngrown = (int)((long long)scalingSize * nthreads / maxThreads);
+      if (bench::makeSystem(&grown, system, ngrown) != 0) {
+        return 1;
+      }
+      if (2 * cutoff > grown.box[0] ||
+          nlist::isUsable(grown.box, cutoff) != useCellList) {
+        continue;
+      }
+      if (timeThreaded(grown, nthreads, useCellList, &timing) != 0) {
+        return 1;
+      }
+      // The work of a cell-list pass grows with the number of atoms, and that
+      // of a brute-force pass with the number of pairs
+      double work = useCellList ? (double)grown.nop / nthreads
+                                : bench::numberOfPairs(grown.nop) / nthreads;
+      if (baseRate == 0) {
+        baseRate = timing.seconds / work;
+      }
+      record("weak", system, grown.nop, backend, nthreads, 1, timing,
+             bench::numberOfPairs(grown.nop), baseRate * work / timing.seconds);
+    }
+#endif // USE_OPENMP
+  } // end of loop through systems
+
+  // ---------------------------
+  // Write out the JSON
+  std::ofstream outFile; // Output file, if any
+  if (!outputFile.empty()) {
+    outFile.open(outputFile);
+    if (!outFile.is_open()) {
+      std::cerr << "Could not open " << outputFile << " for writing.\n";
+      return 1;
+    }
+  }
+  std::ostream &out = outputFile.empty() ? std::cout : outFile;
+  out << "{\n  \"benchmark\": \"yodaBench\",\n";
+#ifdef USE_OPENMP
+  out << "  \"openmp\": true,\n";
+#else
+  out << "  \"openmp\": false,\n";
+#endif // USE_OPENMP
+#ifdef __OPTIMIZE__
+  out << "  \"optimized\": true,\n";
+#else
+  out << "  \"optimized\": false,\n";
+#endif // __OPTIMIZE__
+#if defined(__AVX512F__)
+  out << "  \"simd\": \"avx512\",\n";
+#elif defined(__AVX2__)
+  out << "  \"simd\": \"avx2\",\n";
+#else
+  out << "  \"simd\": \"scalar\",\n";
+#endif
+  out << "  \"hardwareThreads\": " << std::thread::hardware_concurrency()
+      << ",\n  \"cutoff\": " << cutoff << ",\n  \"binsize\": " << binsize
+      << ",\n  \"results\": [\n"
+      << records.str() << "\n  ]\n}\n";
+
+  return out.good() ? 0 : 1;
+}
@@ -0,0 +1,138 @@
+#include <benchmark.hpp>
+
+/********************************************/ /**
+ *  Function for building a synthetic periodic system.
+ *
+ * The gas has exactly natoms particles. The lattice systems have 4n^3
+ particles for the whole number of unit cells n nearest to (natoms/4)^(1/3),
+ so frame->nop may differ from natoms. All particles are of type 1, and the
+ box starts at the origin.
+ *  @param[out] frame The frame, which is overwritten
+ *  @param[in] kind "gas", "fcc" or "liquid"
+ *  @param[in] natoms The number of particles wanted
+ *  @param[in] seed (Optional argument) Seed of the random numbers
+ *  \return an int value of 0 (success) or 1 (unknown kind of system)
+ ***********************************************/
+int bench::makeSystem(gen::Frame *frame, const std::string &kind, int natoms,
+                      unsigned seed) {
+  std::mt19937_64 rng(seed);           // Random number generator
+  double length;                       // Box length
+  int ncell;                           // Unit cells along each dimension
+  double a;                            // Lattice constant
+  int iatom = 0;                       // Current particle
+  const double basis[4][3] = {
+      {0, 0, 0}, {0.5, 0.5, 0}, {0.5, 0, 0.5}, {0, 0.5, 0.5}}; // fcc basis
+
+  if (kind == "gas") {
+    length = cbrt(natoms / bench::gasDensity);
+    std::uniform_real_distribution<double> uniform(0.0, length);
+    frame->resize(natoms);
+    for (iatom = 0; iatom < natoms; iatom++) {
+      frame->x[iatom] = uniform(rng);
+      frame->y[iatom] = uniform(rng);
+      frame->z[iatom] = uniform(rng);
+    }
+  } else if (kind == "fcc" || kind == "liquid") {
+    ncell = std::max(1, (int)lround(cbrt(natoms / 4.0)));
+    a = cbrt(4.0 / bench::liquidDensity);
+    length = ncell * a;
+    frame->resize(4 * ncell * ncell * ncell);
+    for (int i = 0; i < ncell; i++) {
+      for (int j = 0; j < ncell; j++) {
+        for (int k = 0; k < ncell; k++) {
+          for (int ib = 0; ib < 4; ib++) {
+            frame->x[iatom] = (i + basis[ib][0]) * a;
+            frame->y[iatom] = (j + basis[ib][1]) * a;
+            frame->z[iatom] = (k + basis[ib][2]) * a;
+            iatom++;
+          }
+        }
+      }
+    } // end of loop through unit cells
+    if (kind == "liquid") {
+      // Displacements of the liquid, a tenth of the lattice constant wide
+      std::normal_distribution<double> jitter(0.0, 0.1 * a);
+      for (iatom = 0; iatom < frame->nop; iatom++) {
+        frame->x[iatom] += jitter(rng);
+        frame->y[iatom] += jitter(rng);
+        frame->z[iatom] += jitter(rng);
+      }
+    }
+  } else {
+    std::cerr << "Unknown kind of system " << kind
+              << " (expected gas, fcc or liquid).\n";
+    return 1;
+  }
+
+  for (iatom = 0; iatom < frame->nop; iatom++) {
+    frame->id[iatom] = iatom + 1;
+    frame->type[iatom] = 1;
+  }
+  frame->timestep = 0;
+  frame->boxLo = {{0, 0, 0}};
+  frame->box = {{length, length, length}};
+
+  return 0;
+}
+
+/********************************************/ /**
+ *  Function for writing a frame out as a frame of a lammps trajectory, with
+ the columns id, type, x, y and z, so that parsing can be timed.
+ *  @param[in] frame The frame
+ *  \return the text of the frame
+ ***********************************************/
+std::string bench::formatFrame(const gen::Frame &frame) {
+  std::string text;  // Text of the frame
+  char line[128];    // Current line
+
+  text.reserve(48 * (std::size_t)frame.nop + 256);
+  text += "ITEM: TIMESTEP\n" + std::to_string(frame.timestep) + "\n";
+  text += "ITEM: NUMBER OF ATOMS\n" + std::to_string(frame.nop) + "\n";
+  text += "ITEM: BOX BOUNDS pp pp pp\n";
+  for (int k = 0; k < 3; k++) {
+    snprintf(line, sizeof(line), "%.16e %.16e\n", frame.boxLo[k],
+             frame.boxLo[k] + frame.box[k]);
+    text += line;
+  }
+  text += "ITEM: ATOMS id type x y z\n";
+  for (int iatom = 0; iatom < frame.nop; iatom++) {
+    snprintf(line, sizeof(line), "%d %d %f %f %f\n", frame.id[iatom],
+             frame.type[iatom], frame.x[iatom], frame.y[iatom],
+             frame.z[iatom]);
+    text += line;
+  }
+
+  return text;
+}
+
+/********************************************/ /**
+ *  Function for timing a stage. The stage is run once to warm up, and then
+ repeatedly until at least minTime seconds have passed.
+ *  @param[in] stage The stage, which returns 0 (success) or 1 (failure)
+ *  @param[in] minTime The minimum time to spend, in seconds
+ *  @param[out] timing The number of runs and mean wall time of each
+ *  \return an int value of 0 (success) or 1 (the stage failed)
+ ***********************************************/
+int bench::timeIt(const std::function<int()> &stage, double minTime,
+                  bench::Timing *timing) {
+  typedef std::chrono::steady_clock clock;
+  clock::time_point start;    // Start of the timed runs
+  double elapsed = 0;         // Time spent so far
+  int reps = 0;               // Number of timed runs
+
+  if (stage() != 0) {
+    return 1;
+  }
+  start = clock::now();
+  do {
+    if (stage() != 0) {
+      return 1;
+    }
+    reps++;
+    elapsed = std::chrono::duration<double>(clock::now() - start).count();
+  } while (elapsed < minTime);
+
+  timing->reps = reps;
+  timing->seconds = elapsed / reps;
+  return 0;
+}
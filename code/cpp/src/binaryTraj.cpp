@@ -0,0 +1,313 @@
+#include <binaryTraj.hpp>
+
+// The header and table of contents are written as they are laid out in memory
+static_assert(sizeof(io::BinaryTrajHeader) == 48,
+              "Unexpected padding in io::BinaryTrajHeader");
+static_assert(sizeof(io::BinaryTocEntry) == 104,
+              "Unexpected padding in io::BinaryTocEntry");
+
+/********************************************/ /**
+ *  Function for memory-mapping a binary trajectory file, and reading in its
+ header and table of contents. Only files of the current version of the
+ format (io::binaryTrajVersion), with a known encoding and precision, are
+ read.
+ *  @param[in] filename The path of the binary trajectory file
+ *  \return an int value of 0 (success) or 1 (error)
+ ***********************************************/
+int io::BinaryTrajectory::open(const std::string &filename) {
+  if (file_.open(filename) != 0) {
+    return 1;
+  }
+  // Check the header
+  if (file_.size() < sizeof(header_)) {
+    std::cerr << filename << " is not a binary trajectory.\n";
+    return 1;
+  }
+  memcpy(&header_, file_.data(), sizeof(header_));
+  if (memcmp(header_.magic, io::binaryTrajMagic, sizeof(header_.magic)) != 0) {
+    std::cerr << filename << " is not a binary trajectory.\n";
+    return 1;
+  }
+  if (header_.version != io::binaryTrajVersion) {
+    std::cerr << "The binary trajectory " << filename << " is of version "
+              << header_.version << ", but only version "
+              << io::binaryTrajVersion << " can be read.\n";
+    return 1;
+  }
+  if ((header_.encoding != io::BinaryEncoding::raw &&
+       header_.encoding != io::BinaryEncoding::quantized) ||
+      (header_.precision != 4 && header_.precision != 8) ||
+      (header_.encoding == io::BinaryEncoding::quantized &&
+       !(header_.quantStep > 0))) {
+    std::cerr << "The binary trajectory " << filename
+              << " has an unknown encoding or precision.\n";
+    return 1;
+  }
+  // Read in the table of contents
+  if (header_.nframes > file_.size() / sizeof(io::BinaryTocEntry) ||
+      header_.tocOffset >
+          file_.size() - header_.nframes * sizeof(io::BinaryTocEntry)) {
+    std::cerr << "The binary trajectory " << filename << " is truncated.\n";
+    return 1;
+  }
+  toc_.assign(header_.nframes, io::BinaryTocEntry());
+  memcpy(toc_.data(), file_.data() + header_.tocOffset,
+         header_.nframes * sizeof(io::BinaryTocEntry));
+
+  return 0;
+}
+
+/********************************************/ /**
+ *  Function for getting the frame index of a binary trajectory, in the same
+ form as that of a text trajectory (see io::getFrameIndex). The offsets are
+ those of the frame blocks.
+ *  \return the frame index, with one entry per frame
+ ***********************************************/
+std::vector<io::FrameIndexEntry> io::BinaryTrajectory::frameIndex() const {
+  std::vector<io::FrameIndexEntry> index(toc_.size());
+
+  for (int iframe = 0; iframe < toc_.size(); iframe++) {
+    index[iframe].offset = toc_[iframe].offset;
+    index[iframe].timestep = toc_[iframe].timestep;
+    index[iframe].nop = toc_[iframe].nop;
+    for (int k = 0; k < 3; k++) {
+      index[iframe].boxLo[k] = toc_[iframe].boxLo[k];
+      index[iframe].box[k] = toc_[iframe].box[k];
+      index[iframe].tilt[k] = toc_[iframe].tilt[k];
+    }
+  }
+
+  return index;
+}
+
+/********************************************/ /**
+ *  Function for reading in a frame of a binary trajectory into a reusable
+ frame. Raw blocks are copied straight out of the memory map; quantized blocks
+ are decoded.
+ *  @param[in] iframe The frame to be read in (starting from 0)
+ *  @param[in, out] frame The frame, which is overwritten
+ *  \return an int value of 0 (success) or 1 (error)
+ ***********************************************/
+int io::BinaryTrajectory::readFrame(int iframe, gen::Frame *frame) const {
+  const char *block;          // Start of the frame block
+  const unsigned char *ptr;   // Current position in a quantized block
+  const unsigned char *end;   // End of a quantized block
+  int64_t value;              // Integer read from a quantized block
+  int nop;                    // Number of atoms
+  uint64_t minBlockSize;      // Smallest block size per atom
+  double *coord[3];           // Coordinate arrays of the frame
+  int64_t id = 0;             // Previous atom ID
+
+  if (iframe < 0 || iframe >= toc_.size() ||
+      toc_[iframe].blockSize > file_.size() ||
+      toc_[iframe].offset > file_.size() - toc_[iframe].blockSize) {
+    std::cerr << "Frame " << iframe << " is not in the binary trajectory.\n";
+    return 1;
+  }
+  const io::BinaryTocEntry &entry = toc_[iframe]; // Entry of the frame
+  // A raw block holds all its arrays; a quantized one at least a byte for
+  // each of the 5 integers of every atom
+  if (header_.encoding == io::BinaryEncoding::raw) {
+    minBlockSize = 2 * sizeof(int32_t) + 3 * header_.precision;
+  } else {
+    minBlockSize = 5;
+  }
+  if (entry.nop < 0 || entry.nop > INT32_MAX ||
+      entry.blockSize < minBlockSize * entry.nop) {
+    std::cerr << "Frame " << iframe
+              << " of the binary trajectory is corrupt.\n";
+    return 1;
+  }
+  nop = entry.nop;
+  PROF_COUNT(bytesParsed, entry.blockSize);
+
+  frame->timestep = entry.timestep;
+  for (int k = 0; k < 3; k++) {
+    frame->boxLo[k] = entry.boxLo[k];
+    frame->box[k] = entry.box[k];
+    frame->tilt[k] = entry.tilt[k];
+  }
+  frame->resize(nop);
+  coord[0] = frame->x.data();
+  coord[1] = frame->y.data();
+  coord[2] = frame->z.data();
+  block = file_.data() + entry.offset;
+
+  // ---------------------------
+  // Raw blocks
+  if (header_.encoding == io::BinaryEncoding::raw) {
+    memcpy(frame->id.data(), block, nop * sizeof(int32_t));
+    block += nop * sizeof(int32_t);
+    memcpy(frame->type.data(), block, nop * sizeof(int32_t));
+    block += nop * sizeof(int32_t);
+    for (int k = 0; k < 3; k++) {
+      if (header_.precision == 8) {
+        memcpy(coord[k], block, nop * sizeof(double));
+      } else {
+        // Widen float32 to double
+        const float *values = reinterpret_cast<const float *>(block);
+        for (int iatom = 0; iatom < nop; iatom++) {
+          coord[k][iatom] = values[iatom];
+        }
+      }
+      block += nop * header_.precision;
+    }
+    return 0;
+  }
+  // ---------------------------
+  // Quantized blocks
+  ptr = reinterpret_cast<const unsigned char *>(block);
+  end = ptr + entry.blockSize;
+  // The IDs, types, then x, y and z of every atom
+  for (int icolumn = 0; icolumn < 5; icolumn++) {
+    for (int iatom = 0; iatom < nop; iatom++) {
+      if (io::getVarint(&ptr, end, &value) != 0) {
+        std::cerr << "Frame " << iframe
+                  << " of the binary trajectory is corrupt.\n";
+        return 1;
+      }
+      if (icolumn == 0) {
+        id += value;
+        frame->id[iatom] = id;
+      } else if (icolumn == 1) {
+        frame->type[iatom] = value;
+      } else {
+        coord[icolumn - 2][iatom] =
+            entry.boxLo[icolumn - 2] + header_.quantStep * value;
+      }
+    }
+  }
+
+  return 0;
+}
+
+/********************************************/ /**
+ *  Function for converting a text lammps trajectory into a binary trajectory.
+ *
+ * The text trajectory is indexed and memory-mapped, and every frame is parsed
+ and written out as a frame block, followed by the table of contents. The
+ header is written last, once the number of frames and the offset of the table
+ of contents are known.
+ *  @param[in] inputFile The path of the text lammps trajectory file
+ *  @param[in] outputFile The path of the binary trajectory file
+ *  @param[in] precision (Optional argument) Bytes per raw coordinate, 4
+ (float32, the default) or 8 (float64)
+ *  @param[in] encoding (Optional argument) The encoding of the frame blocks
+ *  @param[in] quantStep (Optional argument) The quantization step, for the
+ quantized encoding. Coordinates are written with an error of at most half of
+ this
+ *  \return an int value of 0 (success) or 1 (error)
+ ***********************************************/
+int io::convertToBinary(std::string inputFile, std::string outputFile,
+                        uint32_t precision, io::BinaryEncoding encoding,
+                        double quantStep) {
+  std::vector<io::FrameIndexEntry> frameIndex; // Index of the text trajectory
+  io::MappedFile dumpFile;                     // Map of the text trajectory
+  std::ofstream outFile;                       // Binary trajectory
+  io::BinaryTrajHeader header;                 // Header of the output
+  std::vector<io::BinaryTocEntry> toc;         // Table of contents
+  io::BinaryTocEntry tocEntry;                 // Entry of the current frame
+  gen::Frame frame;                            // Current frame
+  const char *cursor;                          // Position in the trajectory
+  std::vector<unsigned char> buffer;           // Current frame block
+  std::vector<float> values;                   // Coordinates as float32
+  uint64_t offset;                             // Offset of the current block
+
+  if (precision != 4 && precision != 8) {
+    std::cerr << "The precision must be 4 (float32) or 8 (float64) bytes.\n";
+    return 1;
+  }
+  if (encoding == io::BinaryEncoding::quantized && !(quantStep > 0)) {
+    std::cerr << "The quantization step must be positive.\n";
+    return 1;
+  }
+  if (io::getFrameIndex(inputFile, &frameIndex) != 0 ||
+      dumpFile.open(inputFile) != 0) {
+    return 1;
+  }
+  outFile.open(outputFile, std::ios::binary);
+  if (!outFile.is_open()) {
+    std::cerr << "Could not open " << outputFile << " for writing.\n";
+    return 1;
+  }
+
+  // Leave room for the header
+  memcpy(header.magic, io::binaryTrajMagic, sizeof(header.magic));
+  header.precision = precision;
+  header.encoding = encoding;
+  header.quantStep = quantStep;
+  outFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  offset = sizeof(header);
+
+  // Loop through all the frames
+  for (const auto &entry : frameIndex) {
+    cursor = dumpFile.data() + entry.offset;
+    if (io::parseFrame(&cursor, dumpFile.end(), &frame) != 0) {
+      return 1;
+    }
+    const double *coord[3] = {frame.x.data(), frame.y.data(), frame.z.data()};
+
+    // Fill the frame block
+    buffer.clear();
+    if (encoding == io::BinaryEncoding::raw) {
+      auto append = [&buffer](const void *data, std::size_t bytes) {
+        const unsigned char *start = static_cast<const unsigned char *>(data);
+        buffer.insert(buffer.end(), start, start + bytes);
+      };
+      append(frame.id.data(), frame.nop * sizeof(int32_t));
+      append(frame.type.data(), frame.nop * sizeof(int32_t));
+      for (int k = 0; k < 3; k++) {
+        if (precision == 8) {
+          append(coord[k], frame.nop * sizeof(double));
+        } else {
+          values.assign(coord[k], coord[k] + frame.nop);
+          append(values.data(), frame.nop * sizeof(float));
+        }
+      }
+    } else {
+      int64_t id = 0; // Previous atom ID
+      for (int iatom = 0; iatom < frame.nop; iatom++) {
+        io::putVarint(frame.id[iatom] - id, &buffer);
+        id = frame.id[iatom];
+      }
+      for (int iatom = 0; iatom < frame.nop; iatom++) {
+        io::putVarint(frame.type[iatom], &buffer);
+      }
+      for (int k = 0; k < 3; k++) {
+        for (int iatom = 0; iatom < frame.nop; iatom++) {
+          io::putVarint(llround((coord[k][iatom] - frame.boxLo[k]) / quantStep),
+                        &buffer);
+        }
+      }
+    }
+    outFile.write(reinterpret_cast<const char *>(buffer.data()),
+                  buffer.size());
+
+    // Add to the table of contents
+    tocEntry.offset = offset;
+    tocEntry.blockSize = buffer.size();
+    tocEntry.timestep = frame.timestep;
+    tocEntry.nop = frame.nop;
+    for (int k = 0; k < 3; k++) {
+      tocEntry.boxLo[k] = frame.boxLo[k];
+      tocEntry.box[k] = frame.box[k];
+      tocEntry.tilt[k] = frame.tilt[k];
+    }
+    toc.push_back(tocEntry);
+    offset += buffer.size();
+  } // end of loop through frames
+
+  // Write the table of contents, and then the header
+  outFile.write(reinterpret_cast<const char *>(toc.data()),
+                toc.size() * sizeof(io::BinaryTocEntry));
+  header.nframes = toc.size();
+  header.tocOffset = offset;
+  outFile.seekp(0);
+  outFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+  if (!outFile.good()) {
+    std::cerr << "Could not write " << outputFile << "\n";
+    return 1;
+  }
+  return 0;
+}
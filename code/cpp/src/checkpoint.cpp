@@ -0,0 +1,120 @@
+#include <checkpoint.hpp>
+
+// The header is written as it is laid out in memory
+static_assert(sizeof(io::CheckpointHeader) == 88,
+              "Unexpected padding in io::CheckpointHeader");
+
+/********************************************/ /**
+ *  Function for writing an accumulation state to a checkpoint file.
+ *
+ * The checkpoint is written to filename.tmp, which then replaces the file, so
+ that an existing checkpoint is never left half-written.
+ *  @param[in] filename The path of the checkpoint file
+ *  @param[in] state The accumulation state
+ *  \return an int value of 0 (success) or 1 (error)
+ ***********************************************/
+int io::writeCheckpoint(const std::string &filename,
+                        const rdf::RdfState &state) {
+  std::string tmpFile = filename + ".tmp"; // Written first, then renamed
+  std::ofstream outFile;                   // Checkpoint being written
+  io::CheckpointHeader header;             // Header of the file
+  PROF_SCOPE("checkpoint");
+
+  memcpy(header.magic, io::checkpointMagic, sizeof(header.magic));
+  header.nbin = state.nbin;
+  header.ntypes = state.ntypes;
+  header.nframes = state.nframes;
+  header.binsize = state.binsize;
+  header.cutoff = state.cutoff;
+  header.sumVolume = state.sumVolume;
+  header.lastTimestep = state.lastTimestep;
+  header.lastOffset = state.lastOffset;
+  header.ncounts = state.sumCount.size() + state.sumSelected.size();
+  header.nvalues = state.histogram.size();
+  header.selectionSize = state.selection.size();
+
+  outFile.open(tmpFile, std::ios::binary);
+  if (!outFile.is_open()) {
+    std::cerr << "Could not open " << tmpFile << " for writing.\n";
+    return 1;
+  }
+  outFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  outFile.write(state.selection.data(), state.selection.size());
+  outFile.write(reinterpret_cast<const char *>(state.sumCount.data()),
+                state.sumCount.size() * sizeof(double));
+  outFile.write(reinterpret_cast<const char *>(state.sumSelected.data()),
+                state.sumSelected.size() * sizeof(double));
+  outFile.write(reinterpret_cast<const char *>(state.histogram.data()),
+                state.histogram.size() * sizeof(uint64_t));
+  outFile.close();
+  if (!outFile.good() || rename(tmpFile.c_str(), filename.c_str()) != 0) {
+    std::cerr << "Could not write the checkpoint " << filename << "\n";
+    return 1;
+  }
+
+  return 0;
+}
+
+/********************************************/ /**
+ *  Function for reading an accumulation state from a checkpoint file, of
+ the current version of the format (io::checkpointVersion).
+ *  @param[in] filename The path of the checkpoint file
+ *  @param[out] state The accumulation state, which is overwritten
+ *  \return an int value of 0 (success) or 1 (error)
+ ***********************************************/
+int io::readCheckpoint(const std::string &filename, rdf::RdfState *state) {
+  std::ifstream inFile(filename, std::ios::binary); // Checkpoint
+  io::CheckpointHeader header;                      // Header of the file
+  std::string selection;                            // Selections, if any
+
+  if (!inFile.is_open()) {
+    std::cerr << "Could not open the checkpoint " << filename << "\n";
+    return 1;
+  }
+  if (!inFile.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+      memcmp(header.magic, io::checkpointMagic, sizeof(header.magic)) != 0) {
+    std::cerr << filename << " is not a checkpoint file.\n";
+    return 1;
+  }
+  if (header.version != io::checkpointVersion) {
+    std::cerr << "The checkpoint " << filename << " is of version "
+              << header.version << ", but only version "
+              << io::checkpointVersion << " can be read.\n";
+    return 1;
+  }
+  // The sizes must match the settings
+  if (header.nbin <= 0 || header.ntypes < 1 || header.nframes < 0 ||
+      header.selectionSize > io::maxSelectionSize) {
+    std::cerr << "The checkpoint " << filename << " is corrupt.\n";
+    return 1;
+  }
+  selection.resize(header.selectionSize);
+  if (!inFile.read(&selection[0], selection.size())) {
+    std::cerr << "The checkpoint " << filename << " is truncated.\n";
+    return 1;
+  }
+  rdf::initState(state, header.binsize, header.cutoff, header.nbin,
+                 header.ntypes, selection);
+  if (header.ncounts !=
+          state->sumCount.size() + state->sumSelected.size() ||
+      header.nvalues != state->histogram.size()) {
+    std::cerr << "The checkpoint " << filename << " is corrupt.\n";
+    return 1;
+  }
+  state->nframes = header.nframes;
+  state->sumVolume = header.sumVolume;
+  state->lastTimestep = header.lastTimestep;
+  state->lastOffset = header.lastOffset;
+  inFile.read(reinterpret_cast<char *>(state->sumCount.data()),
+              state->sumCount.size() * sizeof(double));
+  inFile.read(reinterpret_cast<char *>(state->sumSelected.data()),
+              state->sumSelected.size() * sizeof(double));
+  inFile.read(reinterpret_cast<char *>(state->histogram.data()),
+              header.nvalues * sizeof(uint64_t));
+  if (!inFile) {
+    std::cerr << "The checkpoint " << filename << " is truncated.\n";
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,584 @@
+#include <config.hpp>
+
+/********************************************/ /**
+ *  Function for reading a whole number from the value of a setting.
+ *  @param[in] key The key of the setting, for the error message
+ *  @param[in] value The value, as read in
+ *  @param[out] number The number
+ *  \return an int value of 0 (success) or 1 (not a whole number)
+ ***********************************************/
+static int toNumber(const std::string &key, const std::string &value,
+                    long long *number) {
+  size_t length = 0; // Characters read
+
+  try {
+    *number = std::stoll(value, &length);
+  } catch (const std::exception &) {
+    length = 0;
+  }
+  if (length == 0 || length != value.size()) {
+    std::cerr << "The value '" << value << "' of " << key
+              << " is not a whole number.\n";
+    return 1;
+  }
+  return 0;
+}
+
+/********************************************/ /**
+ *  Function for reading a real number from the value of a setting.
+ *  @param[in] key The key of the setting, for the error message
+ *  @param[in] value The value, as read in
+ *  @param[out] number The number
+ *  \return an int value of 0 (success) or 1 (not a number)
+ ***********************************************/
+static int toNumber(const std::string &key, const std::string &value,
+                    double *number) {
+  size_t length = 0; // Characters read
+
+  try {
+    *number = std::stod(value, &length);
+  } catch (const std::exception &) {
+    length = 0;
+  }
+  if (length == 0 || length != value.size()) {
+    std::cerr << "The value '" << value << "' of " << key
+              << " is not a number.\n";
+    return 1;
+  }
+  return 0;
+}
+
+/********************************************/ /**
+ *  Function for reading an int from the value of a setting.
+ *  @param[in] key The key of the setting, for the error message
+ *  @param[in] value The value, as read in
+ *  @param[out] number The number
+ *  \return an int value of 0 (success) or 1 (not a whole number)
+ ***********************************************/
+static int toNumber(const std::string &key, const std::string &value,
+                    int *number) {
+  long long wide; // Number, before narrowing
+
+  if (toNumber(key, value, &wide) != 0) {
+    return 1;
+  }
+  *number = (int)wide;
+  return 0;
+}
+
+/********************************************/ /**
+ *  Function for reading a whole number from the value of a setting, which must
+ be at least a minimum.
+ *  @param[in] key The key of the setting, for the error message
+ *  @param[in] value The value, as read in
+ *  @param[out] number The number
+ *  @param[in] minimum The smallest value allowed
+ *  \return an int value of 0 (success) or 1 (not a whole number, or too small)
+ ***********************************************/
+template <typename T>
+static int toNumber(const std::string &key, const std::string &value,
+                    T *number, T minimum) {
+  if (toNumber(key, value, number) != 0) {
+    return 1;
+  }
+  if (*number < minimum) {
+    std::cerr << "The value " << *number << " of " << key
+              << " must be at least " << minimum << ".\n";
+    return 1;
+  }
+  return 0;
+}
+
+/********************************************/ /**
+ *  Function for reading a switch (true, false, yes, no, on, off, 1 or 0) from
+ the value of a setting.
+ *  @param[in] key The key of the setting, for the error message
+ *  @param[in] value The value, as read in
+ *  @param[out] flag The switch
+ *  \return an int value of 0 (success) or 1 (not a switch)
+ ***********************************************/
+static int toNumber(const std::string &key, const std::string &value,
+                    bool *flag) {
+  if (value == "true" || value == "yes" || value == "on" || value == "1") {
+    *flag = true;
+  } else if (value == "false" || value == "no" || value == "off" ||
+             value == "0") {
+    *flag = false;
+  } else {
+    std::cerr << "The value '" << value << "' of " << key
+              << " is not true or false.\n";
+    return 1;
+  }
+  return 0;
+}
+
+/********************************************/ /**
+ *  Function for trimming the blanks off both ends of a string.
+ *  @param[in] text The string
+ ***********************************************/
+static std::string trim(const std::string &text) {
+  size_t first = text.find_first_not_of(" \t\r\n"); // First non-blank
+  size_t last = text.find_last_not_of(" \t\r\n");   // Last non-blank
+
+  if (first == std::string::npos) {
+    return "";
+  }
+  return text.substr(first, last - first + 1);
+}
+
+/********************************************/ /**
+ *  Function for setting a setting of an analysis from its key: binsize,
+ cutoff, partialRdf, singlePrecision, reference or target (the selections are
+ parsed, see sel::parseSelection).
+ *  @param[in, out] analysis The settings of the analysis
+ *  @param[in] key The key of the setting
+ *  @param[in] value The value of the setting, as read in
+ *  \return an int value of 0 (success), 1 (invalid value) or -1 (not a key of
+ an analysis)
+ ***********************************************/
+int io::setAnalysisOption(rdf::Analysis *analysis, const std::string &key,
+                          const std::string &value) {
+  if (key == "binsize") {
+    if (toNumber(key, value, &analysis->binsize) != 0) {
+      return 1;
+    }
+    if (analysis->binsize <= 0) {
+      std::cerr << "The bin size must be positive.\n";
+      return 1;
+    }
+  } else if (key == "cutoff") {
+    if (toNumber(key, value, &analysis->cutoff) != 0) {
+      return 1;
+    }
+    if (analysis->cutoff <= 0) {
+      std::cerr << "The cutoff must be positive.\n";
+      return 1;
+    }
+  } else if (key == "partialRdf") {
+    return toNumber(key, value, &analysis->partialRdf);
+  } else if (key == "singlePrecision") {
+    return toNumber(key, value, &analysis->singlePrecision);
+  } else if (key == "reference") {
+    analysis->referenceExpression = value;
+    return sel::parseSelection(value, &analysis->reference);
+  } else if (key == "target") {
+    analysis->targetExpression = value;
+    return sel::parseSelection(value, &analysis->target);
+  } else {
+    return -1;
+  }
+  return 0;
+}
+
+/********************************************/ /**
+ *  Function for setting a global setting from its key, which is the name of
+ the member of io::RunConfig. The settings of an analysis set the defaults of
+ every analysis.
+ *  @param[in, out] config The run settings
+ *  @param[in] key The key of the setting
+ *  @param[in] value The value of the setting, as read in
+ *  \return an int value of 0 (success) or 1 (unknown key or invalid value)
+ ***********************************************/
+int io::setOption(io::RunConfig *config, const std::string &key,
+                  const std::string &value) {
+  int status = io::setAnalysisOption(&config->defaults, key, value); // Result
+
+  if (status >= 0) {
+    return status;
+  }
+  if (key == "trajectory") {
+    config->trajectory = value;
+  } else if (key == "numCalcSteps") {
+    return toNumber(key, value, &config->numCalcSteps, 1);
+  } else if (key == "stepGap") {
+    return toNumber(key, value, &config->stepGap, 1);
+  } else if (key == "equiliSteps") {
+    return toNumber(key, value, &config->equiliSteps, 1);
+  } else if (key == "selectByTimestep") {
+    return toNumber(key, value, &config->selectByTimestep);
+  } else if (key == "firstTimestep") {
+    return toNumber(key, value, &config->firstTimestep);
+  } else if (key == "lastTimestep") {
+    return toNumber(key, value, &config->lastTimestep);
+  } else if (key == "timestepStride") {
+    return toNumber(key, value, &config->timestepStride, 1LL);
+  } else if (key == "nComputeWorkers") {
+    return toNumber(key, value, &config->nComputeWorkers, 1);
+  } else if (key == "nFrameBuffers") {
+    return toNumber(key, value, &config->nFrameBuffers, 1);
+  } else if (key == "checkpoint") {
+    config->checkpoint = value;
+  } else if (key == "checkpointEvery") {
+    return toNumber(key, value, &config->checkpointEvery, 1);
+  } else if (key == "resume") {
+    return toNumber(key, value, &config->resume);
+  } else if (key == "blockFrames") {
+    return toNumber(key, value, &config->blockFrames, 0);
+  } else if (key == "errorThreshold") {
+    return toNumber(key, value, &config->errorThreshold, 0.0);
+  } else if (key == "minBlocks") {
+    // A standard error needs at least two blocks
+    return toNumber(key, value, &config->minBlocks, 2);
+  } else if (key == "windowFrames") {
+    return toNumber(key, value, &config->windowFrames, 0);
+  } else if (key == "windowStride") {
+    return toNumber(key, value, &config->windowStride, 0);
+  } else if (key == "coordination") {
+    return toNumber(key, value, &config->coordination);
+  } else if (key == "qMax") {
+    return toNumber(key, value, &config->qMax, 0.0);
+  } else if (key == "qStep") {
+    if (toNumber(key, value, &config->qStep) != 0) {
+      return 1;
+    }
+    if (config->qStep <= 0) {
+      std::cerr << "The value " << config->qStep << " of qStep must be "
+                   "positive.\n";
+      return 1;
+    }
+  } else if (key == "outputDir") {
+    config->outputDir = value;
+  } else if (key == "npyOutput") {
+    return toNumber(key, value, &config->npyOutput);
+  } else if (key == "traceFile") {
+    config->traceFile = value;
+  } else if (key == "batch") {
+    config->batch = value;
+  } else if (key == "batchWorkers") {
+    return toNumber(key, value, &config->batchWorkers, 0);
+  } else if (key == "batchChunk") {
+    return toNumber(key, value, &config->batchChunk, 1);
+  } else if (key == "maxReaders") {
+    return toNumber(key, value, &config->maxReaders, 1);
+  } else {
+    std::cerr << "Unknown setting " << key << "\n";
+    return 1;
+  }
+  return 0;
+}
+
+/********************************************/ /**
+ *  Function for reading the settings of a configuration file (see io::RunConfig
+ for the layout). Blank lines and everything after a # are skipped.
+ *  @param[in] filename The path of the configuration file
+ *  @param[in, out] config The run settings, which are added to
+ *  \return an int value of 0 (success) or 1 (error)
+ ***********************************************/
+int io::readConfigFile(const std::string &filename, io::RunConfig *config) {
+  std::ifstream inFile(filename); // Configuration file
+  std::string line;               // Current line
+  std::string key, value;         // Key and value of the current line
+  size_t equals;                  // Position of the = of the line
+  int iline = 0;                  // Number of the current line
+  io::AnalysisOptions *analysis = nullptr; // Analysis of the section, if any
+  rdf::Analysis check; // Settings the values of an analysis are checked on
+
+  if (!inFile.is_open()) {
+    std::cerr << "Could not open the configuration file " << filename << "\n";
+    return 1;
+  }
+  while (std::getline(inFile, line)) {
+    iline++;
+    line = trim(line.substr(0, line.find('#')));
+    if (line.empty()) {
+      continue;
+    }
+    // A new analysis
+    if (line.front() == '[' && line.back() == ']') {
+      std::vector<std::string> tokens =
+          io::tokenizer(line.substr(1, line.size() - 2)); // Words of the header
+      if (tokens.size() != 2 || tokens[0] != "analysis") {
+        std::cerr << filename << ":" << iline
+                  << ": sections must be [analysis name]\n";
+        return 1;
+      }
+      config->analyses.push_back(io::AnalysisOptions());
+      analysis = &config->analyses.back();
+      analysis->name = tokens[1];
+      continue;
+    }
+    equals = line.find('=');
+    if (equals == std::string::npos) {
+      std::cerr << filename << ":" << iline << ": expected key = value\n";
+      return 1;
+    }
+    key = trim(line.substr(0, equals));
+    value = trim(line.substr(equals + 1));
+    // Inside a section, the key belongs to the analysis
+    if (analysis) {
+      if (io::setAnalysisOption(&check, key, value) != 0) {
+        std::cerr << filename << ":" << iline << ": " << key
+                  << " is not a valid setting of an analysis\n";
+        return 1;
+      }
+      analysis->options.push_back({{key, value}});
+    } else if (io::setOption(config, key, value) != 0) {
+      std::cerr << filename << ":" << iline << ": invalid setting\n";
+      return 1;
+    }
+  } // end of loop through the lines
+
+  return 0;
+}
+
+/********************************************/ /**
+ *  Function for reading the settings of the command line (see io::RunConfig).
+ The configuration files given with --config are read first, so that the
+ other options override them.
+ *  @param[in] argc The number of arguments
+ *  @param[in] argv The arguments, starting with the program
+ *  @param[in, out] config The run settings, which are added to
+ *  \return an int value of 0 (success) or 1 (error)
+ ***********************************************/
+int io::parseArguments(int argc, char *argv[], io::RunConfig *config) {
+  std::string option;        // Current argument
+  std::string key, value;    // Key and value of the current option
+  size_t equals;             // Position of the = of --key=value
+  int npositional = 0;       // Positional arguments read
+  std::vector<std::string> parts; // Parts of an analysis option
+  rdf::Analysis check; // Settings the values of an analysis are checked on
+
+  // Configuration files
+  for (int iarg = 1; iarg < argc; iarg++) {
+    option = argv[iarg];
+    if ((option == "--config" || option == "-c") && iarg + 1 < argc) {
+      if (io::readConfigFile(argv[++iarg], config) != 0) {
+        return 1;
+      }
+    } else if (option.compare(0, 9, "--config=") == 0 &&
+               io::readConfigFile(option.substr(9), config) != 0) {
+      return 1;
+    }
+  }
+
+  // Everything else, in order
+  for (int iarg = 1; iarg < argc; iarg++) {
+    option = argv[iarg];
+    if (option == "--help" || option == "-h") {
+      config->help = true;
+      return 0;
+    }
+    if (option == "--config" || option == "-c") {
+      iarg++;
+      continue;
+    }
+    if (option.compare(0, 9, "--config=") == 0) {
+      continue;
+    }
+    // The trajectory, then the checkpoint file
+    if (option == "-" || option.compare(0, 1, "-") != 0) {
+      if (npositional == 0) {
+        config->trajectory = option;
+      } else if (npositional == 1) {
+        config->checkpoint = option;
+      } else {
+        std::cerr << "Unexpected argument " << option << "\n";
+        return 1;
+      }
+      npositional++;
+      continue;
+    }
+    if (option.compare(0, 2, "--") != 0) {
+      std::cerr << "Unknown option " << option << "\n";
+      return 1;
+    }
+    // --key=value or --key value
+    equals = option.find('=');
+    if (equals != std::string::npos) {
+      key = option.substr(2, equals - 2);
+      value = option.substr(equals + 1);
+    } else if (iarg + 1 < argc) {
+      key = option.substr(2);
+      value = argv[++iarg];
+    } else {
+      std::cerr << "The option " << option << " needs a value.\n";
+      return 1;
+    }
+    // An analysis, as "name;key=value;..."
+    if (key == "analysis") {
+      io::AnalysisOptions analysis; // Analysis being read
+      size_t start = 0;             // Start of the current part
+      size_t end;                   // End of the current part
+      parts.clear();
+      do {
+        end = value.find(';', start);
+        parts.push_back(trim(value.substr(start, end - start)));
+        start = end + 1;
+      } while (end != std::string::npos);
+      analysis.name = parts[0];
+      if (analysis.name.empty()) {
+        std::cerr << "The analysis '" << value << "' has no name.\n";
+        return 1;
+      }
+      for (int ipart = 1; ipart < parts.size(); ipart++) {
+        equals = parts[ipart].find('=');
+        key = trim(parts[ipart].substr(0, equals));
+        if (equals == std::string::npos ||
+            io::setAnalysisOption(&check, key,
+                                  trim(parts[ipart].substr(equals + 1))) !=
+                0) {
+          std::cerr << "Invalid setting '" << parts[ipart]
+                    << "' of the analysis " << analysis.name << "\n";
+          return 1;
+        }
+        analysis.options.push_back(
+            {{key, trim(parts[ipart].substr(equals + 1))}});
+      }
+      config->analyses.push_back(analysis);
+    } else if (io::setOption(config, key, value) != 0) {
+      return 1;
+    }
+  } // end of loop through the arguments
+
+  return 0;
+}
+
+/********************************************/ /**
+ *  Function for getting the settings of every analysis of a run. Every
+ analysis starts from the global settings, and then sets its own. Without any
+ analyses, there is a single one, called rdf, with the global settings.
+ *  @param[in] config The run settings
+ *  @param[out] analyses The settings of every analysis, which are overwritten
+ *  \return an int value of 0 (success) or 1 (two analyses have the same name)
+ ***********************************************/
+int io::resolveAnalyses(const io::RunConfig &config,
+                        std::vector<rdf::Analysis> *analyses) {
+  analyses->clear();
+  if (config.analyses.empty()) {
+    analyses->push_back(config.defaults);
+    analyses->back().name = "rdf";
+    return 0;
+  }
+  for (const io::AnalysisOptions &options : config.analyses) {
+    rdf::Analysis analysis = config.defaults; // Settings of this analysis
+    analysis.name = options.name;
+    for (const std::array<std::string, 2> &option : options.options) {
+      // The values were checked when they were read in
+      io::setAnalysisOption(&analysis, option[0], option[1]);
+    }
+    for (const rdf::Analysis &other : *analyses) {
+      if (other.name == analysis.name) {
+        std::cerr << "There are two analyses called " << analysis.name
+                  << ".\n";
+        return 1;
+      }
+    }
+    analyses->push_back(analysis);
+  } // end of loop through analyses
+
+  return 0;
+}
+
+/********************************************/ /**
+ *  Function for printing the usage of runYoda, with the keys of the settings.
+ *  @param[in] out The stream to print to
+ *  @param[in] program The name of the program
+ ***********************************************/
+void io::printUsage(std::ostream &out, const std::string &program) {
+  io::RunConfig defaults; // Default settings
+
+  out << "Usage: " << program
+      << " [trajectory [checkpoint]] [--config file] [--key value ...]\n"
+      << "       [--analysis \"name;key=value;...\"]\n\n"
+      << "Settings (as --key value, or key = value in a configuration "
+         "file):\n"
+      << "  trajectory        " << defaults.trajectory << "\n"
+      << "  numCalcSteps      " << defaults.numCalcSteps << "\n"
+      << "  stepGap           " << defaults.stepGap << "\n"
+      << "  equiliSteps       " << defaults.equiliSteps << "\n"
+      << "  selectByTimestep  false\n"
+      << "  firstTimestep     " << defaults.firstTimestep << "\n"
+      << "  lastTimestep      " << defaults.lastTimestep << "\n"
+      << "  timestepStride    " << defaults.timestepStride << "\n"
+      << "  binsize           " << defaults.defaults.binsize << "\n"
+      << "  cutoff            " << defaults.defaults.cutoff << "\n"
+      << "  partialRdf        true\n"
+      << "  singlePrecision   false\n"
+      << "  reference         " << defaults.defaults.referenceExpression
+      << "\n"
+      << "  target            " << defaults.defaults.targetExpression << "\n"
+      << "  nComputeWorkers   " << defaults.nComputeWorkers << "\n"
+      << "  nFrameBuffers     " << defaults.nFrameBuffers << "\n"
+      << "  checkpoint        (none)\n"
+      << "  checkpointEvery   " << defaults.checkpointEvery << "\n"
+      << "  resume            true\n"
+      << "  blockFrames       " << defaults.blockFrames << "\n"
+      << "  errorThreshold    " << defaults.errorThreshold << "\n"
+      << "  minBlocks         " << defaults.minBlocks << "\n"
+      << "  windowFrames      " << defaults.windowFrames << "\n"
+      << "  windowStride      " << defaults.windowStride << "\n"
+      << "  coordination      false\n"
+      << "  qMax              " << defaults.qMax << "\n"
+      << "  qStep             " << defaults.qStep << "\n"
+      << "  outputDir         " << defaults.outputDir << "\n"
+      << "  npyOutput         false\n"
+      << "  traceFile         (none)\n"
+      << "  batch             (none)\n"
+      << "  batchWorkers      " << defaults.batchWorkers << "\n"
+      << "  batchChunk        " << defaults.batchChunk << "\n"
+      << "  maxReaders        " << defaults.maxReaders << "\n\n"
+      << "Every analysis may set its own binsize, cutoff, partialRdf, "
+         "singlePrecision,\nreference and target; the others are taken from "
+         "the global settings.\n";
+}
+
+/********************************************/ /**
+ *  Function for writing out the \f$g(r)\f$ of an analysis (with error bars,
+ if there are at least two blocks), and the running coordination numbers and
+ structure factor, if the run settings ask for them (see io::outputName for the
+ names of the files). With npyOutput, each is also written as a .npy file.
+ *  @param[in] config The run settings
+ *  @param[in] name The name of the analysis
+ *  @param[in] state The accumulation of the analysis
+ *  @param[in] blocks The block averages of the analysis
+ *  @param[in] outputDir The directory the files are written to
+ *  \return an int value of 0 (success) or 1 (a file could not be written)
+ ***********************************************/
+int io::writeResults(const io::RunConfig &config, const std::string &name,
+                     const rdf::RdfState &state, const rdf::BlockStats &blocks,
+                     const std::string &outputDir) {
+  // Normalize the RDF, using the volume and number of particles averaged
+  // over all the frames
+  std::vector<double> rdf = rdf::normalizeState(state);
+  // Standard errors, from the spread of the block averages
+  std::vector<double> error = rdf::standardError(blocks);
+  int fail = 0; // Non-zero if a file could not be written
+  // Extensions of the files; text, and NumPy arrays if asked for
+  std::vector<std::string> extensions = {".dat"};
+  if (config.npyOutput) {
+    extensions.push_back(".npy");
+  }
+
+  for (const std::string &extension : extensions) {
+    fail |= io::writeRDF(rdf.data(), state.binsize, state.nbin,
+                         name + extension, state.ntypes,
+                         (blocks.nblocks >= 2) ? error.data() : nullptr,
+                         outputDir);
+  }
+
+  // Running coordination numbers, at the upper edge of every bin
+  if (config.coordination) {
+    std::vector<double> cn = rdf::coordinationNumbers(state);
+    std::vector<double> rEdge(state.nbin); // Upper edges of the bins
+    for (int ibin = 0; ibin < state.nbin; ibin++) {
+      rEdge[ibin] = state.binsize * (ibin + 1);
+    }
+    for (const std::string &extension : extensions) {
+      fail |= io::writeColumns(cn.data(), rEdge, "r", "n",
+                               io::outputName(name, "cn", extension),
+                               state.ntypes, outputDir);
+    }
+  }
+  // Static structure factor
+  if (config.qMax > 0) {
+    std::vector<double> q = rdf::qGrid(config.qStep, config.qMax);
+    std::vector<double> sq = rdf::structureFactor(state, rdf, q);
+    for (const std::string &extension : extensions) {
+      fail |= io::writeColumns(sq.data(), q, "q", "S",
+                               io::outputName(name, "sq", extension),
+                               state.ntypes, outputDir);
+    }
+  }
+
+  return (fail != 0) ? 1 : 0;
+}
@@ -0,0 +1,53 @@
+// Standard Library
+#include <iostream>
+#include <string>
+
+// Internal Libraries
+#include <binaryTraj.hpp>
+
+/********************************************/ /**
+ *  Converts a text lammps trajectory file into a binary trajectory, which
+ runYoda reads natively.
+ *
+ * Usage: yodaConvert input.lammpstrj output.ytrj [--float32 | --float64 |
+ --quantize step]
+ *
+ * The default is raw float32 coordinates. With --quantize, the coordinates
+ are stored as variable-length integer multiples of the step (e.g. 0.001),
+ which is considerably smaller.
+ ***********************************************/
+int main(int argc, char *argv[]) {
+  uint32_t precision = 4;                             // Bytes per coordinate
+  io::BinaryEncoding encoding = io::BinaryEncoding::raw; // Encoding of blocks
+  double quantStep = 1e-3;                            // Quantization step
+  std::string option;                                 // Current option
+
+  if (argc < 3) {
+    std::cerr << "Usage: " << argv[0]
+              << " input.lammpstrj output.ytrj [--float32 | --float64 | "
+                 "--quantize step]\n";
+    return 1;
+  }
+  // Read in the options
+  try {
+    for (int iarg = 3; iarg < argc; iarg++) {
+      option = argv[iarg];
+      if (option == "--float32") {
+        precision = 4;
+      } else if (option == "--float64") {
+        precision = 8;
+      } else if (option == "--quantize" && iarg + 1 < argc) {
+        encoding = io::BinaryEncoding::quantized;
+        quantStep = std::stod(argv[++iarg]);
+      } else {
+        std::cerr << "Unknown option " << option << "\n";
+        return 1;
+      }
+    }
+  } catch (const std::exception &) {
+    std::cerr << "Invalid value for the option " << option << "\n";
+    return 1;
+  }
+
+  return io::convertToBinary(argv[1], argv[2], precision, encoding, quantStep);
+}
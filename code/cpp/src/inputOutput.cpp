@@ -1,69 +1,246 @@
 #include <inputOutput.hpp>
 
 /********************************************/ /**
- *  Function for getting the total number of timesteps from a lammps trajectory.
- This also includes 'incomplete' frames, so it should be used with caution.
+ *  Function for building the frame index of a lammps trajectory file, in a
+ single pass through the file.
+ *
+ * For every frame, the byte offset of its "ITEM: TIMESTEP" line, its timestep
+ value, number of atoms and box are recorded. The file is memory-mapped and
+ the atom lines are skipped without being parsed. An 'incomplete' frame at
+ the end of the file is left out, but a malformed frame before the end of the
+ file is an error.
  *  @param[in] filename The path of the LAMMPS trajectory file
- *  @param[in] totalSteps Pointer to the total number of steps or frames in the
- trajectory
+ *  @param[out] frameIndex The index, with one entry per frame
  *  \return an int value of 0 (successful file opening) or 1 (error)
  ***********************************************/
-int io::getTotalTimesteps(std::string filename, int *totalSteps) {
-  std::unique_ptr<std::ifstream> dumpFile;
-  dumpFile = std::make_unique<std::ifstream>(filename);
-  std::string line;                 // Current line being read in
-  std::vector<std::string> tokens;  // Vector containing word tokens
-  int currentFrame = 0;             // Current frame being read in
-
-  // Check if the lammps trajectory exists or not
-  if (!(io::file_exists(filename))) {
-    std::cerr
-        << "Fatal Error: The file does not exist or you gave the wrong path.\n";
-    // Throw exception?
+int io::buildFrameIndex(std::string filename,
+                        std::vector<io::FrameIndexEntry> *frameIndex) {
+  io::MappedFile dumpFile;   // Memory map of the whole file
+  const char *ptr;           // Current position in the file
+  const char *end;           // End of the file
+  io::FrameIndexEntry entry; // Entry of the current frame
+  io::AtomColumns columns;   // Columns of the atom lines
+  int iatom;                 // Number of atom lines skipped
+  int iline;                 // Number of header lines skipped
+  const int nheader = 9;     // Number of header lines, from ITEM: TIMESTEP
+                             // to ITEM: ATOMS
+  const std::string timestepItem = "ITEM: TIMESTEP";
+
+  if (dumpFile.open(filename) != 0) {
     return 1;
   }
 
-  // The format of the LAMMPS trajectory file is:
-  // ITEM: TIMESTEP
-  // 0
-  // ITEM: NUMBER OF ATOMS
-  // 4096
-  // ITEM: BOX BOUNDS pp pp pp
-  // -7.9599900000000001e-01 5.0164000000000001e+01
-  // -7.9599900000000001e-01 5.0164000000000001e+01
-  // -7.9599900000000001e-01 5.0164000000000001e+01
-  // ITEM: ATOMS id type x y z
-  // 1 1 0 0 0 etc
-  if (dumpFile->is_open()) {
-    // ----------------------------------------------------------
-    // At this point we know that the dumpfile is open
-    // This loop goes through all the steps
-    while (std::getline((*dumpFile), line)) {
-      // Read in lines and tokenize them
-      tokens = io::tokenizer(line);
-      // Find out which timestep number
-      // you are inside
-      if (tokens[0].compare("ITEM:") == 0) {
-        if (tokens[1].compare("TIMESTEP") == 0) {
-          // Now you are in a new timestep. Update frame number
-          currentFrame++;
-        }
+  frameIndex->clear();
+  ptr = dumpFile.data();
+  end = dumpFile.end();
+  // This loop goes through all the steps
+  while (ptr < end) {
+    if (end - ptr < (long)timestepItem.size() ||
+        timestepItem.compare(0, timestepItem.size(), ptr,
+                             timestepItem.size()) != 0) {
+      ptr = io::nextLine(ptr, end);
+      continue;
+    }
+    // Now you are in a new timestep
+    entry.offset = ptr - dumpFile.data();
+    if (io::parseFrameHeader(&ptr, end, &entry, &columns) != 0) {
+      // A header cut off by the end of the file is an incomplete last frame
+      ptr = dumpFile.data() + entry.offset;
+      for (iline = 0; iline < nheader && ptr < end; iline++) {
+        ptr = io::nextLine(ptr, end);
+      }
+      if (ptr >= end) {
+        break;
       }
+      std::cerr << "The frame at byte " << entry.offset << " of " << filename
+                << " is malformed.\n";
+      return 1;
+    }
+    // Skip the atom lines
+    iatom = 0;
+    while (iatom < entry.nop && ptr < end) {
+      ptr = io::nextLine(ptr, end);
+      iatom++;
+    }
+    // Leave out an incomplete last frame
+    if (iatom < entry.nop) {
+      break;
+    }
+    frameIndex->push_back(entry);
+  }  // End of while loop
+
+  return 0;
+}
+
+/********************************************/ /**
+ *  Function for reading the frame index of a lammps trajectory file from its
+ sidecar file (see io::frameIndexPath).
+ *
+ * The sidecar file records the size and modification time of the trajectory
+ it was built from. If the trajectory has changed since, the sidecar file is
+ stale and is not read. Sidecar files written before the tilt factors were
+ recorded have a different signature, and are not read either (so the index is
+ rebuilt).
+ *  @param[in] filename The path of the LAMMPS trajectory file
+ *  @param[out] frameIndex The index, with one entry per frame
+ *  \return an int value of 0 (success) or 1 (missing or stale sidecar file)
+ ***********************************************/
+int io::readFrameIndex(std::string filename,
+                       std::vector<io::FrameIndexEntry> *frameIndex) {
+  std::ifstream indexFile;
+  struct stat trajStat;       // Size and modification time of the trajectory
+  char magic[8];              // File signature
+  long long fileSize, mtime;  // Recorded size and modification time
+  long long nframes;          // Number of frames in the index
+  long long offset, nop;      // Fields of an entry
+
+  if (stat(filename.c_str(), &trajStat) != 0) {
+    return 1;
+  }
+  indexFile.open(io::frameIndexPath(filename), std::ios::binary);
+  if (!indexFile.is_open()) {
+    return 1;
+  }
+  indexFile.read(magic, sizeof(magic));
+  indexFile.read(reinterpret_cast<char *>(&fileSize), sizeof(fileSize));
+  indexFile.read(reinterpret_cast<char *>(&mtime), sizeof(mtime));
+  indexFile.read(reinterpret_cast<char *>(&nframes), sizeof(nframes));
+  if (!indexFile || std::string(magic, sizeof(magic)) != "YODAIDX2" ||
+      fileSize != (long long)trajStat.st_size ||
+      mtime != (long long)trajStat.st_mtime) {
+    return 1;
+  }
+
+  frameIndex->resize(nframes);
+  for (auto &entry : (*frameIndex)) {
+    indexFile.read(reinterpret_cast<char *>(&offset), sizeof(offset));
+    indexFile.read(reinterpret_cast<char *>(&entry.timestep),
+                   sizeof(entry.timestep));
+    indexFile.read(reinterpret_cast<char *>(&nop), sizeof(nop));
+    indexFile.read(reinterpret_cast<char *>(entry.boxLo.data()),
+                   3 * sizeof(double));
+    indexFile.read(reinterpret_cast<char *>(entry.box.data()),
+                   3 * sizeof(double));
+    indexFile.read(reinterpret_cast<char *>(entry.tilt.data()),
+                   3 * sizeof(double));
+    entry.offset = offset;
+    entry.nop = nop;
+  }
+  if (!indexFile) {
+    frameIndex->clear();
+    return 1;
+  }
+
+  return 0;
+}
+
+/********************************************/ /**
+ *  Function for writing the frame index of a lammps trajectory file to its
+ sidecar file (see io::frameIndexPath), along with the size and modification
+ time of the trajectory. The index is written all at once (see
+ io::writeFileAtomic), so jobs reading the same trajectory never see a
+ half-written sidecar file.
+ *  @param[in] filename The path of the LAMMPS trajectory file
+ *  @param[in] frameIndex The index, with one entry per frame
+ *  \return an int value of 0 (success) or 1 (error)
+ ***********************************************/
+int io::writeFrameIndex(std::string filename,
+                        const std::vector<io::FrameIndexEntry> &frameIndex) {
+  std::string buffer;         // Contents of the sidecar file
+  struct stat trajStat;       // Size and modification time of the trajectory
+  long long fileSize, mtime;  // Size and modification time to record
+  long long nframes = frameIndex.size();  // Number of frames in the index
+  long long offset, nop;                  // Fields of an entry
 
-    }  // End of while loop
-  }    // End of the open file if statement
-       // ----------------------------------------------------------
+  // Appends the bytes of a value to the buffer
+  auto append = [&buffer](const void *value, size_t size) {
+    buffer.append(reinterpret_cast<const char *>(value), size);
+  };
 
-  // Update the total number of timesteps
-  *totalSteps = currentFrame;
+  if (stat(filename.c_str(), &trajStat) != 0) {
+    return 1;
+  }
+  fileSize = trajStat.st_size;
+  mtime = trajStat.st_mtime;
+  buffer.reserve(32 + frameIndex.size() * (3 * sizeof(long long) +
+                                           9 * sizeof(double)));
+  append("YODAIDX2", 8);
+  append(&fileSize, sizeof(fileSize));
+  append(&mtime, sizeof(mtime));
+  append(&nframes, sizeof(nframes));
+  for (const auto &entry : frameIndex) {
+    offset = entry.offset;
+    nop = entry.nop;
+    append(&offset, sizeof(offset));
+    append(&entry.timestep, sizeof(entry.timestep));
+    append(&nop, sizeof(nop));
+    append(entry.boxLo.data(), 3 * sizeof(double));
+    append(entry.box.data(), 3 * sizeof(double));
+    append(entry.tilt.data(), 3 * sizeof(double));
+  }
+
+  return io::writeFileAtomic(io::frameIndexPath(filename), buffer.data(),
+                             buffer.size());
+}
 
-  dumpFile->close();
+/********************************************/ /**
+ *  Function for getting the frame index of a lammps trajectory file. The index
+ is read from the sidecar file if it is up to date. Otherwise, it is built with
+ a single pass through the trajectory and saved to the sidecar file for later
+ runs. Failing to save the sidecar file (e.g. in a read-only directory) is not
+ an error.
+ *  @param[in] filename The path of the LAMMPS trajectory file
+ *  @param[out] frameIndex The index, with one entry per frame
+ *  \return an int value of 0 (success) or 1 (error)
+ ***********************************************/
+int io::getFrameIndex(std::string filename,
+                      std::vector<io::FrameIndexEntry> *frameIndex) {
+  PROF_SCOPE("index");
+  if (io::readFrameIndex(filename, frameIndex) == 0) {
+    return 0;
+  }
+  if (io::buildFrameIndex(filename, frameIndex) != 0) {
+    return 1;
+  }
+  if (io::writeFrameIndex(filename, *frameIndex) != 0) {
+    std::cerr << "Could not save the frame index of " << filename << "\n";
+  }
   return 0;
 }
 
+/********************************************/ /**
+ *  Function for getting the frames of an indexed trajectory which are
+ selected.
+ *  @param[in] frameIndex The frame index of the trajectory
+ *  @param[in] selection The frame selection
+ *  \return the selected frames (starting from 0), in order
+ ***********************************************/
+std::vector<int> io::selectFrames(
+    const std::vector<io::FrameIndexEntry> &frameIndex,
+    const io::FrameSelection &selection) {
+  std::vector<int> selected; // Selected frames
+
+  for (int iframe = 0; iframe < frameIndex.size(); iframe++) {
+    if (selection.maxFrames >= 0 && selected.size() >= selection.maxFrames) {
+      break;
+    }
+    if (selection.isPast(frameIndex[iframe].timestep)) {
+      break;
+    }
+    if (selection.selects(iframe + 1, frameIndex[iframe].timestep)) {
+      selected.push_back(iframe);
+    }
+  } // end of loop through frames
+
+  return selected;
+}
+
 /********************************************/ /**
                                                 *  Writes out a file containing
-                                                *the r and g(r) values
+                                                *the r and g(r) values, as text
+                                                *or (for a .npy file) as a
+                                                *NumPy array (see
+                                                *io::writeTable)
                                                 *  @param[in] rdfArray The array
                                                 *containing the calculated
                                                 *\f$g(r)\f$
@@ -76,45 +253,250 @@ int io::getTotalTimesteps(std::string filename, int *totalSteps) {
                                                 *  @param[in] filename (Optional
                                                 argument) Specifies a
                                                 user-defined file output name,
-                                                which will be saved inside a
-                                                directory called 'output' in the
-                                                top-level directory of the code
-                                                folder. \return an int value of
+                                                which will be saved inside the
+                                                output directory.
+                                                *  @param[in] ntypes (Optional
+                                                argument) The number of atom
+                                                types. If more than 1, rdfArray
+                                                holds the total and partial
+                                                \f$g(r)\f$s (see
+                                                rdf::RdfState), which are
+                                                written as one column each
+                                                *  @param[in] rdfError (Optional
+                                                argument) The standard errors of
+                                                the \f$g(r)\f$s, laid out as
+                                                rdfArray (see
+                                                rdf::standardError). If given,
+                                                every column is followed by a
+                                                column of its errors
+                                                *  @param[in] outputDir
+                                                (Optional argument) The
+                                                directory the file is written
+                                                to, which is created if needed
+                                                \return an int value of
                                                 0 (success) or 1
                                                 *(error)
                                                 ***********************************************/
 int io::writeRDF(double *rdfArray, double binsize, int nbin,
-                 std::string filename) {
-  std::ofstream outputFile;
-  double r;  // Distance value
-  // ----------------
-  // Otherwise create file
-  // Create output dir if it doesn't exist already
-  const char *path = "../../output";  // relative to the build directory
-  boost::filesystem::path dir(path);
-  if (boost::filesystem::create_directory(dir)) {
-    std::cerr << "Output directory created\n";
-  }
-  // ----------------
-  // Write output to file inside the output directory
-  outputFile.open("../../output/" + filename);
+                 std::string filename, int ntypes, const double *rdfError,
+                 const std::string &outputDir) {
+  std::string header = "r  g(r)"; // Names of the columns
+  std::string path;                // Path of the file
+  // Number of columns of g(r) values; the total and every pair of types
+  int ncolumns = (ntypes > 1) ? 1 + ntypes * (ntypes + 1) / 2 : 1;
+  // Columns of the file: r, then every g(r) (and its error)
+  int nfileColumns = 1 + ncolumns * (rdfError ? 2 : 1);
+  std::vector<double> table(nbin * nfileColumns); // Rows of the file
+  PROF_SCOPE("write");
 
-  //  Comment line
-  // 0.1  3
-  // O.2  5
+  if (io::outputPath(outputDir, filename, &path) != 0) {
+    return 1;
+  }
 
-  // Write the comment line
-  // Write out the number of atoms
-  outputFile << "# r  g(r)\n";
+  // Names of the columns
+  if (rdfError) {
+    header += "  err_g(r)";
+  }
+  // The partials are in the order 1-1, 1-2, ..., 1-n, 2-2, ..., n-n
+  for (int itype = 1; itype <= ntypes && ntypes > 1; itype++) {
+    for (int jtype = itype; jtype <= ntypes; jtype++) {
+      std::string pair = std::to_string(itype) + "-" + std::to_string(jtype);
+      header += "  g_" + pair + "(r)";
+      if (rdfError) {
+        header += "  err_g_" + pair + "(r)";
+      }
+    }
+  }
 
-  // Write out the RDF values
   // Loop through the bins
   for (int ibin = 0; ibin < nbin; ibin++) {
-    r = binsize * (ibin + 0.5);  // Calculate the r value
-    // Write out the RDF
-    outputFile << r << " " << rdfArray[ibin] << "\n";
-  }  // end of loop through all bins
+    double *row = &table[ibin * nfileColumns]; // Row of this bin
+    row[0] = binsize * (ibin + 0.5);          // Calculate the r value
+    for (int icolumn = 0; icolumn < ncolumns; icolumn++) {
+      if (rdfError) {
+        row[1 + 2 * icolumn] = rdfArray[icolumn * nbin + ibin];
+        row[2 + 2 * icolumn] = rdfError[icolumn * nbin + ibin];
+      } else {
+        row[1 + icolumn] = rdfArray[icolumn * nbin + ibin];
+      }
+    }
+  } // end of loop through all bins
+
+  return io::writeTable(path, header, table, nfileColumns);
+}
+
+/********************************************/ /**
+ *  Function for writing out a quantity derived from the \f$g(r)\f$ (such as
+ the coordination numbers or structure factor), as a table of columns in the
+ same output directory, column order and formats as io::writeRDF.
+ *  @param[in] values The values, with one column of x.size() values for the
+ total and (if ntypes > 1) for every pair of atom types
+ *  @param[in] x The values of the variable (r or q) of every row
+ *  @param[in] xName The name of the variable, e.g. "r"
+ *  @param[in] name The name of the quantity, e.g. "n" for n(r)
+ *  @param[in] filename The name of the file, inside the output directory
+ *  @param[in] ntypes The number of atom types
+ *  @param[in] outputDir (Optional argument) The directory the file is written
+ to, which is created if needed
+ *  \return an int value of 0 (success) or 1 (error)
+ ***********************************************/
+int io::writeColumns(const double *values, const std::vector<double> &x,
+                     std::string xName, std::string name,
+                     std::string filename, int ntypes,
+                     const std::string &outputDir) {
+  int nrows = x.size(); // Number of rows
+  // Number of columns of values; the total and every pair of types
+  int ncolumns = (ntypes > 1) ? 1 + ntypes * (ntypes + 1) / 2 : 1;
+  std::string header = xName + "  " + name + "(" + xName + ")"; // Names
+  std::string path;                                      // Path of the file
+  std::vector<double> table(nrows * (1 + ncolumns));     // Rows of the file
+  PROF_SCOPE("write");
+
+  if (io::outputPath(outputDir, filename, &path) != 0) {
+    return 1;
+  }
+
+  // Names of the columns
+  for (int itype = 1; itype <= ntypes && ntypes > 1; itype++) {
+    for (int jtype = itype; jtype <= ntypes; jtype++) {
+      header += "  " + name + "_" + std::to_string(itype) + "-" +
+                std::to_string(jtype) + "(" + xName + ")";
+    }
+  }
+
+  // Loop through the rows
+  for (int irow = 0; irow < nrows; irow++) {
+    table[irow * (1 + ncolumns)] = x[irow];
+    for (int icolumn = 0; icolumn < ncolumns; icolumn++) {
+      table[irow * (1 + ncolumns) + 1 + icolumn] =
+          values[icolumn * nrows + irow];
+    }
+  } // end of loop through rows
+
+  return io::writeTable(path, header, table, 1 + ncolumns);
+}
+
+/********************************************/ /**
+ *  Function for appending a number to a text buffer, in the shortest form
+ which reads back as exactly the same double.
+ *  @param[in] value The number
+ *  @param[in, out] buffer The buffer
+ ***********************************************/
+void io::appendNumber(double value, std::string *buffer) {
+  char text[32]; // Long enough for any double
+  std::to_chars_result result = std::to_chars(text, text + sizeof(text), value);
+  buffer->append(text, result.ptr);
+}
+
+/********************************************/ /**
+ *  Function for getting the path of an output file inside the output
+ directory, which is created if it does not exist yet.
+ *  @param[in] outputDir The output directory
+ *  @param[in] filename The name of the file, inside the output directory
+ *  @param[out] path The path of the file
+ *  \return an int value of 0 (success) or 1 (the directory could not be
+ created)
+ ***********************************************/
+int io::outputPath(const std::string &outputDir, const std::string &filename,
+                   std::string *path) {
+  boost::filesystem::path dir(outputDir); // Output directory
+  boost::system::error_code error;        // Error of creating the directory
+
+  if (boost::filesystem::create_directories(dir, error)) {
+    std::cerr << "Output directory created\n";
+  }
+  if (error) {
+    std::cerr << "Could not create the output directory " << outputDir << ": "
+              << error.message() << "\n";
+    return 1;
+  }
+  *path = (dir / filename).string();
+
+  return 0;
+}
+
+/********************************************/ /**
+ *  Function for writing a buffer to a file. The buffer is written to a
+ temporary file next to it, named after the process, which then replaces the
+ file, so other jobs never see a half-written file.
+ *  @param[in] path The path of the file
+ *  @param[in] data The contents of the file
+ *  @param[in] size The size of the contents in bytes
+ *  \return an int value of 0 (success) or 1 (error)
+ ***********************************************/
+int io::writeFileAtomic(const std::string &path, const char *data,
+                        size_t size) {
+  // Written first, then renamed
+  std::string tmpFile = path + ".tmp" + std::to_string(getpid());
+  FILE *file = fopen(tmpFile.c_str(), "wb"); // Temporary file
+  bool written;                              // true if everything was written
+
+  if (!file) {
+    std::cerr << "Could not open " << tmpFile << " for writing.\n";
+    return 1;
+  }
+  written = (fwrite(data, 1, size, file) == size);
+  written = (fclose(file) == 0) && written;
+  if (!written || rename(tmpFile.c_str(), path.c_str()) != 0) {
+    std::cerr << "Could not write " << path << "\n";
+    remove(tmpFile.c_str());
+    return 1;
+  }
 
-  // Once the rings have been printed, exit
   return 0;
-}
\ No newline at end of file
+}
+
+/********************************************/ /**
+ *  Function for writing a table of numbers to a file, all at once (see
+ io::writeFileAtomic). A file ending in .npy is written as a 2D NumPy array of
+ float64 (version 1.0 of the format). Any other file is written as text: a
+ comment line with the names of the columns, then one line per row, with every
+ number in its shortest round-trip form.
+ *  @param[in] path The path of the file
+ *  @param[in] header The names of the columns (text files only)
+ *  @param[in] table The numbers, one row after the other
+ *  @param[in] ncolumns The number of columns
+ *  \return an int value of 0 (success) or 1 (error)
+ ***********************************************/
+int io::writeTable(const std::string &path, const std::string &header,
+                   const std::vector<double> &table, int ncolumns) {
+  std::string buffer; // Contents of the file
+  int nrows = table.size() / ncolumns; // Number of rows
+  uint16_t one = 1;   // Tells the byte order of the machine
+
+  if (path.size() >= 4 && path.compare(path.size() - 4, 4, ".npy") == 0) {
+    // Dictionary describing the array, padded so the data starts on a
+    // multiple of 64 bytes
+    std::string dict = std::string("{'descr': '") +
+                       ((*(char *)&one == 1) ? "<" : ">") +
+                       "f8', 'fortran_order': False, 'shape': (" +
+                       std::to_string(nrows) + ", " +
+                       std::to_string(ncolumns) + "), }";
+    dict.append(63 - (10 + dict.size()) % 64, ' ');
+    dict += '\n';
+    buffer = "\x93NUMPY";
+    buffer += '\x01';
+    buffer += '\x00';
+    buffer += (char)(dict.size() & 0xff); // Length of the dictionary, as a
+    buffer += (char)(dict.size() >> 8);   // little-endian uint16
+    buffer += dict;
+    buffer.append(reinterpret_cast<const char *>(table.data()),
+                  table.size() * sizeof(double));
+    return io::writeFileAtomic(path, buffer.data(), buffer.size());
+  }
+
+  // Every number takes up to 25 characters
+  buffer.reserve(header.size() + 3 + table.size() * 25);
+  buffer += "# " + header + "\n";
+  for (int irow = 0; irow < nrows; irow++) {
+    for (int icolumn = 0; icolumn < ncolumns; icolumn++) {
+      if (icolumn > 0) {
+        buffer += ' ';
+      }
+      io::appendNumber(table[irow * ncolumns + icolumn], &buffer);
+    }
+    buffer += '\n';
+  } // end of loop through rows
+
+  return io::writeFileAtomic(path, buffer.data(), buffer.size());
+}
@@ -0,0 +1,402 @@
+#include <kernel.hpp>
+
+/********************************************/ /**
+ *  Function for binning the distances between particle i and the particles
+ [jBegin, jEnd) of a structure-of-arrays, in a 3D orthorhombic periodic box.
+ *
+ * The particles are handled a whole vector register at a time, with a scalar
+ loop for the remainder (and on CPUs without AVX2). For every lane, the
+ minimum image distance is found, and lanes whose squared distance exceeds the
+ (slightly enlarged) squared cutoff are dropped without taking a square root.
+ The remaining lanes are binned one at a time. If jType is given, the pair
+ with particle j is binned into the histogram starting at
+ rdfArray[rowOffset[jType[j]]], which lets a single pass fill the partial
+ \f$g(r)\f$ of every pair of atom types.
+ *
+ *  @param[in] xi The x coordinate of particle i
+ *  @param[in] yi The y coordinate of particle i
+ *  @param[in] zi The z coordinate of particle i
+ *  @param[in] x The x coordinates of the other particles
+ *  @param[in] y The y coordinates of the other particles
+ *  @param[in] z The z coordinates of the other particles
+ *  @param[in] jType The atom types of the other particles, or nullptr to bin
+ every pair into the same histogram
+ *  @param[in] rowOffset The offset of the histogram of particle i paired with
+ each atom type (not used if jType is nullptr)
+ *  @param[in] jBegin The first particle of the range
+ *  @param[in] jEnd The particle after the last particle of the range
+ *  @param[in] box The simulation box lengths
+ *  @param[in] cutoff The cutoff of the \f$g(r)\f$
+ *  @param[in] binsize The bin width
+ *  @param[in] rdfArray The histogram, to which 1 is added per pair
+ ***********************************************/
+void rdf::binRow(double xi, double yi, double zi, const double *x,
+                 const double *y, const double *z, const int *jType,
+                 const int *rowOffset, int jBegin, int jEnd,
+                 const std::array<double, 3> &box, double cutoff,
+                 double binsize, uint64_t *rdfArray) {
+  int jatom = jBegin; // Current particle
+#if defined(__AVX512F__) || defined(__AVX2__)
+  // Squared cutoff, enlarged so that no pair within the cutoff is dropped
+  double cutoff2 = cutoff * cutoff * (1.0 + 1e-10);
+#endif
+
+#if defined(__AVX512F__)
+  // ---------------------------
+  // AVX-512: 8 particles at a time
+  const __m512d half = _mm512_set1_pd(0.5);
+  const __m512i one = _mm512_castpd_si512(_mm512_set1_pd(1.0));
+  const __m512i signBit = _mm512_set1_epi64((long long)0x8000000000000000ULL);
+  const __m512d cut2 = _mm512_set1_pd(cutoff2);
+  const __m512d boxLength[3] = {_mm512_set1_pd(box[0]), _mm512_set1_pd(box[1]),
+                          _mm512_set1_pd(box[2])};
+  const __m512d ri[3] = {_mm512_set1_pd(xi), _mm512_set1_pd(yi),
+                         _mm512_set1_pd(zi)};
+  const double *rj[3] = {x, y, z};
+  alignas(64) double r[8]; // Distances of the lanes
+  alignas(32) int bin[8];  // Bins of the lanes
+
+  for (; jatom + 8 <= jEnd; jatom += 8) {
+    __m512d d2 = _mm512_setzero_pd();
+    for (int k = 0; k < 3; k++) {
+      __m512d d = _mm512_sub_pd(ri[k], _mm512_loadu_pd(rj[k] + jatom));
+      // round(d / box), rounding halves away from zero
+      __m512d q = _mm512_div_pd(d, boxLength[k]);
+      __m512d t = _mm512_roundscale_pd(q, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+      __mmask8 up = _mm512_cmp_pd_mask(_mm512_abs_pd(_mm512_sub_pd(q, t)), half,
+                                       _CMP_GE_OQ);
+      __m512d sign = _mm512_castsi512_pd(
+          _mm512_or_si512(_mm512_and_si512(_mm512_castpd_si512(q), signBit), one));
+      t = _mm512_mask_add_pd(t, up, t, sign);
+      // Apply PBCs
+      d = _mm512_sub_pd(d, _mm512_mul_pd(boxLength[k], t));
+      d2 = (k == 0) ? _mm512_mul_pd(d, d)
+                    : _mm512_add_pd(d2, _mm512_mul_pd(d, d));
+    }
+    __mmask8 inside = _mm512_cmp_pd_mask(d2, cut2, _CMP_LT_OQ);
+    if (inside == 0) {
+      continue;
+    }
+    __m512d dist = _mm512_sqrt_pd(d2);
+    _mm512_store_pd(r, dist);
+    _mm256_store_si256(reinterpret_cast<__m256i *>(bin),
+                       _mm512_cvttpd_epi32(_mm512_div_pd(
+                           dist, _mm512_set1_pd(binsize))));
+    // Bin the lanes one at a time
+    for (int lane = 0; lane < 8; lane++) {
+      if (((inside >> lane) & 1) && r[lane] < cutoff) {
+        if (jType) {
+          rdfArray[rowOffset[jType[jatom + lane]] + bin[lane]] += 1;
+        } else {
+          rdfArray[bin[lane]] += 1;
+        }
+      }
+    }
+  } // end of loop through vectors
+#elif defined(__AVX2__)
+  // ---------------------------
+  // AVX2: 4 particles at a time
+  const __m256d half = _mm256_set1_pd(0.5);
+  const __m256d one = _mm256_set1_pd(1.0);
+  const __m256d signBit = _mm256_set1_pd(-0.0);
+  const __m256d cut2 = _mm256_set1_pd(cutoff2);
+  const __m256d boxLength[3] = {_mm256_set1_pd(box[0]), _mm256_set1_pd(box[1]),
+                                _mm256_set1_pd(box[2])};
+  const __m256d ri[3] = {_mm256_set1_pd(xi), _mm256_set1_pd(yi),
+                         _mm256_set1_pd(zi)};
+  const double *rj[3] = {x, y, z};
+  alignas(32) double r[4]; // Distances of the lanes
+  alignas(16) int bin[4];  // Bins of the lanes
+
+  for (; jatom + 4 <= jEnd; jatom += 4) {
+    __m256d d2 = _mm256_setzero_pd();
+    for (int k = 0; k < 3; k++) {
+      __m256d d = _mm256_sub_pd(ri[k], _mm256_loadu_pd(rj[k] + jatom));
+      // round(d / box), rounding halves away from zero
+      __m256d q = _mm256_div_pd(d, boxLength[k]);
+      __m256d t = _mm256_round_pd(q, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+      __m256d up = _mm256_cmp_pd(_mm256_andnot_pd(signBit, _mm256_sub_pd(q, t)),
+                                 half, _CMP_GE_OQ);
+      __m256d sign = _mm256_or_pd(_mm256_and_pd(q, signBit), one);
+      t = _mm256_add_pd(t, _mm256_and_pd(up, sign));
+      // Apply PBCs
+      d = _mm256_sub_pd(d, _mm256_mul_pd(boxLength[k], t));
+      d2 = (k == 0) ? _mm256_mul_pd(d, d)
+                    : _mm256_add_pd(d2, _mm256_mul_pd(d, d));
+    }
+    int inside = _mm256_movemask_pd(_mm256_cmp_pd(d2, cut2, _CMP_LT_OQ));
+    if (inside == 0) {
+      continue;
+    }
+    __m256d dist = _mm256_sqrt_pd(d2);
+    _mm256_store_pd(r, dist);
+    _mm_store_si128(reinterpret_cast<__m128i *>(bin),
+                    _mm256_cvttpd_epi32(
+                        _mm256_div_pd(dist, _mm256_set1_pd(binsize))));
+    // Bin the lanes one at a time
+    for (int lane = 0; lane < 4; lane++) {
+      if (((inside >> lane) & 1) && r[lane] < cutoff) {
+        if (jType) {
+          rdfArray[rowOffset[jType[jatom + lane]] + bin[lane]] += 1;
+        } else {
+          rdfArray[bin[lane]] += 1;
+        }
+      }
+    }
+  } // end of loop through vectors
+#endif
+  // ---------------------------
+  // Scalar remainder
+  for (; jatom < jEnd; jatom++) {
+    rdf::binPair(xi - x[jatom], yi - y[jatom], zi - z[jatom], box, cutoff,
+                 binsize,
+                 jType ? rdfArray + rowOffset[jType[jatom]] : rdfArray);
+  }
+}
+
+/********************************************/ /**
+ *  Function for binning the distances between particle i and the particles
+ [jBegin, jEnd) of a structure-of-arrays of float coordinates, in a 3D
+ orthorhombic periodic box.
+ *
+ * This is rdf::binRow in single precision: 16 (AVX-512), 8 (AVX2) or 1
+ (scalar) particles are handled at a time, and the minimum image separations
+ and squared distances are found in float. The squared distances of the lanes
+ which pass the (enlarged) squared cutoff are then turned into distances and
+ bins in double, one lane at a time.
+ *
+ *  @param[in] xi The x coordinate of particle i
+ *  @param[in] yi The y coordinate of particle i
+ *  @param[in] zi The z coordinate of particle i
+ *  @param[in] x The x coordinates of the other particles
+ *  @param[in] y The y coordinates of the other particles
+ *  @param[in] z The z coordinates of the other particles
+ *  @param[in] jType The atom types of the other particles, or nullptr to bin
+ every pair into the same histogram
+ *  @param[in] rowOffset The offset of the histogram of particle i paired with
+ each atom type (not used if jType is nullptr)
+ *  @param[in] jBegin The first particle of the range
+ *  @param[in] jEnd The particle after the last particle of the range
+ *  @param[in] box The simulation box lengths
+ *  @param[in] cutoff The cutoff of the \f$g(r)\f$
+ *  @param[in] binsize The bin width
+ *  @param[in] rdfArray The histogram, to which 1 is added per pair
+ ***********************************************/
+void rdf::binRowFloat(float xi, float yi, float zi, const float *x,
+                      const float *y, const float *z, const int *jType,
+                      const int *rowOffset, int jBegin, int jEnd,
+                      const std::array<double, 3> &box, double cutoff,
+                      double binsize, uint64_t *rdfArray) {
+  int jatom = jBegin; // Current particle
+  const float boxf[3] = {(float)box[0], (float)box[1], (float)box[2]};
+#if defined(__AVX512F__) || defined(__AVX2__)
+  // Squared cutoff, enlarged beyond the rounding of float
+  float cutoff2 = (float)(cutoff * cutoff * (1.0 + 1e-5));
+  double r_ij; // Distance of a lane
+#endif
+
+#if defined(__AVX512F__)
+  // ---------------------------
+  // AVX-512: 16 particles at a time
+  const __m512 half = _mm512_set1_ps(0.5f);
+  const __m512i one = _mm512_castps_si512(_mm512_set1_ps(1.0f));
+  const __m512i signBit = _mm512_set1_epi32((int)0x80000000U);
+  const __m512 cut2 = _mm512_set1_ps(cutoff2);
+  const __m512 boxLength[3] = {_mm512_set1_ps(boxf[0]), _mm512_set1_ps(boxf[1]),
+                               _mm512_set1_ps(boxf[2])};
+  const __m512 ri[3] = {_mm512_set1_ps(xi), _mm512_set1_ps(yi),
+                        _mm512_set1_ps(zi)};
+  const float *rj[3] = {x, y, z};
+  alignas(64) float r2[16]; // Squared distances of the lanes
+
+  for (; jatom + 16 <= jEnd; jatom += 16) {
+    __m512 d2 = _mm512_setzero_ps();
+    for (int k = 0; k < 3; k++) {
+      __m512 d = _mm512_sub_ps(ri[k], _mm512_loadu_ps(rj[k] + jatom));
+      // round(d / box), rounding halves away from zero
+      __m512 q = _mm512_div_ps(d, boxLength[k]);
+      __m512 t = _mm512_roundscale_ps(q, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+      __mmask16 up = _mm512_cmp_ps_mask(_mm512_abs_ps(_mm512_sub_ps(q, t)), half,
+                                        _CMP_GE_OQ);
+      __m512 sign = _mm512_castsi512_ps(
+          _mm512_or_si512(_mm512_and_si512(_mm512_castps_si512(q), signBit), one));
+      t = _mm512_mask_add_ps(t, up, t, sign);
+      // Apply PBCs
+      d = _mm512_sub_ps(d, _mm512_mul_ps(boxLength[k], t));
+      d2 = (k == 0) ? _mm512_mul_ps(d, d) : _mm512_add_ps(d2, _mm512_mul_ps(d, d));
+    }
+    __mmask16 inside = _mm512_cmp_ps_mask(d2, cut2, _CMP_LT_OQ);
+    if (inside == 0) {
+      continue;
+    }
+    _mm512_store_ps(r2, d2);
+    // Bin the lanes one at a time, in double
+    for (int lane = 0; lane < 16; lane++) {
+      if (!((inside >> lane) & 1)) {
+        continue;
+      }
+      r_ij = sqrt((double)r2[lane]);
+      if (r_ij < cutoff) {
+        if (jType) {
+          rdfArray[rowOffset[jType[jatom + lane]] + (int)(r_ij / binsize)] += 1;
+        } else {
+          rdfArray[(int)(r_ij / binsize)] += 1;
+        }
+      }
+    }
+  } // end of loop through vectors
+#elif defined(__AVX2__)
+  // ---------------------------
+  // AVX2: 8 particles at a time
+  const __m256 half = _mm256_set1_ps(0.5f);
+  const __m256 one = _mm256_set1_ps(1.0f);
+  const __m256 signBit = _mm256_set1_ps(-0.0f);
+  const __m256 cut2 = _mm256_set1_ps(cutoff2);
+  const __m256 boxLength[3] = {_mm256_set1_ps(boxf[0]), _mm256_set1_ps(boxf[1]),
+                               _mm256_set1_ps(boxf[2])};
+  const __m256 ri[3] = {_mm256_set1_ps(xi), _mm256_set1_ps(yi),
+                        _mm256_set1_ps(zi)};
+  const float *rj[3] = {x, y, z};
+  alignas(32) float r2[8]; // Squared distances of the lanes
+
+  for (; jatom + 8 <= jEnd; jatom += 8) {
+    __m256 d2 = _mm256_setzero_ps();
+    for (int k = 0; k < 3; k++) {
+      __m256 d = _mm256_sub_ps(ri[k], _mm256_loadu_ps(rj[k] + jatom));
+      // round(d / box), rounding halves away from zero
+      __m256 q = _mm256_div_ps(d, boxLength[k]);
+      __m256 t = _mm256_round_ps(q, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+      __m256 up = _mm256_cmp_ps(_mm256_andnot_ps(signBit, _mm256_sub_ps(q, t)),
+                                half, _CMP_GE_OQ);
+      __m256 sign = _mm256_or_ps(_mm256_and_ps(q, signBit), one);
+      t = _mm256_add_ps(t, _mm256_and_ps(up, sign));
+      // Apply PBCs
+      d = _mm256_sub_ps(d, _mm256_mul_ps(boxLength[k], t));
+      d2 = (k == 0) ? _mm256_mul_ps(d, d) : _mm256_add_ps(d2, _mm256_mul_ps(d, d));
+    }
+    int inside = _mm256_movemask_ps(_mm256_cmp_ps(d2, cut2, _CMP_LT_OQ));
+    if (inside == 0) {
+      continue;
+    }
+    _mm256_store_ps(r2, d2);
+    // Bin the lanes one at a time, in double
+    for (int lane = 0; lane < 8; lane++) {
+      if (!((inside >> lane) & 1)) {
+        continue;
+      }
+      r_ij = sqrt((double)r2[lane]);
+      if (r_ij < cutoff) {
+        if (jType) {
+          rdfArray[rowOffset[jType[jatom + lane]] + (int)(r_ij / binsize)] += 1;
+        } else {
+          rdfArray[(int)(r_ij / binsize)] += 1;
+        }
+      }
+    }
+  } // end of loop through vectors
+#endif
+  // ---------------------------
+  // Scalar remainder
+  for (; jatom < jEnd; jatom++) {
+    rdf::binPairFloat(xi - x[jatom], yi - y[jatom], zi - z[jatom], boxf,
+                      cutoff, binsize,
+                      jType ? rdfArray + rowOffset[jType[jatom]] : rdfArray);
+  }
+}
+
+/********************************************/ /**
+ *  Function for binning the distances between particle i and the particles
+ [jBegin, jEnd) of a structure-of-arrays, in a triclinic periodic box.
+ *
+ * The coordinates are fractional (see rdf::toFractional). The particles are
+ handled in blocks: the squared minimum image distances of a whole block are
+ found first, and the pairs within the cutoff are then binned. The fractional
+ separations are rounded to the nearest integer by adding and subtracting
+ \f$1.5 \times 2^{52}\f$, which needs neither a division nor a call, so the
+ first loop is vectorized. As in rdf::binRow, if jType is given, the pair with
+ particle j is binned into the histogram starting at
+ rdfArray[rowOffset[jType[j]]]. With float coordinates, the separations are
+ rounded by adding and subtracting \f$1.5 \times 2^{23}\f$ instead, and the
+ distances are binned in double.
+ *
+ *  @param[in] sxi The fractional coordinate of particle i along a
+ *  @param[in] syi The fractional coordinate of particle i along b
+ *  @param[in] szi The fractional coordinate of particle i along c
+ *  @param[in] sx The fractional coordinates of the other particles along a
+ *  @param[in] sy The fractional coordinates of the other particles along b
+ *  @param[in] sz The fractional coordinates of the other particles along c
+ *  @param[in] jType The atom types of the other particles, or nullptr to bin
+ every pair into the same histogram
+ *  @param[in] rowOffset The offset of the histogram of particle i paired with
+ each atom type (not used if jType is nullptr)
+ *  @param[in] jBegin The first particle of the range
+ *  @param[in] jEnd The particle after the last particle of the range
+ *  @param[in] cell The cell matrix of the box
+ *  @param[in] cutoff The cutoff of the \f$g(r)\f$, which should be at most
+ half the smallest perpendicular width of the box
+ *  @param[in] binsize The bin width
+ *  @param[in] rdfArray The histogram, to which 1 is added per pair
+ ***********************************************/
+template <typename T>
+void rdf::binRowTriclinic(T sxi, T syi, T szi, const T *sx, const T *sy,
+                          const T *sz, const int *jType, const int *rowOffset,
+                          int jBegin, int jEnd, const rdf::CellMatrix &cell,
+                          double cutoff, double binsize, uint64_t *rdfArray) {
+  const bool single = sizeof(T) < sizeof(double); // Float coordinates
+  const int blockSize = 256; // Particles whose distances are found at a time
+  alignas(64) T r2[blockSize]; // Squared distances of the block
+  // Squared cutoff, enlarged so that no pair within the cutoff is dropped
+  T cutoff2 = (T)(cutoff * cutoff * (1.0 + (single ? 1e-5 : 1e-10)));
+  // Adding and subtracting this rounds a T to the nearest integer
+  const T roundShift = single ? (T)12582912.0 : (T)6755399441055744.0;
+  const T lx = cell.h[0], ly = cell.h[1], lz = cell.h[2]; // Cell matrix
+  const T xy = cell.h[3], xz = cell.h[4], yz = cell.h[5];
+  T dsx, dsy, dsz; // Fractional separation of a pair
+  T dx, dy, dz;    // Separation of a pair
+  double r_ij;     // Distance of a pair
+  int n;                // Particles in the current block
+
+  for (int jStart = jBegin; jStart < jEnd; jStart += blockSize) {
+    n = std::min(blockSize, jEnd - jStart);
+    // Minimum image distances of the block
+    for (int j = 0; j < n; j++) {
+      dsx = sxi - sx[jStart + j];
+      dsy = syi - sy[jStart + j];
+      dsz = szi - sz[jStart + j];
+      dsx -= (dsx + roundShift) - roundShift;
+      dsy -= (dsy + roundShift) - roundShift;
+      dsz -= (dsz + roundShift) - roundShift;
+      dx = lx * dsx + xy * dsy + xz * dsz;
+      dy = ly * dsy + yz * dsz;
+      dz = lz * dsz;
+      r2[j] = dx * dx + dy * dy + dz * dz;
+    } // end of loop through the block
+    // Bin the pairs within the cutoff
+    for (int j = 0; j < n; j++) {
+      if (r2[j] >= cutoff2) {
+        continue;
+      }
+      r_ij = sqrt((double)r2[j]);
+      if (r_ij < cutoff) {
+        if (jType) {
+          rdfArray[rowOffset[jType[jStart + j]] + (int)(r_ij / binsize)] += 1;
+        } else {
+          rdfArray[(int)(r_ij / binsize)] += 1;
+        }
+      }
+    } // end of binning the block
+  }   // end of loop through blocks
+}
+
+// The triclinic kernel is compiled for double and float coordinates
+template void rdf::binRowTriclinic<double>(double, double, double,
+                                           const double *, const double *,
+                                           const double *, const int *,
+                                           const int *, int, int,
+                                           const rdf::CellMatrix &, double,
+                                           double, uint64_t *);
+template void rdf::binRowTriclinic<float>(float, float, float, const float *,
+                                          const float *, const float *,
+                                          const int *, const int *, int, int,
+                                          const rdf::CellMatrix &, double,
+                                          double, uint64_t *);
@@ -1,203 +1,682 @@
 // Standard Library
+#include <algorithm>
 #include <iostream>
 #include <memory>
 #include <numeric>
 
+#ifdef USE_MPI
+#include <mpi.h>
+#endif // USE_MPI
+
 // Internal Libraries
+#include <accumulator.hpp>
+#include <analysis.hpp>
+#include <batch.hpp>
+#include <binaryTraj.hpp>
+#include <checkpoint.hpp>
+#include <config.hpp>
 #include <generic.hpp>
 #include <inputOutput.hpp>
+#include <pipeline.hpp>
+#include <profiler.hpp>
 #include <rdf.hpp>
+#include <selection.hpp>
+#include <streamReader.hpp>
+#include <structure.hpp>
+#include <window.hpp>
 
-int main() {
+int main(int argc, char *argv[]) {
   // -------------------------------------------- // User-input
-  // Maybe read the inputs in more elegantly
-  std::string lammpsInputTraj = "./../../data/liq-mW"; // relative path
-  // All steps start from 1, and are the number, not the actual timestep value
-  int numCalcSteps = 10; // Number of steps for which to do the calculation 1000
-  int stepGap = 1;       // Gap between steps
-  // Make equiliSteps one if you don't want to skip anything
-  int equiliSteps = 1; // Number of steps to skip (last frame exclusive)
-  // RDF
-  double binsize = 0.01; // In Angstroms
-  double cutoff = 12; // Cutoff for the RDF (should be less than half the box)
+  // Read from a configuration file and the command line; see io::RunConfig
+  // for the settings and their defaults, or run with --help
+  io::RunConfig config;
   // -------------------------------------------- // Variables
   int totalSteps = 0;      // Starts from 1
-  std::vector<double> box; // Box lengths
-  int nop;                 // Total number of particles in the box
-  int dim;                 // Number of dimensions
-  // Vector of vectors containing the coordinates
-  std::vector<std::vector<double>> coord;
-  std::vector<double> iatomCoord; // Coordinates of a particular iatom
+  // Reusable frame, holding the coordinates and box of the current frame
+  gen::Frame frame;
+  // Offset, timestep, number of atoms and box of every frame
+  std::vector<io::FrameIndexEntry> frameIndex;
   // File handling and I/O
-  std::unique_ptr<std::ifstream> dumpFile;
-  dumpFile = std::make_unique<std::ifstream>(lammpsInputTraj);
-  int targetFrame;  // Current frame to process
-  int currentFrame; // Current frame number
-  std::string line; // Current line  being read in
-  int atomIndex;    // Column number from which x y z coordinates starts
-  bool fillCoord;   // true if the frame is to be processed
-  std::vector<std::string> tokens; // Vector containing word tokens
-  std::vector<double> numbers;     // Vector containing type double numbers
+  io::MappedFile dumpFile; // Memory map of the whole trajectory
+  // Binary trajectory (see yodaConvert), read natively if given
+  bool isBinary;
+  io::BinaryTrajectory binaryTraj;
+  // Streamed (stdin or compressed) trajectory, read in a single pass
+  bool isStream;
+  io::FrameStream stream;
+  int nstreamFrames = 0;   // Frames of the stream read so far
+  int nselected = 0;       // Frames of the stream selected so far
+  bool haveFrame = false;  // true if frame holds the first frame of a stream
+  bool streamDone = false; // true once the stream has run out of frames
+  // Frames to be processed
+  io::FrameSelection selection;
+  std::vector<int> selectedFrames; // Selected frames (from 0), if indexed
+  io::FrameIndexEntry lastEntry;   // Header of the last frame read in
+  int ntasks;              // Number of frames processed by this rank
+  int fail;                // Non-zero if a frame could not be read
+  // Checkpoints
+  bool checkpointing;      // true if checkpoints are written
+  std::vector<std::string> checkpointFiles; // Checkpoint of every analysis
+  int segmentStart = 0;    // First selected frame of the current segment
+  int segmentSize;         // Frames between checkpoints (or blocks)
+  int sinceCheckpoint = 0; // Frames processed since the last checkpoint
+  bool done;               // true once the last segment has been processed
+  long long doneTimestep = -1; // Last timestep of the resumed checkpoints
+  // Block averages
+  bool blocking;           // true if the frames are split into blocks
+  bool converged = false;  // true once the errors are below the threshold
+  // Time-resolved g(r)
+  bool windowing;          // true if the g(r) of windows of frames is found
+  int windowStride;        // Frames between the starts of windows
+  long long segmentFirst = -1; // First timestep of the current segment
+  // -------------------------------------------- // MPI Variables
+  int rank = 0;   // Rank of this process
+  int nranks = 1; // Total number of processes
   // -------------------------------------------- // RDF Specific Variables
-  int nbin;      // Number of bins
-  int switchVar; // equal to 0 for init, 1 for adding and 2 for final
-                 // normalization
-  int nframes;   // Number of frames; used for normalizing g(r)
+  std::vector<rdf::Analysis> analyses; // Settings of every analysis
+  int nanalyses;                       // Number of analyses
+  int maxType = 1;         // Largest atom type of the trajectory
+  std::vector<int> ntypes; // Atom types of every analysis (1 if ignored)
+  // Accumulations of earlier runs (from the checkpoints), analyses of each
+  // compute worker, and accumulations of everything, for every analysis
+  std::vector<rdf::RdfState> resumed;
+  std::vector<rdf::AnalysisSet> workers;
+  std::vector<rdf::RdfState> total;
+  // Accumulations of everything when the current block (or segment of a
+  // window) started, and the block averages (on rank 0), for every analysis
+  std::vector<rdf::RdfState> blockStart;
+  std::vector<rdf::BlockStats> blocks;
+  // Sliding windows, and their output files (on rank 0), for every analysis
+  std::vector<rdf::WindowStats> windows;
+  std::vector<io::WindowWriter> windowFiles;
   // -------------------------------------------- // Main logic
 
-  // Read in the total number of steps.
-  // In this case, nop does not change throughout
-  io::getTotalTimesteps(lammpsInputTraj, &totalSteps);
+#ifdef USE_MPI
+  // Every rank processes its own share of the selected frames
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &nranks);
+#endif // USE_MPI
 
-  // ----
-  // Allocate the RDF array
-  nbin = (int)(cutoff / binsize) + 1;
-  double rdf[nbin]; // init
-  // Initialize the RDF
-  switchVar = 0;
-  nop = 0;
-  rdf::gr(rdf, &nframes, binsize, nbin, box, coord, cutoff, nop, switchVar);
-  // ----
+  // Every rank reads the same settings
+  if (io::parseArguments(argc, argv, &config) != 0 ||
+      io::resolveAnalyses(config, &analyses) != 0) {
+    if (rank == 0) {
+      std::cerr << "Run " << argv[0] << " --help for the usage.\n";
+    }
+#ifdef USE_MPI
+    MPI_Finalize();
+#endif // USE_MPI
+    return 1;
+  }
+  if (config.help) {
+    if (rank == 0) {
+      io::printUsage(std::cout, argv[0]);
+    }
+#ifdef USE_MPI
+    MPI_Finalize();
+#endif // USE_MPI
+    return 0;
+  }
+  // Batch mode analyses every trajectory of the list instead
+  if (!config.batch.empty()) {
+    std::vector<std::string> trajectories; // Trajectories of the batch
+    fail = batch::readTrajectoryList(config.batch, &trajectories);
+    if (fail == 0) {
+      fail = batch::run(config, analyses, trajectories, rank, nranks);
+    }
+#ifdef USE_PROFILING
+    if (rank == 0) {
+      prof::report(std::cerr);
+    }
+#endif // USE_PROFILING
+#ifdef USE_MPI
+    MPI_Finalize();
+#endif // USE_MPI
+    return fail;
+  }
+  nanalyses = analyses.size();
+  isStream = io::isStreamInput(config.trajectory);
+  isBinary = !isStream && io::isBinaryTrajectory(config.trajectory);
+  checkpointing = !config.checkpoint.empty() && config.checkpointEvery > 0;
+  blocking = config.blockFrames > 0;
+  windowing = config.windowFrames > 0;
+  windowStride =
+      (config.windowStride > 0) ? config.windowStride : config.windowFrames;
+  // With several analyses, each has its own checkpoint
+  for (int ianalysis = 0;
+       ianalysis < nanalyses && !config.checkpoint.empty(); ianalysis++) {
+    checkpointFiles.push_back(
+        (nanalyses > 1) ? config.checkpoint + "." + analyses[ianalysis].name
+                        : config.checkpoint);
+  }
+  // The frames processed are equiliSteps, equiliSteps + stepGap, ..., or
+  // those in the range of timesteps
+  selection.firstFrame = config.equiliSteps;
+  selection.frameStride = config.stepGap;
+  selection.maxFrames = config.selectByTimestep ? -1 : config.numCalcSteps;
+  selection.byTimestep = config.selectByTimestep;
+  selection.firstTimestep = config.firstTimestep;
+  selection.lastTimestep = config.lastTimestep;
+  selection.timestepStride = config.timestepStride;
+
+  // Reads the next selected frame of a stream, skipping the others (and those
+  // already in the checkpoint) without parsing them; returns 0 (success), 1
+  // (error) or -1 (no frames left)
+  auto nextSelected = [&](gen::Frame *buffer) {
+    io::FrameIndexEntry entry; // Header of the next frame
+    int status;                // Result of reading the header
+    while (selection.maxFrames < 0 || nselected < selection.maxFrames) {
+      status = stream.nextHeader(&entry);
+      if (status != 0) {
+        return status;
+      }
+      nstreamFrames++;
+      if (selection.isPast(entry.timestep)) {
+        return -1;
+      }
+      if (selection.selects(nstreamFrames, entry.timestep)) {
+        nselected++;
+        if (entry.timestep <= doneTimestep) {
+          continue;
+        }
+        lastEntry = entry;
+        return stream.parse(buffer);
+      }
+    }
+    return -1;
+  };
 
-  // Check to make sure that the user has entered valid  steps
-  if (equiliSteps + numCalcSteps * equiliSteps > totalSteps) {
+  if (!selection.isValid()) {
+    std::cerr << "You have entered an unfeasible number of calculation or "
+                 "equilibrium steps.\n";
+#ifdef USE_MPI
+    MPI_Abort(MPI_COMM_WORLD, 1);
+#endif // USE_MPI
+    return 1;
+  }
+  // A window is made up of whole segments of windowStride frames, and the
+  // windows are not saved in checkpoints
+  if (windowing && (config.windowFrames % windowStride != 0 || blocking ||
+                    !config.checkpoint.empty())) {
+    if (rank == 0) {
+      std::cerr << "windowFrames must be a multiple of windowStride, and "
+                   "windows cannot be combined with blocks or "
+                   "checkpoints.\n";
+    }
+#ifdef USE_MPI
+    MPI_Finalize();
+#endif // USE_MPI
+    return 1;
+  }
+
+  // Resume from the checkpoints. Only rank 0 holds the earlier accumulations
+  resumed.resize(nanalyses);
+  for (int ianalysis = 0; rank == 0 && config.resume &&
+                          ianalysis < checkpointFiles.size();
+       ianalysis++) {
+    const rdf::Analysis &analysis = analyses[ianalysis];
+    if (!io::file_exists(checkpointFiles[ianalysis])) {
+      continue;
+    }
+    if (io::readCheckpoint(checkpointFiles[ianalysis], &resumed[ianalysis]) !=
+        0) {
+#ifdef USE_MPI
+      MPI_Abort(MPI_COMM_WORLD, 1);
+#endif // USE_MPI
+      return 1;
+    }
+    if (resumed[ianalysis].binsize != analysis.binsize ||
+        resumed[ianalysis].cutoff != analysis.cutoff ||
+        resumed[ianalysis].nbin != analysis.nbin() ||
+        resumed[ianalysis].selection != analysis.selection()) {
+      std::cerr << "The checkpoint " << checkpointFiles[ianalysis]
+                << " was made with a different bin size, cutoff or atom "
+                   "selection.\n";
+#ifdef USE_MPI
+      MPI_Abort(MPI_COMM_WORLD, 1);
+#endif // USE_MPI
+      return 1;
+    }
+    std::cerr << "Resuming from " << checkpointFiles[ianalysis] << " ("
+              << resumed[ianalysis].nframes << " frames, up to timestep "
+              << resumed[ianalysis].lastTimestep << ")\n";
+  }
+  // The analyses are checkpointed together, so they must carry on from the
+  // same frame
+  doneTimestep = resumed[0].lastTimestep;
+  for (int ianalysis = 1; ianalysis < nanalyses; ianalysis++) {
+    if (resumed[ianalysis].lastTimestep != doneTimestep) {
+      std::cerr << "The checkpoints of the analyses do not end at the same "
+                   "timestep.\n";
+#ifdef USE_MPI
+      MPI_Abort(MPI_COMM_WORLD, 1);
+#endif // USE_MPI
+      return 1;
+    }
+  }
+#ifdef USE_MPI
+  MPI_Bcast(&doneTimestep, 1, MPI_LONG_LONG, 0, MPI_COMM_WORLD);
+#endif // USE_MPI
+
+  // ---------------------------
+  // Streamed trajectories are read front to back, so the frame count is never
+  // needed. The first selected frame is read in straight away
+  if (isStream) {
+    if (nranks > 1) {
+      std::cerr << "A streamed trajectory can only be read by one process.\n";
+#ifdef USE_MPI
+      MPI_Abort(MPI_COMM_WORLD, 1);
+#endif // USE_MPI
+      return 1;
+    }
+    if (stream.open(config.trajectory) != 0) {
+      return 1;
+    }
+    fail = nextSelected(&frame);
+    if (fail > 0 || (fail < 0 && doneTimestep < 0)) {
+      if (fail < 0) {
+        std::cerr << "No frames of the trajectory were selected.\n";
+      }
+      return 1;
+    }
+    haveFrame = (fail == 0);
+    streamDone = !haveFrame;
+  }
+  // Get the frame index, which gives the total number of steps.
+  // This is only built once, and saved next to the trajectory.
+  // Binary trajectories carry their own index
+  else if (isBinary) {
+    if (binaryTraj.open(config.trajectory) != 0) {
+#ifdef USE_MPI
+      MPI_Abort(MPI_COMM_WORLD, 1);
+#endif // USE_MPI
+      return 1;
+    }
+    frameIndex = binaryTraj.frameIndex();
+  } else if (rank == 0 &&
+             io::getFrameIndex(config.trajectory, &frameIndex) != 0) {
+#ifdef USE_MPI
+    MPI_Abort(MPI_COMM_WORLD, 1);
+#endif // USE_MPI
+    return 1;
+  }
+  totalSteps = frameIndex.size();
+#ifdef USE_MPI
+  // Only rank 0 reads or writes the sidecar file; the others get a copy
+  MPI_Bcast(&totalSteps, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  frameIndex.resize(totalSteps);
+  MPI_Bcast(frameIndex.data(), totalSteps * sizeof(io::FrameIndexEntry),
+            MPI_BYTE, 0, MPI_COMM_WORLD);
+#endif // USE_MPI
+
+  // Check to make sure that the user has entered valid steps
+  selectedFrames = io::selectFrames(frameIndex, selection);
+  if (!isStream &&
+      (selectedFrames.empty() ||
+       (!config.selectByTimestep &&
+        selectedFrames.size() < config.numCalcSteps))) {
     // do error handling later
     std::cerr << "You have entered an unfeasible number of calculation or "
                  "equilibrium steps.\n";
     std::cerr << "The total number of frames in the trajectory file is "
               << totalSteps << "\n";
+#ifdef USE_MPI
+    MPI_Abort(MPI_COMM_WORLD, 1);
+#endif // USE_MPI
     return 1;
   } // end of check
+  // Leave out the frames which are already in the checkpoint
+  selectedFrames.erase(
+      std::remove_if(selectedFrames.begin(), selectedFrames.end(),
+                     [&](int iframe) {
+                       return frameIndex[iframe].timestep <= doneTimestep;
+                     }),
+      selectedFrames.end());
 
-  // Open the file
-  if (dumpFile->is_open()) {
-
-    // Loop through timesteps
-    // ---------------------------
-    // Skip the equilibrium steps
-    currentFrame = 0; // init
-
-    // This loop goes through all the steps
-    while (std::getline((*dumpFile), line)) {
-      // Read in lines and tokenize them
-      tokens = io::tokenizer(line);
-      // Find out which timestep number
-      // you are inside
-      if (tokens[0].compare("ITEM:") == 0) {
-        if (tokens[1].compare("TIMESTEP") == 0) {
-          // Now you are in a new timestep. Update frame number
-          currentFrame++;
-        }
+  // Map the file
+  if (!isStream && !isBinary && dumpFile.open(config.trajectory) != 0) {
+#ifdef USE_MPI
+    MPI_Abort(MPI_COMM_WORLD, 1);
+#endif // USE_MPI
+    return 1;
+  }
+
+  // The largest atom type of the last frame gives the number of types (a
+  // stream has only reached its first frame). When resuming, the number of
+  // types of the checkpoint is kept
+  fail = 0;
+  if (isBinary && !selectedFrames.empty()) {
+    fail = binaryTraj.readFrame(selectedFrames.back(), &frame);
+  } else if (!isStream && !selectedFrames.empty()) {
+    const char *cursor =
+        dumpFile.data() + frameIndex[selectedFrames.back()].offset;
+    fail = io::parseFrame(&cursor, dumpFile.end(), &frame);
+  }
+  if (fail != 0) {
+#ifdef USE_MPI
+    MPI_Abort(MPI_COMM_WORLD, 1);
+#endif // USE_MPI
+    return 1;
+  }
+  if (frame.nop > 0) {
+    maxType = *std::max_element(frame.type.begin(), frame.type.end());
+  }
+  ntypes.resize(nanalyses);
+  for (int ianalysis = 0; ianalysis < nanalyses; ianalysis++) {
+    ntypes[ianalysis] = analyses[ianalysis].numberOfTypes(maxType);
+    if (resumed[ianalysis].nframes > 0) {
+      ntypes[ianalysis] = resumed[ianalysis].ntypes;
+    }
+  }
+#ifdef USE_MPI
+  MPI_Bcast(ntypes.data(), nanalyses, MPI_INT, 0, MPI_COMM_WORLD);
+#endif // USE_MPI
+
+  // ----
+  // Set up the accumulations, with one histogram per pair of types
+  total.resize(nanalyses);
+  for (int ianalysis = 0; ianalysis < nanalyses; ianalysis++) {
+    const rdf::Analysis &analysis = analyses[ianalysis];
+    rdf::initState(&total[ianalysis], analysis.binsize, analysis.cutoff,
+                   analysis.nbin(), ntypes[ianalysis], analysis.selection());
+    if (resumed[ianalysis].nframes == 0) {
+      resumed[ianalysis] = total[ianalysis];
+    }
+  }
+  blockStart = resumed;
+  blocks.assign(nanalyses, rdf::BlockStats());
+  if (windowing) {
+    windows.resize(nanalyses);
+    windowFiles.resize(nanalyses);
+  }
+  for (int ianalysis = 0; ianalysis < windows.size(); ianalysis++) {
+    windows[ianalysis].nsegments = config.windowFrames / windowStride;
+    if (rank != 0) {
+      continue;
+    }
+    boost::filesystem::create_directories(config.outputDir);
+    if (windowFiles[ianalysis].open(
+            (boost::filesystem::path(config.outputDir) /
+             io::outputName(analyses[ianalysis].name, "windows", ".bin"))
+                .string(),
+            total[ianalysis], config.windowFrames, windowStride) != 0) {
+#ifdef USE_MPI
+      MPI_Abort(MPI_COMM_WORLD, 1);
+#endif // USE_MPI
+      return 1;
+    }
+  }
+  workers.resize(config.nComputeWorkers);
+  for (int iworker = 0; iworker < config.nComputeWorkers; iworker++) {
+    for (int ianalysis = 0; ianalysis < nanalyses; ianalysis++) {
+      if (workers[iworker].add(analyses[ianalysis], ntypes[ianalysis]) != 0) {
+#ifdef USE_MPI
+        MPI_Abort(MPI_COMM_WORLD, 1);
+#endif // USE_MPI
+        return 1;
       }
+    }
+  }
+  // ----
 
-      if (currentFrame == equiliSteps) {
-        break;
+  // Adds up the accumulations of the earlier runs, the workers and the ranks
+  // (on rank 0), for the checkpoints and the final result
+  auto sumStates = [&]() {
+    PROF_SCOPE("merge");
+    std::vector<rdf::RdfState> sums = resumed; // Sums of the accumulations
+    for (int ianalysis = 0; ianalysis < nanalyses; ianalysis++) {
+      rdf::RdfState &sum = sums[ianalysis]; // Sum of this analysis
+      if (rank != 0) {
+        sum = total[ianalysis];
+        rdf::initState(&sum, sum.binsize, sum.cutoff, sum.nbin, sum.ntypes,
+                       sum.selection);
       }
-    } // End of while loop searching for targetFrame
-
-    targetFrame = equiliSteps; // init (includes the last frame of equiliSteps)
-
-    // Loop through the rest of the traj file
-    for (int iframe = 1; iframe <= numCalcSteps; iframe++) {
-
-      getline((*dumpFile), line); // Timestep Number
-      getline((*dumpFile), line); // ITEM: NUMBER OF ATOMS
-      getline((*dumpFile), line); // Number of atoms
-      nop = std::stoi(line);      // Update number of atoms
-      getline((*dumpFile), line); // ITEM: BOX BOUNDS pp pp pp
-      // Get the box lengths
-      box.clear();
-      while (std::getline((*dumpFile), line)) {
-        // Read in lines and tokenize them
-        tokens = io::tokenizer(line);
-        // Break out once box lengths have been read in
-        if (tokens[0].compare("ITEM:") == 0) {
-          break;
-        } // ITEM: ATOMS id type x y z
-        // Get the box lengths
-        numbers = io::tokenizerDouble(line);
-        // Add to the box length vector
-        box.push_back(numbers[1] - numbers[0]);
-      } // end of getting the box lengths
-
-      dim = box.size(); // Number of dimensions
-      // ---
-      // Find the index from which the coordinates will be filled
-      // ITEM: ATOMS id type x y z
-      tokens = io::tokenizer(line);
-      auto it = std::find(tokens.begin(), tokens.end(), "x");
-      if (it != tokens.end()) {
-        int index = std::distance(tokens.begin(), it);
-        atomIndex = index - 2;
-      } else {
-        std::cerr << "Invalid traj file perhaps!\n";
-        return 1;
+      for (int iworker = 0; iworker < config.nComputeWorkers; iworker++) {
+        rdf::mergeState(&sum, workers[iworker][ianalysis].state());
+      }
+#ifdef USE_MPI
+      // Collective; every rank must call this at the same point
+      void *sendHist = (rank == 0) ? MPI_IN_PLACE : sum.histogram.data();
+      void *sendCount = (rank == 0) ? MPI_IN_PLACE : sum.sumCount.data();
+      void *sendSelected =
+          (rank == 0) ? MPI_IN_PLACE : sum.sumSelected.data();
+      void *sendFrames = (rank == 0) ? MPI_IN_PLACE : &sum.nframes;
+      void *sendVolume = (rank == 0) ? MPI_IN_PLACE : &sum.sumVolume;
+      void *sendStep = (rank == 0) ? MPI_IN_PLACE : &sum.lastTimestep;
+      MPI_Reduce(sendHist, sum.histogram.data(), sum.histogram.size(),
+                 MPI_UINT64_T, MPI_SUM, 0, MPI_COMM_WORLD);
+      MPI_Reduce(sendCount, sum.sumCount.data(), sum.sumCount.size(),
+                 MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+      MPI_Reduce(sendSelected, sum.sumSelected.data(), sum.sumSelected.size(),
+                 MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+      MPI_Reduce(sendFrames, &sum.nframes, 1, MPI_INT, MPI_SUM, 0,
+                 MPI_COMM_WORLD);
+      MPI_Reduce(sendVolume, &sum.sumVolume, 1, MPI_DOUBLE, MPI_SUM, 0,
+                 MPI_COMM_WORLD);
+      MPI_Reduce(sendStep, &sum.lastTimestep, 1, MPI_LONG_LONG, MPI_MAX, 0,
+                 MPI_COMM_WORLD);
+#endif // USE_MPI
+      if (sum.lastTimestep == lastEntry.timestep) {
+        sum.lastOffset = lastEntry.offset;
       }
-      // ---
-
-      fillCoord = false;
-      // If currentFrame is not equal to targetFrame, skip
-      if (currentFrame != targetFrame) {
-        // Go through the atom coordinate lines
-        for (int iatom = 1; iatom <= nop; iatom++) {
-          getline((*dumpFile), line); // 1 1 0 0 0 etc
-        }                             // end of loop through atoms
-      } // end of skipping when targetFrame is not equal to currentFrame
-      // Fill up the coordinate array
-      else {
-        fillCoord = true;
-        // Empty the vector of vectors
-        std::vector<std::vector<double>> emptyVec;
-        coord.swap(emptyVec);
-
-        // Go through the atom coordinate lines
-        for (int iatom = 1; iatom <= nop; iatom++) {
-          getline((*dumpFile), line); // 1 1 0 0 0 etc
-          // Fill stuff
-          iatomCoord.resize(0);
-          numbers = io::tokenizerDouble(line);
-          // Fill from atomIndex onwards
-          for (int k = atomIndex; k < atomIndex + dim; k++) {
-            iatomCoord.push_back(numbers[k]);
-          } // end of update of iatomCoord
-          // Update coord
-          coord.push_back(iatomCoord);
-        } // end of loop through atoms
-      }   // end of filling up the coordinate array
-
-      getline((*dumpFile), line); // ITEM: TIMESTEP
-      currentFrame++;             // Update the frame number
-
-      // Update the next value of targetFrame
-      targetFrame = equiliSteps + iframe * stepGap;
-
-      // ---------------------------
-      // Do stuff if the coordinates have been filled
-      // Process targetFrame
-      if (fillCoord) {
-        switchVar = 1;
-        // Accumulate the rdf
-        rdf::gr(rdf, &nframes, binsize, nbin, box, coord, cutoff, nop,
-                switchVar);
-      } // End of processing targetFrame
-      // ---------------------------
-    } // end of loop through calculation frames
-
-  } // end of lammps traj open statement
-
-  dumpFile->close(); // Close the lammps file
-
-  // // Normalize the RDF
-  switchVar = 2;
-  rdf::gr(rdf, &nframes, binsize, nbin, box, coord, cutoff, nop, switchVar);
+    } // end of loop through analyses
+    return sums;
+  };
 
-  // // -------------------------------------------- // Write out the RDF
+  // Loop through the frames to be processed.
+  // With MPI, the frames are dealt out to the ranks in turn. A stream is read
+  // until it runs out of selected frames.
+  // A reader thread parses the frames into a pool of frame buffers, while the
+  // compute workers add them to all of their analyses. With checkpoints, the
+  // frames are processed in segments, after each of which everything
+  // accumulated so far is saved. With blocks, every segment is a block, and
+  // checkpoints are saved once enough blocks have gone by. With windows,
+  // every segment is the stride between windows
+  // ---------------------------
+  if (blocking) {
+    segmentSize = config.blockFrames;
+  } else if (windowing) {
+    segmentSize = windowStride;
+  } else {
+    segmentSize =
+        checkpointing ? config.checkpointEvery : selectedFrames.size();
+  }
+  done = isStream ? streamDone : selectedFrames.empty();
+  while (!done) {
+    int nsegment =
+        std::min<int>(segmentSize, selectedFrames.size() - segmentStart);
+    if (isStream) {
+      ntasks = (checkpointing || blocking || windowing) ? segmentSize : -1;
+      nsegment = segmentSize;
+    } else {
+      ntasks = (nsegment - rank + nranks - 1) / nranks;
+      segmentFirst = frameIndex[selectedFrames[segmentStart]].timestep;
+    }
+    fail = pipeline::run(
+        ntasks,
+        // Go straight to the frame, and parse it in place
+        [&](int itask, gen::Frame *buffer) {
+          PROF_SCOPE("read");
+          int status = 0; // Result of reading the frame
+          if (isStream) {
+            // The first frame has already been read
+            if (haveFrame) {
+              std::swap(*buffer, frame);
+              haveFrame = false;
+            } else if ((status = nextSelected(buffer)) < 0) {
+              streamDone = true;
+            }
+            if (itask == 0 && status == 0) {
+              segmentFirst = buffer->timestep;
+            }
+          } else {
+            int target = selectedFrames[segmentStart + rank + itask * nranks];
+            if (isBinary) {
+              status = binaryTraj.readFrame(target, buffer);
+            } else {
+              const char *cursor = dumpFile.data() + frameIndex[target].offset;
+              status = io::parseFrame(&cursor, dumpFile.end(), buffer);
+            }
+          }
+          PROF_COUNT(framesRead, status == 0);
+          return status;
+        },
+        // Accumulate the rdf of every analysis
+        [&](int iworker, const gen::Frame &buffer) {
+          PROF_SCOPE("accumulate");
+          return workers[iworker].addFrame(buffer);
+        },
+        config.nComputeWorkers, config.nFrameBuffers);
+    if (fail != 0) {
+#ifdef USE_MPI
+      MPI_Abort(MPI_COMM_WORLD, 1);
+#endif // USE_MPI
+      return 1;
+    }
+    if (isStream && ntasks < 0) {
+      streamDone = true;
+    }
+    if (!isStream) {
+      lastEntry = frameIndex[selectedFrames[segmentStart + nsegment - 1]];
+      segmentStart += nsegment;
+    }
+    // Add the block to the block averages, and stop once the errors of every
+    // analysis are small enough. A short last block would weigh as much as
+    // the full ones, so it only counts towards the g(r)
+    if (blocking) {
+      total = sumStates();
+      for (int ianalysis = 0; rank == 0 && ianalysis < nanalyses;
+           ianalysis++) {
+        rdf::RdfState block = total[ianalysis]; // Accumulation of this block
+        rdf::subtractState(&block, blockStart[ianalysis]);
+        if (block.nframes == config.blockFrames) {
+          rdf::addBlock(&blocks[ianalysis], rdf::normalizeState(block));
+        }
+        blockStart[ianalysis] = total[ianalysis];
+      }
+      if (rank == 0 && config.errorThreshold > 0 &&
+          blocks[0].nblocks >= std::max(config.minBlocks, 2)) {
+        converged = true;
+        for (int ianalysis = 0; ianalysis < nanalyses; ianalysis++) {
+          std::vector<double> error = rdf::standardError(blocks[ianalysis]);
+          converged = converged &&
+                      *std::max_element(error.begin(),
+                                        error.begin() + total[ianalysis].nbin) <
+                          config.errorThreshold;
+        }
+      }
+#ifdef USE_MPI
+      MPI_Bcast(&converged, 1, MPI_CXX_BOOL, 0, MPI_COMM_WORLD);
+#endif // USE_MPI
+      if (converged && rank == 0) {
+        std::cerr << "The g(r) converged after " << total[0].nframes
+                  << " frames (" << blocks[0].nblocks << " blocks).\n";
+      }
+    }
+    // Slide the windows along by the segment, and write out every full one.
+    // A short last segment is left out
+    if (windowing) {
+      total = sumStates();
+      for (int ianalysis = 0; rank == 0 && ianalysis < nanalyses;
+           ianalysis++) {
+        rdf::WindowStats &window = windows[ianalysis]; // Window of this one
+        rdf::RdfState segment = total[ianalysis]; // Frames of this segment
+        rdf::subtractState(&segment, blockStart[ianalysis]);
+        blockStart[ianalysis] = total[ianalysis];
+        if (segment.nframes != windowStride) {
+          continue;
+        }
+        rdf::addSegment(&window, segment, segmentFirst);
+        if (window.segments.size() == window.nsegments &&
+            windowFiles[ianalysis].write(window.firstTimesteps.front(),
+                                         window.sum.lastTimestep,
+                                         rdf::normalizeState(window.sum)) !=
+                0) {
+#ifdef USE_MPI
+          MPI_Abort(MPI_COMM_WORLD, 1);
+#endif // USE_MPI
+          return 1;
+        }
+      }
+    }
+    done = converged || (isStream ? streamDone
+                                  : segmentStart >= selectedFrames.size());
+    sinceCheckpoint += nsegment;
+    // Save everything accumulated so far
+    if (checkpointing && (sinceCheckpoint >= config.checkpointEvery || done)) {
+      sinceCheckpoint = 0;
+      if (!blocking) {
+        total = sumStates();
+      }
+      for (int ianalysis = 0; rank == 0 && ianalysis < nanalyses;
+           ianalysis++) {
+        if (io::writeCheckpoint(checkpointFiles[ianalysis],
+                                total[ianalysis]) != 0) {
+#ifdef USE_MPI
+          MPI_Abort(MPI_COMM_WORLD, 1);
+#endif // USE_MPI
+          return 1;
+        }
+      }
+    }
+  } // end of loop through segments
+  // ---------------------------
 
-  // For non-default filename, add one after nbin
-  io::writeRDF(rdf, binsize, nbin);
+  dumpFile.close(); // Unmap the lammps file
+  stream.close();
+  if (isStream && !config.selectByTimestep && !converged &&
+      nselected < config.numCalcSteps) {
+    std::cerr << "The trajectory only had " << nselected
+              << " of the frames asked for.\n";
+  }
+
+  // Add up the histograms of the earlier runs, workers and ranks on rank 0
+  total = sumStates();
+
+  if (rank == 0 && blocking && blocks[0].nblocks < 2) {
+    std::cerr << "Too few blocks of " << config.blockFrames
+              << " frames for error bars.\n";
+  }
+  for (int ianalysis = 0; rank == 0 && ianalysis < windows.size();
+       ianalysis++) {
+    if (windowFiles[ianalysis].close() != 0) {
+#ifdef USE_MPI
+      MPI_Abort(MPI_COMM_WORLD, 1);
+#endif // USE_MPI
+      return 1;
+    }
+    if (windowFiles[ianalysis].nwindows() == 0) {
+      std::cerr << "Too few frames for a window of " << config.windowFrames
+                << " frames.\n";
+    }
+  }
+  // // -------------------------------------------- // Write out the RDF
+  fail = 0;
+  for (int ianalysis = 0; rank == 0 && ianalysis < nanalyses; ianalysis++) {
+    fail |= io::writeResults(config, analyses[ianalysis].name,
+                             total[ianalysis], blocks[ianalysis],
+                             config.outputDir);
+  }
 
   // -------------------------------------------- // Fin
 
+#ifdef USE_PROFILING
+  // Print the profile, and write out the trace of every rank
+  if (rank == 0) {
+    prof::report(std::cerr);
+  }
+  if (!config.traceFile.empty()) {
+    prof::writeTrace((nranks > 1)
+                         ? config.traceFile + "." + std::to_string(rank)
+                         : config.traceFile);
+  }
+#endif // USE_PROFILING
+
+#ifdef USE_MPI
+  MPI_Finalize();
+#endif // USE_MPI
+
   // std::cout << "Welcome to the Black Parade \n";
-  return 0;
+  return (fail != 0) ? 1 : 0;
 }
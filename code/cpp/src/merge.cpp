@@ -0,0 +1,80 @@
+// Standard Library
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Internal Libraries
+#include <checkpoint.hpp>
+#include <inputOutput.hpp>
+#include <rdf.hpp>
+
+/********************************************/ /**
+ *  Merges the checkpoints of separate runYoda jobs (e.g. over different
+ segments of a trajectory) into one checkpoint.
+ *
+ * Usage: yodaMerge output.ckp input1.ckp [input2.ckp ...] [--rdf name]
+ [--outputDir dir]
+ *
+ * The raw histograms and sums are added up, so the merged checkpoint is the
+ same as that of a single job over all the frames. With --rdf, the normalized
+ g(r) of the merged checkpoint is also written out, to the output directory
+ given by --outputDir (by default that of runYoda). A name ending in .npy
+ gives a NumPy array instead of text.
+ ***********************************************/
+int main(int argc, char *argv[]) {
+  std::vector<std::string> inputs; // Checkpoints to be merged
+  std::string rdfFile = "";        // File for the g(r); empty for none
+  std::string outputDir = "../../output"; // Directory of the g(r) file
+  std::string option;              // Current argument
+  rdf::RdfState total;             // Merged accumulation
+  rdf::RdfState state;             // Accumulation of the current checkpoint
+
+  if (argc < 3) {
+    std::cerr << "Usage: " << argv[0]
+              << " output.ckp input1.ckp [input2.ckp ...] [--rdf name] "
+                 "[--outputDir dir]\n";
+    return 1;
+  }
+  // Read in the inputs and options
+  for (int iarg = 2; iarg < argc; iarg++) {
+    option = argv[iarg];
+    if (option == "--rdf" && iarg + 1 < argc) {
+      rdfFile = argv[++iarg];
+    } else if (option == "--outputDir" && iarg + 1 < argc) {
+      outputDir = argv[++iarg];
+    } else if (option.compare(0, 2, "--") == 0) {
+      std::cerr << "Unknown option " << option << "\n";
+      return 1;
+    } else {
+      inputs.push_back(option);
+    }
+  }
+  if (inputs.empty()) {
+    std::cerr << "No checkpoints were given to be merged.\n";
+    return 1;
+  }
+
+  // Add up the checkpoints
+  for (int i = 0; i < inputs.size(); i++) {
+    if (io::readCheckpoint(inputs[i], &state) != 0) {
+      return 1;
+    }
+    if (i == 0) {
+      total = state;
+    } else if (rdf::mergeState(&total, state) != 0) {
+      std::cerr << "Could not merge " << inputs[i] << "\n";
+      return 1;
+    }
+  }
+
+  if (io::writeCheckpoint(argv[1], total) != 0) {
+    return 1;
+  }
+  if (!rdfFile.empty()) {
+    std::vector<double> rdf = rdf::normalizeState(total); // Merged g(r)
+    return io::writeRDF(rdf.data(), total.binsize, total.nbin, rdfFile,
+                        total.ntypes, nullptr, outputDir);
+  }
+
+  return 0;
+}
@@ -0,0 +1,256 @@
+#include <inputOutput.hpp>
+#include <mmapReader.hpp>
+
+/********************************************/ /**
+ *  Function for memory-mapping a whole file, read-only.
+ *
+ * The kernel is told that the file will mostly be read sequentially, so that
+ it reads ahead aggressively.
+ *  @param[in] filename The path of the file
+ *  \return an int value of 0 (success) or 1 (error)
+ ***********************************************/
+int io::MappedFile::open(const std::string &filename) {
+  struct stat fileStat; // Size of the file
+  void *ptr;            // Start of the map
+  int fd;               // File descriptor
+
+  close();
+  fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    std::cerr
+        << "Fatal Error: The file does not exist or you gave the wrong path.\n";
+    return 1;
+  }
+  if (fstat(fd, &fileStat) != 0) {
+    ::close(fd);
+    return 1;
+  }
+  // An empty file cannot be mapped, but is still a valid (empty) file
+  if (fileStat.st_size == 0) {
+    ::close(fd);
+    return 0;
+  }
+  ptr = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The map stays valid after the descriptor is closed
+  ::close(fd);
+  if (ptr == MAP_FAILED) {
+    std::cerr << "Could not memory-map " << filename << "\n";
+    return 1;
+  }
+  madvise(ptr, fileStat.st_size, MADV_SEQUENTIAL);
+
+  data_ = static_cast<const char *>(ptr);
+  size_ = fileStat.st_size;
+  return 0;
+}
+
+/********************************************/ /**
+ *  Function for releasing the memory map, if there is one.
+ ***********************************************/
+void io::MappedFile::close() {
+  if (data_ != nullptr) {
+    munmap(const_cast<char *>(data_), size_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+}
+
+/********************************************/ /**
+ *  Function for parsing the header of a frame of a lammps trajectory file, in
+ place.
+ *
+ * The cursor should point to the "ITEM: TIMESTEP" line of the frame. On
+ return, it points to the first atom line. Triclinic boxes (with the tilt
+ factors xy, xz and yz after the bounds) are converted from the bounding box
+ written by lammps to the lengths and lower bounds of the cell itself.
+ *  @param[in, out] cursor The current position in the buffer
+ *  @param[in] end The end of the buffer
+ *  @param[out] entry The timestep, number of atoms and box of the frame (the
+ offset is not touched)
+ *  @param[out] columns The columns of the atom lines
+ *  \return an int value of 0 (success) or 1 (error or incomplete header)
+ ***********************************************/
+int io::parseFrameHeader(const char **cursor, const char *end,
+                         io::FrameIndexEntry *entry,
+                         io::AtomColumns *columns) {
+  const char *ptr = *cursor; // Current position
+  const char *eol;           // End of the current line
+  const char *wordStart;     // Start of the current word
+  double lo, hi;             // Box bounds along one dimension
+  double tilt[3] = {0, 0, 0}; // Tilt factors xy, xz and yz
+  double shift[2];           // Extent of the tilts along x and y
+  bool triclinic;            // The box bounds are followed by tilt factors
+  std::string word;          // Current word of the ITEM: ATOMS line
+  int col;                   // Current column of the ITEM: ATOMS line
+
+  ptr = io::nextLine(ptr, end); // ITEM: TIMESTEP
+  // Timestep Number
+  if (ptr == end || io::parseNumber(ptr, end, &entry->timestep) == nullptr) {
+    return 1;
+  }
+  ptr = io::nextLine(ptr, end);
+  ptr = io::nextLine(ptr, end); // ITEM: NUMBER OF ATOMS
+  // Number of atoms
+  if (ptr == end || io::parseNumber(ptr, end, &entry->nop) == nullptr) {
+    return 1;
+  }
+  ptr = io::nextLine(ptr, end);
+  // ITEM: BOX BOUNDS pp pp pp, or ITEM: BOX BOUNDS xy xz yz pp pp pp for a
+  // triclinic box
+  eol = io::lineEnd(ptr, end);
+  triclinic = std::search(ptr, eol, "xy", "xy" + 2) != eol;
+  ptr = io::nextLine(ptr, end);
+  // Get the box bounds
+  for (int k = 0; k < 3; k++) {
+    if (ptr == end) {
+      return 1;
+    }
+    ptr = io::parseNumber(ptr, end, &lo);
+    if (ptr == nullptr || (ptr = io::parseNumber(ptr, end, &hi)) == nullptr ||
+        (triclinic &&
+         (ptr = io::parseNumber(ptr, end, &tilt[k])) == nullptr)) {
+      std::cerr << "Invalid traj file perhaps!\n";
+      return 1;
+    }
+    entry->boxLo[k] = lo;
+    entry->box[k] = hi - lo;
+    ptr = io::nextLine(ptr, end);
+  } // end of getting the box lengths
+  // The bounds of a triclinic box are those of the bounding box of the tilted
+  // cell; take the extent of the tilts off to get the cell itself
+  if (triclinic) {
+    shift[0] = std::min(std::min(0.0, tilt[0]),
+                        std::min(tilt[1], tilt[0] + tilt[1]));
+    shift[1] = std::max(std::max(0.0, tilt[0]),
+                        std::max(tilt[1], tilt[0] + tilt[1]));
+    entry->boxLo[0] -= shift[0];
+    entry->box[0] -= shift[1] - shift[0];
+    entry->boxLo[1] -= std::min(0.0, tilt[2]);
+    entry->box[1] -= fabs(tilt[2]);
+  }
+  entry->tilt = {{tilt[0], tilt[1], tilt[2]}};
+
+  // ---
+  // Find the columns of the ID, type and coordinates
+  // ITEM: ATOMS id type x y z
+  if (ptr == end) {
+    return 1;
+  }
+  eol = io::lineEnd(ptr, end);
+  *columns = io::AtomColumns();
+  col = -2; // The words "ITEM:" and "ATOMS" are not columns
+  while (ptr < eol) {
+    while (ptr < eol && isspace(*ptr)) {
+      ptr++;
+    }
+    wordStart = ptr;
+    while (ptr < eol && !isspace(*ptr)) {
+      ptr++;
+    }
+    if (ptr == wordStart) {
+      break;
+    }
+    word.assign(wordStart, ptr);
+    if (word == "id") {
+      columns->id = col;
+    } else if (word == "type") {
+      columns->type = col;
+    } else if (word == "x") {
+      columns->x = col;
+    }
+    col++;
+  }
+  if (columns->x < 0) {
+    std::cerr << "Invalid traj file perhaps!\n";
+    return 1;
+  }
+  columns->last = std::max(columns->x + 2, std::max(columns->id, columns->type));
+  // ---
+
+  *cursor = io::nextLine(eol, end);
+  return 0;
+}
+
+/********************************************/ /**
+ *  Function for parsing the atom lines of a frame of a lammps trajectory file,
+ in place, straight into a frame.
+ *
+ * The frame should already have been resized to the number of atoms. Nothing
+ is allocated, and the numbers are parsed with io::parseNumber.
+ *  @param[in, out] cursor The current position in the buffer (the first atom
+ line); on return, the line after the last atom line
+ *  @param[in] end The end of the buffer
+ *  @param[in] columns The columns of the atom lines
+ *  @param[in, out] frame The frame, whose ID, type and coordinate arrays are
+ filled
+ *  \return an int value of 0 (success) or 1 (error or incomplete frame)
+ ***********************************************/
+int io::parseAtoms(const char **cursor, const char *end,
+                   const io::AtomColumns &columns, gen::Frame *frame) {
+  const char *ptr = *cursor; // Current position
+  double value;              // Number just parsed
+  double *coord[3] = {frame->x.data(), frame->y.data(), frame->z.data()};
+
+  // Go through the atom coordinate lines
+  for (int iatom = 0; iatom < frame->nop; iatom++) {
+    if (ptr >= end) {
+      std::cerr << "Incomplete frame in the traj file!\n";
+      return 1;
+    }
+    // Parse the columns in place
+    for (int col = 0; col <= columns.last; col++) {
+      ptr = io::parseNumber(ptr, end, &value);
+      if (ptr == nullptr) {
+        std::cerr << "Invalid atom line in the traj file!\n";
+        return 1;
+      }
+      if (col == columns.id) {
+        frame->id[iatom] = (int)value;
+      } else if (col == columns.type) {
+        frame->type[iatom] = (int)value;
+      } else if (col >= columns.x && col < columns.x + 3) {
+        coord[col - columns.x][iatom] = value;
+      }
+    } // end of loop through columns
+    // Default IDs and types if they are not in the file
+    if (columns.id < 0) {
+      frame->id[iatom] = iatom + 1;
+    }
+    if (columns.type < 0) {
+      frame->type[iatom] = 1;
+    }
+    ptr = io::nextLine(ptr, end);
+  } // end of loop through atoms
+
+  *cursor = ptr;
+  return 0;
+}
+
+/********************************************/ /**
+ *  Function for parsing a whole frame of a lammps trajectory file, in place,
+ into a reusable frame.
+ *  @param[in, out] cursor The current position in the buffer (the ITEM:
+ TIMESTEP line of the frame); on return, the line after the frame
+ *  @param[in] end The end of the buffer
+ *  @param[in, out] frame The frame, which is overwritten
+ *  \return an int value of 0 (success) or 1 (error)
+ ***********************************************/
+int io::parseFrame(const char **cursor, const char *end, gen::Frame *frame) {
+  io::FrameIndexEntry entry; // Header of the frame
+  io::AtomColumns columns;   // Columns of the atom lines
+  const char *start = *cursor; // Start of the frame
+  int fail;                    // Non-zero if the atom lines are invalid
+
+  if (io::parseFrameHeader(cursor, end, &entry, &columns) != 0) {
+    return 1;
+  }
+  frame->timestep = entry.timestep;
+  frame->boxLo = entry.boxLo;
+  frame->box = entry.box;
+  frame->tilt = entry.tilt;
+  frame->resize(entry.nop);
+
+  fail = io::parseAtoms(cursor, end, columns, frame);
+  PROF_COUNT(bytesParsed, *cursor - start);
+  return fail;
+}
@@ -0,0 +1,119 @@
+#include <neighbours.hpp>
+
+/********************************************/ /**
+ *  Function for building the cell list of a frame.
+ *
+ * Every particle is wrapped back into the box and assigned to the cell it lies
+ in (see nlist::cellCoordinates). The particles are then sorted by cell with a
+ counting sort, and their (unwrapped) coordinates and atom types are copied in
+ that order. For a triclinic box, the fractional coordinates are binned and
+ copied instead (see rdf::toFractional). If the cell list is in single
+ precision, only float copies of the coordinates are kept; these are wrapped
+ into the box (measured from its lower bounds), which keeps them as small as
+ possible and so loses the least precision. The arrays of the cell list are
+ reused, so passing the same cell list for every frame avoids reallocating
+ them.
+ *
+ *  @param[out] cells The cell list, which is overwritten
+ *  @param[in] frame The frame, holding the coordinates of the particles and
+ the box lengths
+ *  @param[in] cutoff The cutoff distance, which is the smallest cell width
+ allowed
+ *  \return an int value of 0 (success) or 1 (the box is too small for a cell
+ list)
+ ***********************************************/
+int nlist::buildCellList(nlist::CellList *cells, const gen::Frame &frame,
+                         double cutoff) {
+  const double *coord[3] = {frame.x.data(), frame.y.data(), frame.z.data()};
+  std::array<double, 3> widths = nlist::boxWidths(frame); // Box widths
+  bool triclinic = frame.isTriclinic(); // Bin fractional coordinates
+  rdf::CellMatrix cell = rdf::cellMatrix(frame.box, frame.tilt); // Box matrix
+  double s[3];                // Fractional coordinates of the particle
+  int ncellTotal; // Total number of cells
+  int icell;      // Index of the cell in which the current particle lies
+  int isorted;    // Position of the current particle in the sorted arrays
+  std::array<int, 3> cellIdx; // 3D index of the current cell
+
+  if (!nlist::isUsable(widths, cutoff)) {
+    return 1;
+  }
+  PROF_SCOPE("cells");
+
+  // Get the number and width of the cells
+  cells->ncell = nlist::numberOfCells(widths, cutoff);
+  for (int k = 0; k < 3; k++) {
+    cells->cellWidth[k] = widths[k] / cells->ncell[k];
+  }
+  ncellTotal = cells->ncell[0] * cells->ncell[1] * cells->ncell[2];
+
+  // Empty the cells
+  cells->cellStart.assign(ncellTotal + 1, 0);
+  cells->cellOf.resize(frame.nop);
+  cells->atoms.resize(frame.nop);
+  if (cells->singlePrecision) {
+    cells->xf.resize(frame.nop);
+    cells->yf.resize(frame.nop);
+    cells->zf.resize(frame.nop);
+  } else {
+    cells->x.resize(frame.nop);
+    cells->y.resize(frame.nop);
+    cells->z.resize(frame.nop);
+  }
+  cells->type.resize(frame.nop);
+
+  // Find the cell of every particle, and count the particles in each cell
+  for (int iatom = 0; iatom < frame.nop; iatom++) {
+    cellIdx = nlist::cellCoordinates(*cells, frame, cell, coord[0][iatom],
+                                     coord[1][iatom], coord[2][iatom]);
+    icell = nlist::cellIndex(*cells, cellIdx[0], cellIdx[1], cellIdx[2]);
+    cells->cellOf[iatom] = icell;
+    cells->cellStart[icell + 1]++;
+  } // end of loop through all particles
+
+  // Turn the counts into the first position of each cell
+  for (icell = 0; icell < ncellTotal; icell++) {
+    cells->cellStart[icell + 1] += cells->cellStart[icell];
+  }
+
+  // Put every particle in its place, filling each cell from its end, so
+  // that the particles of a cell stay in their original order
+  for (int iatom = frame.nop - 1; iatom >= 0; iatom--) {
+    icell = cells->cellOf[iatom];
+    isorted = --cells->cellStart[icell + 1];
+    cells->atoms[isorted] = iatom;
+    if (cells->singlePrecision) {
+      // Wrapped position from the lower bounds of the box
+      s[0] = coord[0][iatom] - frame.boxLo[0];
+      s[1] = coord[1][iatom] - frame.boxLo[1];
+      s[2] = coord[2][iatom] - frame.boxLo[2];
+      if (triclinic) {
+        rdf::toFractional(cell, s[0], s[1], s[2], s);
+      }
+      for (int k = 0; k < 3; k++) {
+        s[k] -= triclinic ? floor(s[k])
+                          : frame.box[k] * floor(s[k] / frame.box[k]);
+      }
+      cells->xf[isorted] = (float)s[0];
+      cells->yf[isorted] = (float)s[1];
+      cells->zf[isorted] = (float)s[2];
+    } else if (triclinic) {
+      rdf::toFractional(cell, coord[0][iatom], coord[1][iatom],
+                        coord[2][iatom], s);
+      cells->x[isorted] = s[0];
+      cells->y[isorted] = s[1];
+      cells->z[isorted] = s[2];
+    } else {
+      cells->x[isorted] = coord[0][iatom];
+      cells->y[isorted] = coord[1][iatom];
+      cells->z[isorted] = coord[2][iatom];
+    }
+    cells->type[isorted] = frame.type[iatom];
+  } // end of loop through all particles
+  // cellStart[icell + 1] now holds the start of icell; shift it back
+  for (icell = 0; icell < ncellTotal; icell++) {
+    cells->cellStart[icell] = cells->cellStart[icell + 1];
+  }
+  cells->cellStart[ncellTotal] = frame.nop;
+
+  return 0;
+}
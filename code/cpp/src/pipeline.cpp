@@ -0,0 +1,164 @@
+#include <pipeline.hpp>
+
+/********************************************/ /**
+ *  Function for reading and processing a number of frames, overlapping the
+ reading with the processing.
+ *
+ * The calling thread becomes the reader, and fills the buffers in task order.
+ The workers take filled buffers in the same order, but several workers may
+ finish them out of order, so processFrame must only touch per-worker state.
+ After a failure, the reader stops reading, and the workers hand back the
+ frames already read without processing them.
+ *
+ *  @param[in] ntasks The number of frames to be read in, or -1 to keep reading
+ until readFrame runs out of frames (for streamed trajectories)
+ *  @param[in] readFrame Reads the frame of a task into a buffer; returns 0 on
+ success, and -1 if there are no frames left
+ *  @param[in] processFrame Processes a filled buffer on a worker; returns 0 on
+ success
+ *  @param[in] nworkers (Optional argument) The number of compute workers
+ *  @param[in] nbuffers (Optional argument) The number of frame buffers, which
+ bounds the number of frames held in memory
+ *  \return an int value of 0 (success) or 1 (a frame could not be read or
+ processed)
+ ***********************************************/
+int pipeline::run(int ntasks, const pipeline::FrameReader &readFrame,
+                  const pipeline::FrameProcessor &processFrame, int nworkers,
+                  int nbuffers) {
+  nworkers = std::max(nworkers, 1);
+  nbuffers = std::max(nbuffers, nworkers + 1); // Keep everyone busy
+  std::vector<gen::Frame> buffers(nbuffers);   // Pool of frame buffers
+  pipeline::BoundedQueue<gen::Frame *> freeBuffers(nbuffers);
+  pipeline::BoundedQueue<gen::Frame *> filledBuffers(nbuffers);
+  std::vector<std::thread> workers; // Compute workers
+  std::atomic<int> fail(0);         // Non-zero after any failure
+  gen::Frame *frame;                // Buffer being filled
+  int status;                       // Result of reading a frame
+
+  for (auto &buffer : buffers) {
+    freeBuffers.push(&buffer);
+  }
+
+  // Start the workers
+  for (int iworker = 0; iworker < nworkers; iworker++) {
+    workers.emplace_back([&, iworker] {
+      gen::Frame *filled; // Buffer being processed
+      while (filledBuffers.pop(&filled)) {
+        if (fail == 0 && processFrame(iworker, *filled) != 0) {
+          fail = 1;
+        }
+        // Hand the buffer back to the reader
+        freeBuffers.push(filled);
+      }
+    });
+  } // end of starting the workers
+
+  // Read in the frames, waiting for a free buffer each time
+  for (int itask = 0; (ntasks < 0 || itask < ntasks) && fail == 0; itask++) {
+    if (!freeBuffers.pop(&frame)) {
+      break;
+    }
+    status = readFrame(itask, frame);
+    if (status != 0) {
+      // Out of frames, or failed
+      if (status > 0) {
+        fail = 1;
+      }
+      freeBuffers.push(frame);
+      break;
+    }
+    filledBuffers.push(frame);
+  } // end of reading frames
+
+  // Let the workers finish the frames which have been read
+  filledBuffers.close();
+  for (auto &worker : workers) {
+    worker.join();
+  }
+
+  return fail.load();
+}
+
+/********************************************/ /**
+ *  Function for running independent tasks on a pool of workers, with work
+ stealing.
+ *
+ * The tasks are dealt out to the workers in contiguous runs, so each worker
+ starts on neighbouring tasks (e.g. the chunks of the same trajectory), which
+ it takes in order from the front of its own queue. A worker whose queue is
+ empty steals from the back of the fullest queue of the others, i.e. the tasks
+ its owner would have reached last. The workers stop once every queue is
+ empty; tasks are never added, so no task is left behind. After a failure, the
+ remaining tasks are still run.
+ *
+ *  @param[in] ntasks The number of tasks
+ *  @param[in] runTask Runs a task on a worker; returns 0 on success. Tasks may
+ run in any order, and on any worker
+ *  @param[in] nworkers (Optional argument) The number of workers
+ *  \return an int value of 0 (success) or 1 (a task failed)
+ ***********************************************/
+int pipeline::runStealing(int ntasks, const pipeline::TaskRunner &runTask,
+                          int nworkers) {
+  nworkers = std::max(1, std::min(nworkers, ntasks));
+  std::vector<std::deque<int>> queues(nworkers); // Tasks of every worker
+  std::vector<std::mutex> queueMutexes(nworkers); // Guard the queues
+  std::vector<std::thread> workers;               // Workers
+  std::mutex failMutex;                           // Guards fail
+  int fail = 0;                                   // Non-zero after a failure
+
+  for (int iworker = 0; iworker < nworkers; iworker++) {
+    for (int itask = (long long)ntasks * iworker / nworkers;
+         itask < (long long)ntasks * (iworker + 1) / nworkers; itask++) {
+      queues[iworker].push_back(itask);
+    }
+  }
+
+  for (int iworker = 0; iworker < nworkers; iworker++) {
+    workers.emplace_back([&, iworker] {
+      int itask;  // Task being run
+      int victim; // Worker to steal from
+      size_t most; // Tasks left in the queue of the victim
+      while (true) {
+        itask = -1;
+        // Own tasks first, from the front
+        {
+          std::lock_guard<std::mutex> lock(queueMutexes[iworker]);
+          if (!queues[iworker].empty()) {
+            itask = queues[iworker].front();
+            queues[iworker].pop_front();
+          }
+        }
+        // Otherwise, steal from the back of the fullest queue
+        while (itask < 0) {
+          victim = -1;
+          most = 0;
+          for (int iother = 0; iother < nworkers; iother++) {
+            std::lock_guard<std::mutex> lock(queueMutexes[iother]);
+            if (queues[iother].size() > most) {
+              most = queues[iother].size();
+              victim = iother;
+            }
+          }
+          if (victim < 0) {
+            return;
+          }
+          std::lock_guard<std::mutex> lock(queueMutexes[victim]);
+          if (!queues[victim].empty()) {
+            itask = queues[victim].back();
+            queues[victim].pop_back();
+          }
+        } // end of stealing
+        if (runTask(iworker, itask) != 0) {
+          std::lock_guard<std::mutex> lock(failMutex);
+          fail = 1;
+        }
+      } // end of loop through tasks
+    });
+  } // end of starting the workers
+
+  for (auto &worker : workers) {
+    worker.join();
+  }
+
+  return fail;
+}
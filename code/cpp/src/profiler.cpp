@@ -0,0 +1,190 @@
+#include <profiler.hpp>
+
+#ifdef USE_PROFILING
+
+#include <stdio.h>
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <mutex>
+
+// Start of the run
+static const std::chrono::steady_clock::time_point runStart =
+    std::chrono::steady_clock::now();
+// Logs of every thread which has been timed; a deque, so that the logs never
+// move, and they outlive their threads
+static std::deque<prof::ThreadLog> threadLogs;
+// Guards threadLogs while a thread sets up its log
+static std::mutex threadLogsMutex;
+// Names of the counters, the unit of their throughput, and the stage whose
+// wall time the throughput is measured over
+static const char *counterNames[prof::ncounters] = {
+    "frames read", "bytes parsed", "pairs evaluated", "pairs in cutoff"};
+static const char *counterUnits[prof::ncounters] = {"frames/s", "MB/s",
+                                                    "pairs/s", "pairs/s"};
+static const double counterScales[prof::ncounters] = {1, 1e-6, 1, 1};
+static const char *counterStages[prof::ncounters] = {"read", "read", "pairs",
+                                                     "pairs"};
+
+/********************************************/ /**
+ *  Function for getting the time since the start of the run.
+ *  \return the time in seconds
+ ***********************************************/
+double prof::now() {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       runStart)
+      .count();
+}
+
+/********************************************/ /**
+ *  Function for getting the log of the calling thread. The log is set up the
+ first time a thread asks for it; after that, no lock is taken.
+ *  \return the log of the calling thread
+ ***********************************************/
+prof::ThreadLog &prof::threadLog() {
+  thread_local prof::ThreadLog *log = nullptr; // Log of this thread
+
+  if (log == nullptr) {
+    std::lock_guard<std::mutex> lock(threadLogsMutex);
+    threadLogs.emplace_back();
+    log = &threadLogs.back();
+    log->thread = threadLogs.size() - 1;
+  }
+  return *log;
+}
+
+/********************************************/ /**
+ *  Function for printing the profile of the run: for every stage, the number
+ of timed scopes, the time summed over every thread, the wall time (the
+ largest time spent in the stage by one thread) and the load imbalance (that
+ largest time over the mean of the threads which ran the stage; 1 is perfect
+ balance), followed by the total and throughput of every counter.
+ *
+ * This must only be called once the timed threads have finished.
+ *  @param[in] out The stream to print to
+ ***********************************************/
+void prof::report(std::ostream &out) {
+  std::vector<std::string> stages; // Stages, in order of first use
+  std::map<std::string, double> firstStart; // First start of each stage
+  // Time of every thread in every stage
+  std::map<std::string, std::map<int, double>> threadTime;
+  std::map<std::string, long long> calls; // Timed scopes of each stage
+  std::map<std::string, double> wall;     // Wall time of each stage
+  std::array<unsigned long long, prof::ncounters> counters = {}; // Totals
+  char line[160]; // Current line
+
+  for (const prof::ThreadLog &log : threadLogs) {
+    for (const prof::Event &event : log.events) {
+      std::string name = event.name; // Stage name
+      if (firstStart.count(name) == 0) {
+        stages.push_back(name);
+        firstStart[name] = event.start;
+      }
+      firstStart[name] = std::min(firstStart[name], event.start);
+      threadTime[name][log.thread] += event.end - event.start;
+      calls[name]++;
+    }
+    for (int icounter = 0; icounter < prof::ncounters; icounter++) {
+      counters[icounter] += log.counters[icounter];
+    }
+  }
+  std::sort(stages.begin(), stages.end(),
+            [&](const std::string &a, const std::string &b) {
+              return firstStart[a] < firstStart[b];
+            });
+
+  snprintf(line, sizeof(line), "# Profile of the run (%.4f s)\n", prof::now());
+  out << line;
+  snprintf(line, sizeof(line), "%-12s %10s %12s %12s %8s %10s\n", "# stage",
+           "calls", "total (s)", "wall (s)", "threads", "imbalance");
+  out << line;
+  for (const std::string &name : stages) {
+    double total = 0;     // Time summed over the threads
+    double maxTime = 0;   // Largest time of one thread
+    int nthreads = threadTime[name].size(); // Threads which ran the stage
+    for (const auto &entry : threadTime[name]) {
+      total += entry.second;
+      maxTime = std::max(maxTime, entry.second);
+    }
+    wall[name] = maxTime;
+    snprintf(line, sizeof(line), "%-12s %10lld %12.4f %12.4f %8d %10.3f\n",
+             name.c_str(), calls[name], total, maxTime, nthreads,
+             (total > 0) ? maxTime * nthreads / total : 1.0);
+    out << line;
+  }
+
+  snprintf(line, sizeof(line), "%-16s %20s %16s\n", "# counter", "total",
+           "throughput");
+  out << line;
+  for (int icounter = 0; icounter < prof::ncounters; icounter++) {
+    double seconds = wall[counterStages[icounter]]; // Wall time of the stage
+    if (seconds > 0) {
+      snprintf(line, sizeof(line), "%-16s %20llu %16.4e %s\n",
+               counterNames[icounter], counters[icounter],
+               counters[icounter] * counterScales[icounter] / seconds,
+               counterUnits[icounter]);
+    } else {
+      snprintf(line, sizeof(line), "%-16s %20llu %16s\n",
+               counterNames[icounter], counters[icounter], "-");
+    }
+    out << line;
+  }
+}
+
+/********************************************/ /**
+ *  Function for writing the timed scopes out in the trace-event (JSON) format.
+ *
+ * Every timed scope becomes a complete ("X") event on the track of its
+ thread, with times in microseconds, and the counter totals are added as a
+ counter ("C") event at the end. This must only be called once the timed
+ threads have finished.
+ *  @param[in] filename The path of the trace file
+ *  \return an int value of 0 (success) or 1 (error)
+ ***********************************************/
+int prof::writeTrace(const std::string &filename) {
+  std::ofstream outFile(filename); // Trace file
+  std::array<unsigned long long, prof::ncounters> counters = {}; // Totals
+  double end = prof::now(); // End of the trace
+  char line[256];           // Current event
+
+  if (!outFile.is_open()) {
+    std::cerr << "Could not open " << filename << " for writing.\n";
+    return 1;
+  }
+  outFile << "{\"traceEvents\": [\n";
+  for (const prof::ThreadLog &log : threadLogs) {
+    snprintf(line, sizeof(line),
+             "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, "
+             "\"tid\": %d, \"args\": {\"name\": \"thread %d\"}},\n",
+             log.thread, log.thread);
+    outFile << line;
+    for (const prof::Event &event : log.events) {
+      snprintf(line, sizeof(line),
+               "{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 0, \"tid\": %d, "
+               "\"ts\": %.3f, \"dur\": %.3f},\n",
+               event.name, log.thread, event.start * 1e6,
+               (event.end - event.start) * 1e6);
+      outFile << line;
+    }
+    for (int icounter = 0; icounter < prof::ncounters; icounter++) {
+      counters[icounter] += log.counters[icounter];
+    }
+  }
+  snprintf(line, sizeof(line),
+           "{\"name\": \"counters\", \"ph\": \"C\", \"pid\": 0, \"ts\": %.3f, "
+           "\"args\": {\"framesRead\": %llu, \"bytesParsed\": %llu, "
+           "\"pairsEvaluated\": %llu, \"pairsInCutoff\": %llu}}\n",
+           end * 1e6, counters[prof::framesRead], counters[prof::bytesParsed],
+           counters[prof::pairsEvaluated], counters[prof::pairsInCutoff]);
+  outFile << line << "],\n\"displayTimeUnit\": \"ms\"}\n";
+  outFile.close();
+  if (!outFile.good()) {
+    std::cerr << "Could not write the trace " << filename << "\n";
+    return 1;
+  }
+
+  return 0;
+}
+
+#endif // USE_PROFILING
@@ -1,118 +1,862 @@
 #include <rdf.hpp>
 
 /********************************************/ /**
- *  Function for calculating the RDF or \f$g(r)\f$
+ *  Function for normalizing the \f$g(r)\f$ histograms, with respect to an
+ ideal gas.
  *
- * The is calculated for a bulk system, containing identical particles of a
- single type. Depending on the value of switchVar, either initialization,
- sampling or normalization of the \f$g(r)\f$ is performed.
+ * The box volume and numbers of particles may be averages over the frames
+ (see rdf::normalizeState). With several atom types, the total \f$g(r)\f$ is
+ first found as the sum of the partials.
  *
- *  @param[in] rdfArray The array for holding the histogram for the \f$g(r)\f$
- values
- *  @param[in] nframes The total number of frames for which the \f$g(r)\f$ is
- sampled
+ *  @param[in, out] rdfArray The histograms, which are normalized in place
+ *  @param[in] nframes The total number of frames sampled
  *  @param[in] binsize The user-specified bin-width or bin size
- *  @param[in] nbin The total number of bins in the \f$g(r)\f$ histogram
- *  @param[in] box The simulation box lengths, required for calculating the
- total volume
- *  @param[in] coord A vector of vectors, holding the coordinates of the
- particles
- *  @param[in] cutoff This is the maximum length upto which the \f$g(r)\f$ will
- be calculated, and should be less than half the box length
- *  @param[in] nop The total number of particles in the simulation box
- *  @param[in] switchVar Int whose value determines whether initialization (0),
- sampling (1) or normalization (2) will be performed
- *  \return an int value of 0 (success) or 1 (failure)
- ***********************************************/
-int rdf::gr(double *rdfArray, int *nframes, double binsize, int nbin,
-            std::vector<double> box, std::vector<std::vector<double>> coord,
-            double cutoff, int nop, int switchVar) {
-  //
-  double r_ij;            // Distance between iatom and jatom
-  int ibin;               // Current bin being filled
+ *  @param[in] nbin The total number of bins in each histogram
+ *  @param[in] volume The box volume
+ *  @param[in] count The total number of particles (element 0), followed by
+ the number of particles of each type (elements 1 to ntypes, if ntypes > 1)
+ *  @param[in] ntypes The number of atom types
+ *  \return an int value of 0 (success)
+ ***********************************************/
+int rdf::normalize(double *rdfArray, int nframes, double binsize, int nbin,
+                   double volume, const double *count, int ntypes) {
+  int ncolumns = rdf::numberOfColumns(ntypes); // Histograms in rdfArray
   double binVolume;       // Volume between the i^th and (i+1)^th bins
   double rho;             // Number density
-  double boxVolume;       // Total box volume
   double nIdeal;          // Number of ideal gas particles in the binVolume
   double pi = 3.14159265; // Value of pi
-  //
-  double r2 = 0.0;          // Squared distance
-  std::vector<double> dist; // Distance
-
-  // -------------------------------------// Init
-  if (switchVar == 0) {
-    //
-    *nframes = 0; // Init of number of frames
-    // Fill the entire array with zeros
+  double *partial;        // Histogram of the current pair of types
+  double pairFactor;      // 1 for like pairs, 2 for unlike pairs
+
+  // The total is the sum of the partials
+  if (ntypes > 1) {
     for (int ibin = 0; ibin < nbin; ibin++) {
       rdfArray[ibin] = 0;
-    } // end of looping through every bin
-    return 0;
-  } // end of init
-  // -------------------------------------// Accumulation
-  else if (switchVar == 1) {
-    *nframes = *nframes + 1; // Add to the number of accumulated frames
-    double somethinBig[nop][3];
-    for (int i = 0; i < nop; i++) {
-      for (int j = 0; j < 3; j++) {
-        somethinBig[i][j] = coord[i][j];
+      for (int icolumn = 1; icolumn < ncolumns; icolumn++) {
+        rdfArray[ibin] += rdfArray[icolumn * nbin + ibin];
       }
-    }
-#pragma acc kernels
-    //  Loop over all pairs of atoms
-
-    for (int iatom = 0; iatom < nop - 1; iatom++) {
-      // Loop through jatom
-      for (int jatom = iatom + 1; jatom < nop; jatom++) {
-        // ---
-        // Get the periodic distance r_ij
-        dist.resize(box.size());
-        r2 = 0.0;
-        for (int k = 0; k < box.size(); k++) {
-          dist[k] = somethinBig[iatom][k] - somethinBig[jatom][k];
-          // Apply PBCs
-          dist[k] -= box[k] * round(dist[k] / box[k]);
-          r2 += pow(dist[k], 2);
-        }
-        r_ij = sqrt(r2);
-        // r_ij = gen::periodicDist(somethinBig, box, iatom, jatom);
-        // ---
+    } // end of loop through all bins
+  }
+  // Calculating the number density
+  rho = count[0] / (volume); // Number density
 
-        // Only add if r_ij is within the cutoff
-        if (r_ij < cutoff) {
-          ibin = (int)(r_ij / binsize);
-          rdfArray[ibin] += 2;
-        } // end of check
+  // Normalize the RDF
+  for (int ibin = 0; ibin < nbin; ibin++) {
+    binVolume =
+        (pow((ibin + 1), 3.0) - pow((ibin), 3.0)) * pow((binsize), 3.0);
+    nIdeal = (4. / 3.) * pi * binVolume * rho; // Number of ideal gas particles
+    // Normalize
+    rdfArray[ibin] = rdfArray[ibin] / (nframes * count[0] * nIdeal);
+  } // end of loop through all bins
 
-      } // end of loop through jatom
-    }   // end of loop through every iatom
+  // Normalize the partials, with N_a reference particles of type a, and the
+  // density of type b. Unlike pairs are binned for both a-b and b-a
+  for (int itype = 1; itype <= ntypes && ntypes > 1; itype++) {
+    for (int jtype = itype; jtype <= ntypes; jtype++) {
+      partial = rdfArray + rdf::pairColumn(itype, jtype, ntypes) * nbin;
+      if (count[itype] == 0 || count[jtype] == 0) {
+        continue;
+      }
+      rho = count[jtype] / volume; // Number density of type b
+      pairFactor = (itype == jtype) ? 1.0 : 2.0;
+      for (int ibin = 0; ibin < nbin; ibin++) {
+        binVolume =
+            (pow((ibin + 1), 3.0) - pow((ibin), 3.0)) * pow((binsize), 3.0);
+        nIdeal = (4. / 3.) * pi * binVolume * rho;
+        partial[ibin] =
+            partial[ibin] / (nframes * count[itype] * pairFactor * nIdeal);
+      } // end of loop through all bins
+    }   // end of loop through jtype
+  }     // end of loop through itype
 
+  return 0;
+}
+
+/********************************************/ /**
+ *  Function for normalizing the \f$g(r)\f$ histogram of selected reference
+ and target atoms, with respect to an ideal gas of the target atoms.
+ *
+ * Every ordered pair of a reference and a target atom is counted once, so
+ there is no factor of two. The box volume and numbers of atoms may be
+ averages over the frames (see rdf::normalizeState).
+ *
+ *  @param[in, out] rdfArray The histogram, which is normalized in place
+ *  @param[in] nframes The total number of frames sampled
+ *  @param[in] binsize The user-specified bin-width or bin size
+ *  @param[in] nbin The total number of bins
+ *  @param[in] volume The box volume
+ *  @param[in] nreference The number of reference atoms
+ *  @param[in] ntarget The number of target atoms
+ *  \return an int value of 0 (success)
+ ***********************************************/
+int rdf::normalizeSelected(double *rdfArray, int nframes, double binsize,
+                           int nbin, double volume, double nreference,
+                           double ntarget) {
+  double binVolume;       // Volume between the i^th and (i+1)^th bins
+  double rho;             // Number density of the target atoms
+  double nIdeal;          // Number of ideal gas particles in the binVolume
+  double pi = 3.14159265; // Value of pi
+
+  if (nreference == 0 || ntarget == 0) {
     return 0;
-  } // end of accumulation
-  // -------------------------------------// Normalization
-  else if (switchVar == 2) {
-    // Calculating the number density
-    // Get the box volume
-    boxVolume = 1;
-    for (int k = 0; k < box.size(); k++) {
-      boxVolume = boxVolume * box[k];
+  }
+  rho = ntarget / volume;
+
+  // Normalize the RDF
+  for (int ibin = 0; ibin < nbin; ibin++) {
+    binVolume =
+        (pow((ibin + 1), 3.0) - pow((ibin), 3.0)) * pow((binsize), 3.0);
+    nIdeal = (4. / 3.) * pi * binVolume * rho; // Number of ideal gas particles
+    // Normalize
+    rdfArray[ibin] = rdfArray[ibin] / (nframes * nreference * nIdeal);
+  } // end of loop through all bins
+
+  return 0;
+}
+
+/********************************************/ /**
+ *  Function for setting up an empty accumulation state.
+ *  @param[out] state The accumulation state, which is overwritten
+ *  @param[in] binsize The user-specified bin-width or bin size
+ *  @param[in] cutoff This is the maximum length upto which the \f$g(r)\f$ will
+ be calculated
+ *  @param[in] nbin The total number of bins in each histogram
+ *  @param[in] ntypes The number of atom types
+ *  @param[in] selection (Optional argument) The reference and target
+ selections (see rdf::RdfState::selection), if only the pairs of selected
+ atoms are binned, which needs a single atom type. It is taken by value, so it
+ may be the selection of the state itself
+ ***********************************************/
+void rdf::initState(rdf::RdfState *state, double binsize, double cutoff,
+                    int nbin, int ntypes, std::string selection) {
+  *state = rdf::RdfState();
+  state->binsize = binsize;
+  state->cutoff = cutoff;
+  state->nbin = nbin;
+  state->ntypes = ntypes;
+  state->sumCount.assign(ntypes + 1, 0.0);
+  state->histogram.assign(rdf::numberOfColumns(ntypes) * nbin, 0);
+  if (!selection.empty()) {
+    state->sumSelected.assign(2, 0.0);
+    state->selection = selection;
+  }
+}
+
+/********************************************/ /**
+ *  Function for adding one accumulation state to another. Both must have been
+ set up with the same bins, cutoff, number of atom types and atom selections.
+ The sums simply add up, so the result does not depend on the order of
+ merging.
+ *  @param[in, out] state The accumulation state which is added to
+ *  @param[in] other The accumulation state which is added
+ *  \return an int value of 0 (success) or 1 (the settings differ)
+ ***********************************************/
+int rdf::mergeState(rdf::RdfState *state, const rdf::RdfState &other) {
+  if (state->binsize != other.binsize || state->cutoff != other.cutoff ||
+      state->nbin != other.nbin || state->ntypes != other.ntypes ||
+      state->histogram.size() != other.histogram.size() ||
+      state->sumSelected.size() != other.sumSelected.size() ||
+      state->selection != other.selection) {
+    std::cerr << "Cannot merge g(r) accumulations with different bins, "
+                 "cutoffs, numbers of atom types or atom selections.\n";
+    return 1;
+  }
+  for (int ibin = 0; ibin < state->histogram.size(); ibin++) {
+    state->histogram[ibin] += other.histogram[ibin];
+  }
+  for (int itype = 0; itype < state->sumCount.size(); itype++) {
+    state->sumCount[itype] += other.sumCount[itype];
+  }
+  for (int k = 0; k < state->sumSelected.size(); k++) {
+    state->sumSelected[k] += other.sumSelected[k];
+  }
+  state->nframes += other.nframes;
+  state->sumVolume += other.sumVolume;
+  if (other.lastTimestep > state->lastTimestep) {
+    state->lastTimestep = other.lastTimestep;
+    state->lastOffset = other.lastOffset;
+  }
+
+  return 0;
+}
+
+/********************************************/ /**
+ *  Function for getting the normalized \f$g(r)\f$ of an accumulation state,
+ using the box volume and numbers of particles averaged over the frames. The
+ state itself is left as it is, so that more frames can still be added.
+ *  @param[in] state The accumulation state
+ *  \return the normalized \f$g(r)\f$ histograms (see rdf::RdfState for the layout)
+ ***********************************************/
+std::vector<double> rdf::normalizeState(const rdf::RdfState &state) {
+  std::vector<double> rdfArray(state.histogram.size()); // Normalized histograms
+  std::vector<double> count(state.sumCount.size()); // Mean numbers
+  PROF_SCOPE("normalize");
+
+  // Every pair within the cutoff counts for both of its particles, unless
+  // the ordered pairs of selected atoms were counted
+  for (int ibin = 0; ibin < rdfArray.size(); ibin++) {
+    rdfArray[ibin] = (state.sumSelected.empty() ? 2.0 : 1.0) *
+                     state.histogram[ibin];
+  }
+
+  if (state.nframes == 0) {
+    return rdfArray;
+  }
+  if (!state.sumSelected.empty()) {
+    rdf::normalizeSelected(rdfArray.data(), state.nframes, state.binsize,
+                           state.nbin, state.sumVolume / state.nframes,
+                           state.sumSelected[0] / state.nframes,
+                           state.sumSelected[1] / state.nframes);
+    return rdfArray;
+  }
+  for (int itype = 0; itype < count.size(); itype++) {
+    count[itype] = state.sumCount[itype] / state.nframes;
+  }
+  rdf::normalize(rdfArray.data(), state.nframes, state.binsize, state.nbin,
+                 state.sumVolume / state.nframes, count.data(), state.ntypes);
+
+  return rdfArray;
+}
+
+/********************************************/ /**
+ *  Function for taking an earlier accumulation state away from a later one of
+ the same run, which leaves the accumulation of the frames in between (e.g. a
+ block of frames). The histograms are integer counts, so they are subtracted
+ exactly. The last timestep and offset are those of the later state.
+ *  @param[in, out] state The later accumulation state, which is subtracted
+ from
+ *  @param[in] earlier The earlier accumulation state
+ *  \return an int value of 0 (success) or 1 (the settings differ)
+ ***********************************************/
+int rdf::subtractState(rdf::RdfState *state, const rdf::RdfState &earlier) {
+  if (state->binsize != earlier.binsize || state->cutoff != earlier.cutoff ||
+      state->nbin != earlier.nbin || state->ntypes != earlier.ntypes ||
+      state->histogram.size() != earlier.histogram.size() ||
+      state->sumSelected.size() != earlier.sumSelected.size() ||
+      state->selection != earlier.selection) {
+    std::cerr << "Cannot subtract g(r) accumulations with different bins, "
+                 "cutoffs, numbers of atom types or atom selections.\n";
+    return 1;
+  }
+  for (int ibin = 0; ibin < state->histogram.size(); ibin++) {
+    state->histogram[ibin] -= earlier.histogram[ibin];
+  }
+  for (int itype = 0; itype < state->sumCount.size(); itype++) {
+    state->sumCount[itype] -= earlier.sumCount[itype];
+  }
+  for (int k = 0; k < state->sumSelected.size(); k++) {
+    state->sumSelected[k] -= earlier.sumSelected[k];
+  }
+  state->nframes -= earlier.nframes;
+  state->sumVolume -= earlier.sumVolume;
+
+  return 0;
+}
+
+/********************************************/ /**
+ *  Function for adding the normalized \f$g(r)\f$ of a block of frames to the
+ block averages, with Welford's update of the running mean and sum of squared
+ deviations in every bin.
+ *  @param[in, out] blocks The block averages; empty ones are sized to match
+ *  @param[in] rdfArray The normalized \f$g(r)\f$ histograms of the block (see
+ rdf::normalizeState)
+ ***********************************************/
+void rdf::addBlock(rdf::BlockStats *blocks, const std::vector<double> &rdfArray) {
+  double delta; // Deviation from the mean before the update
+
+  if (blocks->nblocks == 0) {
+    blocks->mean.assign(rdfArray.size(), 0.0);
+    blocks->m2.assign(rdfArray.size(), 0.0);
+  }
+  blocks->nblocks++;
+  for (int ibin = 0; ibin < rdfArray.size(); ibin++) {
+    delta = rdfArray[ibin] - blocks->mean[ibin];
+    blocks->mean[ibin] += delta / blocks->nblocks;
+    blocks->m2[ibin] += delta * (rdfArray[ibin] - blocks->mean[ibin]);
+  } // end of loop through all bins
+}
+
+/********************************************/ /**
+ *  Function for adding a segment of frames to a sliding window. Once the window
+ holds more than its number of segments, the oldest one is subtracted again,
+ so the window always holds the latest segments.
+ *  @param[in, out] window The sliding window
+ *  @param[in] segment The accumulation of the frames of the segment
+ *  @param[in] firstTimestep The timestep of the first frame of the segment
+ *  \return an int value of 0 (success) or 1 (the settings differ)
+ ***********************************************/
+int rdf::addSegment(rdf::WindowStats *window, const rdf::RdfState &segment,
+                    long long firstTimestep) {
+  if (window->segments.empty()) {
+    window->sum = segment;
+  } else if (rdf::mergeState(&window->sum, segment) != 0) {
+    return 1;
+  }
+  window->segments.push_back(segment);
+  window->firstTimesteps.push_back(firstTimestep);
+  while (window->segments.size() > window->nsegments) {
+    if (rdf::subtractState(&window->sum, window->segments.front()) != 0) {
+      return 1;
     }
-    rho = nop / (boxVolume); // Number density
+    window->segments.pop_front();
+    window->firstTimesteps.pop_front();
+  }
 
-    // Normalize the RDF
-    for (int ibin = 0; ibin < nbin; ibin++) {
-      binVolume =
-          (pow((ibin + 1), 3.0) - pow((ibin), 3.0)) * pow((binsize), 3.0);
-      nIdeal =
-          (4. / 3.) * pi * binVolume * rho; // Number of ideal gas particles
-      // Normalize
-      rdfArray[ibin] = rdfArray[ibin] / ((*nframes) * nop * nIdeal);
-    } // end of loop through all bins
-    return 0;
-  } // end of normalization
-  // or there is some error
-  else {
-    std::cerr << "You entered the wrong value of switchVar.\n";
+  return 0;
+}
+
+/********************************************/ /**
+ *  Function for getting the standard error of the \f$g(r)\f$ in every bin,
+ which is the standard deviation of the block averages divided by the square
+ root of the number of blocks.
+ *  @param[in] blocks The block averages
+ *  \return the standard errors, laid out as the histograms (see
+ rdf::RdfState); all zero if there are fewer than two blocks
+ ***********************************************/
+std::vector<double> rdf::standardError(const rdf::BlockStats &blocks) {
+  std::vector<double> error(blocks.m2.size(), 0.0); // Standard errors
+  int n = blocks.nblocks; // Number of blocks
+
+  if (n < 2) {
+    return error;
+  }
+  for (int ibin = 0; ibin < error.size(); ibin++) {
+    error[ibin] = sqrt(blocks.m2[ibin] / ((n - 1.0) * n));
+  }
+
+  return error;
+}
+
+/********************************************/ /**
+ *  Function for getting the offsets, in the \f$g(r)\f$ array, of the
+ histograms of every pair of atom types.
+ *
+ * The offset of the pair of types itype and jtype is element
+ itype*(ntypes+1)+jtype, so that the row of itype can be handed to
+ rdf::binRow and indexed directly by the (1-based) type of the other particle.
+ *
+ *  @param[in] ntypes The number of atom types
+ *  @param[in] nbin The total number of bins in each histogram
+ *  \return a vector of (ntypes+1)*(ntypes+1) offsets; row and column 0 are not
+ used
+ ***********************************************/
+std::vector<int> rdf::pairOffsets(int ntypes, int nbin) {
+  std::vector<int> offsets((ntypes + 1) * (ntypes + 1), 0); // Offsets
+
+  for (int itype = 1; itype <= ntypes; itype++) {
+    for (int jtype = 1; jtype <= ntypes; jtype++) {
+      offsets[itype * (ntypes + 1) + jtype] =
+          rdf::pairColumn(itype, jtype, ntypes) * nbin;
+    }
+  } // end of loop through itype
+
+  return offsets;
+}
+
+/********************************************/ /**
+ *  Function for getting the fractional coordinates (see rdf::toFractional) of
+ every particle of a frame with a triclinic box.
+ *  @param[in] frame The frame
+ *  @param[out] sx The fractional coordinates along a, which are overwritten
+ *  @param[out] sy The fractional coordinates along b, which are overwritten
+ *  @param[out] sz The fractional coordinates along c, which are overwritten
+ ***********************************************/
+void rdf::fractionalCoordinates(const gen::Frame &frame,
+                                gen::alignedVector *sx, gen::alignedVector *sy,
+                                gen::alignedVector *sz) {
+  rdf::CellMatrix cell = rdf::cellMatrix(frame.box, frame.tilt); // Box matrix
+  double s[3]; // Fractional coordinates of the current particle
+
+  sx->resize(frame.nop);
+  sy->resize(frame.nop);
+  sz->resize(frame.nop);
+  for (int iatom = 0; iatom < frame.nop; iatom++) {
+    rdf::toFractional(cell, frame.x[iatom], frame.y[iatom], frame.z[iatom], s);
+    (*sx)[iatom] = s[0];
+    (*sy)[iatom] = s[1];
+    (*sz)[iatom] = s[2];
+  }
+}
+
+/********************************************/ /**
+ *  Function for adding the pairs of a range of rows of the pair matrix to the
+ \f$g(r)\f$ histogram, by visiting every pair.
+ *
+ * Row iatom holds the pairs (iatom, jatom) with jatom > iatom. Splitting the
+ rows into ranges lets several threads share the pair loop.
+ *
+ *  @param[in] rdfArray The array for holding the histogram for the \f$g(r)\f$
+ values (the number of pairs in every bin)
+ *  @param[in] binsize The user-specified bin-width or bin size
+ *  @param[in] nbin The total number of bins in each histogram
+ *  @param[in] frame The current frame, holding the coordinates of the
+ particles and the box lengths
+ *  @param[in] cutoff This is the maximum length upto which the \f$g(r)\f$ will
+ be calculated
+ *  @param[in] ntypes The number of atom types; if more than 1, every pair is
+ binned into the partial histogram of its types (see rdf::RdfState)
+ *  @param[in] iBegin The first row (iatom) to be visited
+ *  @param[in] iEnd The row after the last row to be visited
+ *  @param[in] sx (Optional argument) For a triclinic box, the fractional
+ coordinates of every particle along a (see rdf::fractionalCoordinates), so
+ that callers visiting the rows in chunks convert them only once per frame. If
+ not given, they are found here
+ *  @param[in] sy (Optional argument) The fractional coordinates along b
+ *  @param[in] sz (Optional argument) The fractional coordinates along c
+ *  \return an int value of 0 (success)
+ ***********************************************/
+int rdf::accumulatePairs(uint64_t *rdfArray, double binsize, int nbin,
+                         const gen::Frame &frame, double cutoff, int ntypes,
+                         int iBegin, int iEnd, const double *sx,
+                         const double *sy, const double *sz) {
+  const double *x = frame.x.data(); // Unit-stride coordinates
+  const double *y = frame.y.data();
+  const double *z = frame.z.data();
+  int nop = frame.nop; // Total number of particles in the box
+  // Histogram offsets of the type pairs, if the types are used
+  std::vector<int> offsets = rdf::pairOffsets(ntypes, nbin);
+  const int *type = (ntypes > 1) ? frame.type.data() : nullptr;
+  const int *rowOffset = nullptr; // Offsets of the row of iatom
+  bool triclinic = frame.isTriclinic(); // Use fractional coordinates
+  rdf::CellMatrix cell; // Cell matrix of a triclinic box
+  gen::alignedVector fx, fy, fz; // Fractional coordinates, if not given
+  PROF_SCOPE("pairs");
+  // Row iatom holds nop-1-iatom pairs
+  PROF_COUNT(pairsEvaluated,
+             (long long)(iEnd - iBegin) * (2 * nop - iBegin - iEnd - 1) / 2);
+
+  // Triclinic box: get the fractional coordinates, unless they were given
+  if (triclinic) {
+    cell = rdf::cellMatrix(frame.box, frame.tilt);
+    if (!sx || !sy || !sz) {
+      rdf::fractionalCoordinates(frame, &fx, &fy, &fz);
+      sx = fx.data();
+      sy = fy.data();
+      sz = fz.data();
+    }
+  }
+
+  for (int iatom = iBegin; iatom < iEnd; iatom++) {
+    if (type) {
+      rowOffset = offsets.data() + type[iatom] * (ntypes + 1);
+    }
+    // Bin the pairs with every jatom > iatom
+    if (triclinic) {
+      rdf::binRowTriclinic(sx[iatom], sy[iatom], sz[iatom], sx, sy, sz, type,
+                           rowOffset, iatom + 1, nop, cell, cutoff, binsize,
+                           rdfArray);
+    } else {
+      rdf::binRow(x[iatom], y[iatom], z[iatom], x, y, z, type, rowOffset,
+                  iatom + 1, nop, frame.box, cutoff, binsize, rdfArray);
+    }
+  } // end of loop through every iatom
+
+  return 0;
+}
+
+/********************************************/ /**
+ *  Function for adding the pairs of a frame to the \f$g(r)\f$ histogram,
+ using a linked-cell list.
+ *
+ * The linked-cell list is built, and all of its cells are visited by
+ rdf::accumulateCells.
+ *
+ *  @param[in] rdfArray The array for holding the histogram for the \f$g(r)\f$
+ values (the number of pairs in every bin)
+ *  @param[in] binsize The user-specified bin-width or bin size
+ *  @param[in] nbin The total number of bins in each histogram
+ *  @param[in] frame The current frame, holding the coordinates of the
+ particles and the box lengths
+ *  @param[in] cutoff This is the maximum length upto which the \f$g(r)\f$ will
+ be calculated
+ *  @param[in] ntypes The number of atom types; if more than 1, every pair is
+ binned into the partial histogram of its types (see rdf::RdfState)
+ *  @param[in] singlePrecision (Optional argument) Find the distances from
+ float coordinates (see nlist::CellList)
+ *  \return an int value of 0 (success) or 1 (the box is too small for a cell
+ list)
+ ***********************************************/
+int rdf::accumulateCellList(uint64_t *rdfArray, double binsize, int nbin,
+                            const gen::Frame &frame, double cutoff,
+                            int ntypes, bool singlePrecision) {
+  nlist::CellList cells; // Linked-cell list of the frame
+  int ncellTotal;        // Total number of cells
+
+  cells.singlePrecision = singlePrecision;
+  if (nlist::buildCellList(&cells, frame, cutoff) != 0) {
     return 1;
   }
+  ncellTotal = cells.size();
+
+  return rdf::accumulateCells(rdfArray, binsize, nbin, frame, cutoff, ntypes,
+                              cells, 0, ncellTotal);
+}
+
+/********************************************/ /**
+ *  Function for adding the pairs of a range of cells of a linked-cell list to
+ the \f$g(r)\f$ histogram.
+ *
+ * Every cell is paired with itself and with half of the 26 cells surrounding
+ it, so that every pair of particles within the cutoff is visited exactly once.
+ The distance of each pair is calculated exactly as in rdf::accumulatePairs, so
+ that both give identical histograms. If the cell list is in single precision,
+ the float kernels are used instead (see rdf::binRowFloat).
+ *
+ *  @param[in] rdfArray The array for holding the histogram for the \f$g(r)\f$
+ values (the number of pairs in every bin)
+ *  @param[in] binsize The user-specified bin-width or bin size
+ *  @param[in] nbin The total number of bins in each histogram
+ *  @param[in] frame The current frame, holding the coordinates of the
+ particles and the box lengths
+ *  @param[in] cutoff This is the maximum length upto which the \f$g(r)\f$ will
+ be calculated
+ *  @param[in] ntypes The number of atom types; if more than 1, every pair is
+ binned into the partial histogram of its types (see rdf::RdfState)
+ *  @param[in] cells The linked-cell list of the frame
+ *  @param[in] cellBegin The first (flattened) cell index to be visited
+ *  @param[in] cellEnd The cell index after the last cell to be visited
+ *  \return an int value of 0 (success)
+ ***********************************************/
+int rdf::accumulateCells(uint64_t *rdfArray, double binsize, int nbin,
+                         const gen::Frame &frame, double cutoff, int ntypes,
+                         const nlist::CellList &cells, int cellBegin,
+                         int cellEnd) {
+  const double *x = cells.x.data(); // Coordinates, sorted by cell
+  const double *y = cells.y.data();
+  const double *z = cells.z.data();
+  const float *xf = cells.xf.data(); // Float coordinates, sorted by cell
+  const float *yf = cells.yf.data();
+  const float *zf = cells.zf.data();
+  bool single = cells.singlePrecision; // Use the float coordinates
+  // Histogram offsets of the type pairs, if the types are used
+  std::vector<int> offsets = rdf::pairOffsets(ntypes, nbin);
+  const int *type = (ntypes > 1) ? cells.type.data() : nullptr;
+  const int *rowOffset = nullptr; // Offsets of the row of iatom
+  bool triclinic = frame.isTriclinic(); // Fractional coordinates are sorted
+  // Cell matrix of the box, if triclinic
+  rdf::CellMatrix cell = rdf::cellMatrix(frame.box, frame.tilt);
+  int jBegin, jEnd;  // Range of particles of jcell paired with iatom
+  int ix, iy, iz;  // 3D index of the current cell
+  int jcell;       // Neighbouring cell being paired with icell
+  int iEnd;        // Sorted particle after the last one of icell
+  // Offsets of the 13 neighbouring cells in the forward half-shell
+  const int halfShell[13][3] = {{1, 0, 0},  {-1, 1, 0}, {0, 1, 0},
+                                {1, 1, 0},  {-1, -1, 1}, {0, -1, 1},
+                                {1, -1, 1}, {-1, 0, 1}, {0, 0, 1},
+                                {1, 0, 1},  {-1, 1, 1}, {0, 1, 1},
+                                {1, 1, 1}};
+  PROF_SCOPE("pairs");
+
+  // Loop through the cells in the range
+  for (int icell = cellBegin; icell < cellEnd; icell++) {
+    ix = icell % cells.ncell[0];
+    iy = (icell / cells.ncell[0]) % cells.ncell[1];
+    iz = icell / (cells.ncell[0] * cells.ncell[1]);
+    iEnd = cells.cellStart[icell + 1];
+    // Loop through the cell itself (n = -1) and its half-shell
+    for (int n = -1; n < 13; n++) {
+      if (n < 0) {
+        jcell = icell;
+      } else {
+        jcell = nlist::cellIndex(cells, ix + halfShell[n][0],
+                                 iy + halfShell[n][1], iz + halfShell[n][2]);
+      }
+      PROF_COUNT(pairsEvaluated,
+                 (jcell == icell)
+                     ? (long long)(iEnd - cells.cellStart[icell]) *
+                           (iEnd - cells.cellStart[icell] - 1) / 2
+                     : (long long)(iEnd - cells.cellStart[icell]) *
+                           (cells.cellStart[jcell + 1] -
+                            cells.cellStart[jcell]));
+      // Bin the particles of icell against the contiguous range of jcell
+      for (int iatom = cells.cellStart[icell]; iatom < iEnd; iatom++) {
+        if (type) {
+          rowOffset = offsets.data() + type[iatom] * (ntypes + 1);
+        }
+        // Inside the same cell, only visit the particles after iatom
+        jBegin = (jcell == icell) ? iatom + 1 : cells.cellStart[jcell];
+        jEnd = cells.cellStart[jcell + 1];
+        if (single && triclinic) {
+          rdf::binRowTriclinic(xf[iatom], yf[iatom], zf[iatom], xf, yf, zf,
+                               type, rowOffset, jBegin, jEnd, cell, cutoff,
+                               binsize, rdfArray);
+        } else if (single) {
+          rdf::binRowFloat(xf[iatom], yf[iatom], zf[iatom], xf, yf, zf, type,
+                           rowOffset, jBegin, jEnd, frame.box, cutoff, binsize,
+                           rdfArray);
+        } else if (triclinic) {
+          rdf::binRowTriclinic(x[iatom], y[iatom], z[iatom], x, y, z, type,
+                               rowOffset, jBegin, jEnd, cell, cutoff, binsize,
+                               rdfArray);
+        } else {
+          rdf::binRow(x[iatom], y[iatom], z[iatom], x, y, z, type, rowOffset,
+                      jBegin, jEnd, frame.box, cutoff, binsize, rdfArray);
+        }
+      } // end of loop through iatom
+    }   // end of loop through neighbouring cells
+  }     // end of loop through cells in the range
+
+  return 0;
+}
+
+/********************************************/ /**
+ *  Function for adding the pairs of selected reference and target atoms of a
+ frame to the \f$g(r)\f$ histogram.
+ *
+ * The target atoms are gathered into a frame of their own, and sorted into a
+ linked-cell list whenever the box allows it. Every reference atom is then
+ binned against the targets in the 27 cells around it, or against all of the
+ targets otherwise, so that only \f$N_{ref} N_{target}\f$ pairs are visited
+ instead of all \f$N^2\f$. Every ordered pair of a reference and a target
+ atom is counted once. A reference atom which is also a target is binned
+ against itself at a distance of exactly zero, so these self-pairs are taken
+ back out of the first bin at the end.
+ *
+ *  @param[in] rdfArray The array for holding the histogram for the \f$g(r)\f$
+ values (the number of pairs in every bin)
+ *  @param[in] binsize The user-specified bin-width or bin size
+ *  @param[in] nbin The total number of bins
+ *  @param[in] frame The current frame, holding the coordinates of the
+ particles and the box lengths
+ *  @param[in] cutoff This is the maximum length upto which the \f$g(r)\f$ will
+ be calculated
+ *  @param[in] reference The indices of the reference atoms, in increasing order
+ (see sel::selectAtoms)
+ *  @param[in] target The indices of the target atoms, in increasing order
+ *  @param[in] targets The frame of the gathered target atoms, which is
+ overwritten (reusing its memory)
+ *  @param[in] cells The cell list of the target atoms, which is overwritten
+ (reusing its memory)
+ *  \return an int value of 0 (success)
+ ***********************************************/
+int rdf::accumulateSelected(uint64_t *rdfArray, double binsize, int nbin,
+                            const gen::Frame &frame, double cutoff,
+                            const std::vector<int> &reference,
+                            const std::vector<int> &target,
+                            gen::Frame *targets, nlist::CellList *cells) {
+  int ntarget = target.size(); // Number of target atoms
+  bool triclinic = frame.isTriclinic(); // Use fractional coordinates
+  // Cell matrix of the box, if triclinic
+  rdf::CellMatrix cell = rdf::cellMatrix(frame.box, frame.tilt);
+  bool useCells;     // true if the targets are in a cell list
+  const double *x, *y, *z; // Coordinates of the targets, as binned
+  double r[3];       // Coordinates of the current reference atom, as binned
+  std::array<int, 3> cellIdx; // 3D index of the cell of the reference atom
+  int jcell;         // Neighbouring cell of the reference atom
+  uint64_t nself = 0; // Reference atoms which are also targets
+  PROF_SCOPE("pairs");
+
+  // Gather the targets
+  targets->resize(ntarget);
+  targets->timestep = frame.timestep;
+  targets->boxLo = frame.boxLo;
+  targets->box = frame.box;
+  targets->tilt = frame.tilt;
+  for (int jatom = 0; jatom < ntarget; jatom++) {
+    targets->x[jatom] = frame.x[target[jatom]];
+    targets->y[jatom] = frame.y[target[jatom]];
+    targets->z[jatom] = frame.z[target[jatom]];
+    targets->id[jatom] = frame.id[target[jatom]];
+    targets->type[jatom] = frame.type[target[jatom]];
+  }
+  useCells = nlist::buildCellList(cells, *targets, cutoff) == 0;
+  if (useCells) {
+    x = cells->x.data();
+    y = cells->y.data();
+    z = cells->z.data();
+  } else {
+    // Without a cell list, the gathered copy is only read here, so it is
+    // turned into fractional coordinates in place if the box is triclinic
+    for (int jatom = 0; jatom < ntarget && triclinic; jatom++) {
+      rdf::toFractional(cell, targets->x[jatom], targets->y[jatom],
+                        targets->z[jatom], r);
+      targets->x[jatom] = r[0];
+      targets->y[jatom] = r[1];
+      targets->z[jatom] = r[2];
+    }
+    x = targets->x.data();
+    y = targets->y.data();
+    z = targets->z.data();
+  }
+
+  // Loop through the reference atoms
+  for (int iatom : reference) {
+    r[0] = frame.x[iatom];
+    r[1] = frame.y[iatom];
+    r[2] = frame.z[iatom];
+    if (useCells) {
+      cellIdx = nlist::cellCoordinates(*cells, frame, cell, r[0], r[1], r[2]);
+    }
+    if (triclinic) {
+      rdf::toFractional(cell, r[0], r[1], r[2], r);
+    }
+    if (!useCells) {
+      PROF_COUNT(pairsEvaluated, ntarget);
+      if (triclinic) {
+        rdf::binRowTriclinic(r[0], r[1], r[2], x, y, z, nullptr, nullptr, 0,
+                             ntarget, cell, cutoff, binsize, rdfArray);
+      } else {
+        rdf::binRow(r[0], r[1], r[2], x, y, z, nullptr, nullptr, 0, ntarget,
+                    frame.box, cutoff, binsize, rdfArray);
+      }
+      continue;
+    }
+    // Bin the targets of the 27 cells around the reference atom
+    for (int n = 0; n < 27; n++) {
+      jcell = nlist::cellIndex(*cells, cellIdx[0] + n % 3 - 1,
+                               cellIdx[1] + (n / 3) % 3 - 1,
+                               cellIdx[2] + n / 9 - 1);
+      PROF_COUNT(pairsEvaluated,
+                 cells->cellStart[jcell + 1] - cells->cellStart[jcell]);
+      if (triclinic) {
+        rdf::binRowTriclinic(r[0], r[1], r[2], x, y, z, nullptr, nullptr,
+                             cells->cellStart[jcell],
+                             cells->cellStart[jcell + 1], cell, cutoff,
+                             binsize, rdfArray);
+      } else {
+        rdf::binRow(r[0], r[1], r[2], x, y, z, nullptr, nullptr,
+                    cells->cellStart[jcell], cells->cellStart[jcell + 1],
+                    frame.box, cutoff, binsize, rdfArray);
+      }
+    } // end of loop through neighbouring cells
+  }   // end of loop through reference atoms
+
+  // Take the self-pairs back out; both lists are in increasing order
+  for (int iref = 0, jtarget = 0; iref < reference.size(); iref++) {
+    while (jtarget < ntarget && target[jtarget] < reference[iref]) {
+      jtarget++;
+    }
+    if (jtarget < ntarget && target[jtarget] == reference[iref]) {
+      nself++;
+    }
+  }
+  if (nbin > 0) {
+    rdfArray[0] -= nself;
+  }
+
+  return 0;
+}
+
+/********************************************/ /**
+ *  Function for splitting the rows of the triangular pair matrix into chunks
+ holding (nearly) the same number of pairs.
+ *
+ * Row iatom holds \f$N-1-i\f$ pairs, so equal numbers of rows would give the
+ first chunks far more work than the last ones. Instead, the rows are walked
+ through and a new chunk is started whenever the running number of pairs
+ reaches the next multiple of \f$N(N-1)/(2 n_{chunks})\f$.
+ *
+ *  @param[in] nop The total number of particles in the simulation box
+ *  @param[in] nchunks The number of chunks
+ *  \return a vector of nchunks+1 row boundaries; chunk c holds the rows from
+ element c up to (but not including) element c+1
+ ***********************************************/
+std::vector<int> rdf::balancedRows(int nop, int nchunks) {
+  std::vector<int> bounds(nchunks + 1, nop); // Row boundaries
+  double totalPairs = 0.5 * nop * (nop - 1.0); // Pairs in the matrix
+  double pairs = 0.0; // Running number of pairs before the current row
+  int ichunk = 1;     // Next chunk boundary to be found
+
+  bounds[0] = 0;
+  for (int iatom = 0; iatom < nop && ichunk < nchunks; iatom++) {
+    // Start a new chunk when this row passes the next boundary
+    while (ichunk < nchunks && pairs >= totalPairs * ichunk / nchunks) {
+      bounds[ichunk] = iatom;
+      ichunk++;
+    }
+    pairs += nop - 1 - iatom;
+  } // end of loop through rows
+
+  return bounds;
+}
+
+#ifdef USE_OPENMP
+/********************************************/ /**
+ *  Function for adding the pairs of a frame to the \f$g(r)\f$ histogram, using
+ all the OpenMP threads.
+ *
+ * The pairs are split into chunks, which are handed out to the threads
+ dynamically. Without a cell list, the chunks are ranges of rows of the
+ triangular pair matrix, balanced by rdf::balancedRows; with a cell list, they
+ are ranges of cells. Every thread fills its own private histogram, padded to
+ a whole number of cache lines so that no two threads write to the same line.
+ The private histograms are added to rdfArray at the end, so no atomics are
+ needed. Since the histograms are integer counts, the result is identical to
+ that of the serial path.
+ *
+ *  @param[in] rdfArray The array for holding the histogram for the \f$g(r)\f$
+ values (the number of pairs in every bin)
+ *  @param[in] binsize The user-specified bin-width or bin size
+ *  @param[in] nbin The total number of bins in the \f$g(r)\f$ histogram
+ *  @param[in] frame The current frame, holding the coordinates of the
+ particles and the box lengths
+ *  @param[in] cutoff This is the maximum length upto which the \f$g(r)\f$ will
+ be calculated
+ *  @param[in] ntypes The number of atom types; if more than 1, every pair is
+ binned into the partial histogram of its types (see rdf::RdfState)
+ *  @param[in] cells The linked-cell list of the frame (see
+ nlist::buildCellList), whose cells are at least as wide as the cutoff; if
+ null, every pair is visited
+ *  \return an int value of 0 (success)
+ ***********************************************/
+int rdf::accumulateThreaded(uint64_t *rdfArray, double binsize, int nbin,
+                            const gen::Frame &frame, double cutoff, int ntypes,
+                            const nlist::CellList *cells) {
+  bool useCellList = (cells != nullptr); // Visit neighbouring cells only
+  int nthreads = omp_get_max_threads(); // Number of threads
+  // Number of bins in a private histogram, rounded up to whole cache lines
+  int lineLength = gen::frameAlignment / sizeof(uint64_t);
+  int histLength = rdf::numberOfColumns(ntypes) * nbin;
+  int stride = ((histLength + lineLength - 1) / lineLength) * lineLength;
+  // Private histograms
+  std::vector<uint64_t, gen::AlignedAllocator<uint64_t>> threadHist(
+      nthreads * stride, 0);
+  int nchunks = 4 * nthreads; // More chunks than threads, for balance
+  std::vector<int> bounds;    // Boundaries of the chunks
+  gen::alignedVector sx, sy, sz; // Fractional coordinates, if triclinic
+
+  if (useCellList) {
+    // Equal ranges of cells
+    int ncellTotal = cells->size();
+    nchunks = std::min(nchunks, ncellTotal);
+    bounds.resize(nchunks + 1);
+    for (int ichunk = 0; ichunk <= nchunks; ichunk++) {
+      bounds[ichunk] = (int)((long long)ncellTotal * ichunk / nchunks);
+    }
+  } else {
+    // Ranges of rows holding the same number of pairs
+    bounds = rdf::balancedRows(frame.nop, nchunks);
+    // The chunks share the fractional coordinates, found once per frame
+    if (frame.isTriclinic()) {
+      rdf::fractionalCoordinates(frame, &sx, &sy, &sz);
+    }
+  }
+
+#pragma omp parallel num_threads(nthreads)
+  {
+    uint64_t *hist = threadHist.data() + omp_get_thread_num() * stride;
+#pragma omp for schedule(dynamic, 1)
+    for (int ichunk = 0; ichunk < nchunks; ichunk++) {
+      if (useCellList) {
+        rdf::accumulateCells(hist, binsize, nbin, frame, cutoff, ntypes,
+                             *cells, bounds[ichunk], bounds[ichunk + 1]);
+      } else {
+        rdf::accumulatePairs(hist, binsize, nbin, frame, cutoff, ntypes,
+                             bounds[ichunk], bounds[ichunk + 1],
+                             sx.empty() ? nullptr : sx.data(),
+                             sy.empty() ? nullptr : sy.data(),
+                             sz.empty() ? nullptr : sz.data());
+      }
+    } // end of loop through chunks
+  }   // end of parallel region
+
+  // Reduce the private histograms
+  for (int ithread = 0; ithread < nthreads; ithread++) {
+    for (int ibin = 0; ibin < histLength; ibin++) {
+      rdfArray[ibin] += threadHist[ithread * stride + ibin];
+    }
+  } // end of loop through threads
+
+  return 0;
 }
+#endif // USE_OPENMP
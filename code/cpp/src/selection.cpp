@@ -0,0 +1,139 @@
+#include <selection.hpp>
+
+/********************************************/ /**
+ *  Function for parsing a selection expression (see the sel namespace for the
+ syntax).
+ *  @param[in] expression The selection expression
+ *  @param[out] selection The parsed selection, which is overwritten
+ *  \return an int value of 0 (success) or 1 (the expression is invalid)
+ ***********************************************/
+int sel::parseSelection(const std::string &expression,
+                        sel::Selection *selection) {
+  std::string text = expression;     // Expression, with commas as spaces
+  std::vector<std::string> tokens;   // Words of the expression
+  std::string keyword;               // Keyword of the current clause
+  bool haveIds = false;              // An id clause has been read
+  bool haveTypes = false;            // A type clause has been read
+  size_t dash;                       // Position of the dash of an id range
+  int nvalues;                       // Values read for the current clause
+  sel::Region region;                // Region of the current clause
+
+  *selection = sel::Selection();
+  std::replace(text.begin(), text.end(), ',', ' ');
+  tokens = io::tokenizer(text);
+
+  for (int itoken = 0; itoken < tokens.size();) {
+    keyword = tokens[itoken++];
+    if (keyword == "and" || keyword == "all") {
+      continue;
+    }
+    // Count the values of the clause, up to the next keyword
+    nvalues = 0;
+    while (itoken + nvalues < tokens.size() &&
+           tokens[itoken + nvalues] != "and" &&
+           tokens[itoken + nvalues] != "all" &&
+           tokens[itoken + nvalues] != "id" &&
+           tokens[itoken + nvalues] != "type" &&
+           tokens[itoken + nvalues] != "x" &&
+           tokens[itoken + nvalues] != "y" && tokens[itoken + nvalues] != "z") {
+      nvalues++;
+    }
+    try {
+      if (keyword == "id" && !haveIds && nvalues > 0) {
+        haveIds = true;
+        for (int ivalue = 0; ivalue < nvalues; ivalue++) {
+          const std::string &value = tokens[itoken + ivalue];
+          dash = value.find('-', 1);
+          if (dash == std::string::npos) {
+            selection->idRanges.push_back({{std::stoi(value),
+                                            std::stoi(value)}});
+          } else {
+            selection->idRanges.push_back(
+                {{std::stoi(value.substr(0, dash)),
+                  std::stoi(value.substr(dash + 1))}});
+          }
+        }
+      } else if (keyword == "type" && !haveTypes && nvalues > 0) {
+        haveTypes = true;
+        for (int ivalue = 0; ivalue < nvalues; ivalue++) {
+          selection->types.push_back(std::stoi(tokens[itoken + ivalue]));
+        }
+      } else if ((keyword == "x" || keyword == "y" || keyword == "z") &&
+                 nvalues == 2) {
+        region.dim = keyword[0] - 'x';
+        region.lo = std::stod(tokens[itoken]);
+        region.hi = std::stod(tokens[itoken + 1]);
+        selection->regions.push_back(region);
+      } else {
+        std::cerr << "Could not understand the clause '" << keyword
+                  << "' of the selection '" << expression << "'.\n";
+        return 1;
+      }
+    } catch (const std::exception &) {
+      std::cerr << "Could not read the values of the clause '" << keyword
+                << "' of the selection '" << expression << "'.\n";
+      return 1;
+    }
+    itoken += nvalues;
+  } // end of loop through the tokens
+
+  return 0;
+}
+
+/********************************************/ /**
+ *  Function for writing a parsed selection as an expression, in a normalized
+ form: the id ranges, the types, then the regions, separated by single spaces
+ and "and", with every number in its shortest round-trip form. Expressions
+ which parse to the same selection give the same text, and the text parses
+ back to that selection.
+ *  @param[in] selection The parsed selection
+ *  \return the normalized expression ("all" if every atom is selected)
+ ***********************************************/
+std::string sel::formatSelection(const sel::Selection &selection) {
+  std::string text; // Normalized expression
+
+  if (selection.isAll()) {
+    return "all";
+  }
+  if (!selection.idRanges.empty()) {
+    text += "id";
+    for (const std::array<int, 2> &range : selection.idRanges) {
+      text += " " + std::to_string(range[0]) + "-" + std::to_string(range[1]);
+    }
+  }
+  if (!selection.types.empty()) {
+    text += text.empty() ? "type" : " and type";
+    for (int type : selection.types) {
+      text += " " + std::to_string(type);
+    }
+  }
+  for (const sel::Region &region : selection.regions) {
+    text += text.empty() ? "" : " and ";
+    text += (char)('x' + region.dim);
+    text += ' ';
+    io::appendNumber(region.lo, &text);
+    text += ' ';
+    io::appendNumber(region.hi, &text);
+  }
+
+  return text;
+}
+
+/********************************************/ /**
+ *  Function for getting the indices of the atoms of a frame which a selection
+ selects, in the order of the frame. The list is reused, so passing the same
+ one for every frame avoids reallocating it.
+ *  @param[in] selection The selection
+ *  @param[in] frame The frame
+ *  @param[out] indices The indices of the selected atoms, which are
+ overwritten
+ ***********************************************/
+void sel::selectAtoms(const sel::Selection &selection, const gen::Frame &frame,
+                      std::vector<int> *indices) {
+  indices->clear();
+  for (int iatom = 0; iatom < frame.nop; iatom++) {
+    if (sel::isSelected(selection, frame, iatom)) {
+      indices->push_back(iatom);
+    }
+  } // end of loop through all atoms
+}
@@ -0,0 +1,251 @@
+#include <streamReader.hpp>
+
+// Bytes read in from the stream at a time
+static const std::size_t streamChunk = 1 << 20;
+
+/********************************************/ /**
+ *  Function for opening a trajectory which is to be streamed.
+ *
+ * "-" is stdin, which may be plain or gzip-compressed. Files ending in .zst or
+ .zstd are decompressed by the zstd program, and anything else is read with
+ zlib (which also reads uncompressed files).
+ *  @param[in] source The path of the trajectory file, or "-" for stdin
+ *  \return an int value of 0 (success) or 1 (error)
+ ***********************************************/
+int io::FrameStream::open(const std::string &source) {
+  int fd; // Descriptor handed to zlib
+
+  close();
+  if (source == "-") {
+    fd = dup(fileno(stdin));
+  } else if (io::hasSuffix(source, ".zst") || io::hasSuffix(source, ".zstd")) {
+    if (!io::file_exists(source)) {
+      std::cerr
+          << "Fatal Error: The file does not exist or you gave the wrong path.\n";
+      return 1;
+    }
+    // Quote the path for the shell
+    std::string quoted = "'"; // Path inside single quotes
+    for (char c : source) {
+      quoted += (c == '\'') ? std::string("'\\''") : std::string(1, c);
+    }
+    quoted += "'";
+    pipe_ = popen(("zstd -dcq -- " + quoted).c_str(), "r");
+    if (pipe_ == nullptr) {
+      std::cerr << "Could not run zstd to decompress " << source << "\n";
+      return 1;
+    }
+    fd = dup(fileno(pipe_));
+  } else {
+    fd = ::open(source.c_str(), O_RDONLY);
+    if (fd < 0) {
+      std::cerr
+          << "Fatal Error: The file does not exist or you gave the wrong path.\n";
+      return 1;
+    }
+  }
+  if (fd < 0 || (gz_ = gzdopen(fd, "rb")) == nullptr) {
+    std::cerr << "Could not open " << source << " for reading.\n";
+    if (fd >= 0) {
+      ::close(fd);
+    }
+    close();
+    return 1;
+  }
+  gzbuffer(gz_, streamChunk);
+
+  buffer_.resize(streamChunk);
+  begin_ = atoms_ = frameEnd_ = end_ = 0;
+  dropped_ = 0;
+  eof_ = false;
+  return 0;
+}
+
+/********************************************/ /**
+ *  Function for closing the stream, and waiting for the zstd program if it
+ was used. The exit status of zstd is not checked here, since it is killed by
+ a broken pipe if the stream is closed early (see io::FrameStream::fill).
+ ***********************************************/
+void io::FrameStream::close() {
+  if (gz_ != nullptr) {
+    gzclose(gz_);
+    gz_ = nullptr;
+  }
+  if (pipe_ != nullptr) {
+    pclose(pipe_);
+    pipe_ = nullptr;
+  }
+}
+
+/********************************************/ /**
+ *  Function for reading more of the stream into the end of the buffer. The
+ buffer is doubled whenever it is full, so it grows to fit the largest frame.
+ *
+ * The end of a compressed stream is only a clean end if the decompression
+ finished: a gzip stream cut short, or zstd exiting with an error, is a read
+ error rather than the end of the trajectory.
+ *  \return an int value of 0 (success, or the end of the stream was reached)
+ or 1 (read error)
+ ***********************************************/
+int io::FrameStream::fill() {
+  int nread;  // Bytes read in
+  int errnum; // zlib error code
+  int status; // Exit status of zstd
+
+  if (end_ == buffer_.size()) {
+    buffer_.resize(2 * buffer_.size());
+  }
+  nread = gzread(gz_, buffer_.data() + end_,
+                 (unsigned)std::min(buffer_.size() - end_, streamChunk));
+  if (nread < 0) {
+    std::cerr << "Could not read the trajectory: " << gzerror(gz_, &errnum)
+              << "\n";
+    return 1;
+  }
+  if (nread == 0) {
+    gzerror(gz_, &errnum);
+    if (errnum == Z_BUF_ERROR) {
+      std::cerr << "The compressed trajectory is truncated.\n";
+      return 1;
+    }
+    if (pipe_ != nullptr) {
+      status = pclose(pipe_);
+      pipe_ = nullptr;
+      if (status != 0) {
+        std::cerr << "zstd could not decompress the trajectory.\n";
+        return 1;
+      }
+    }
+    eof_ = true;
+  }
+  end_ += nread;
+  return 0;
+}
+
+/********************************************/ /**
+ *  Function for making sure that a number of whole lines have been read in,
+ reading more of the stream as needed. At the end of the stream, a last line
+ without a newline counts as a whole line.
+ *  @param[in, out] pos The offset in the buffer of the first line; on return,
+ the offset after the last line
+ *  @param[in] nlines The number of lines
+ *  \return an int value of 0 (success) or 1 (the stream ended, or could not
+ be read)
+ ***********************************************/
+int io::FrameStream::findLines(std::size_t *pos, int nlines) {
+  const char *newline; // Next newline
+
+  while (nlines > 0) {
+    newline = static_cast<const char *>(
+        memchr(buffer_.data() + *pos, '\n', end_ - *pos));
+    if (newline != nullptr) {
+      *pos = newline - buffer_.data() + 1;
+      nlines--;
+      continue;
+    }
+    if (eof_) {
+      // A last line without a newline
+      if (nlines == 1 && *pos < end_) {
+        *pos = end_;
+        return 0;
+      }
+      return 1;
+    }
+    if (fill() != 0) {
+      return 1;
+    }
+  } // end of finding lines
+
+  return 0;
+}
+
+/********************************************/ /**
+ *  Function for reading in the next frame, up to the end of its last atom
+ line, and parsing its header.
+ *
+ * The previous frame is dropped from the buffer first. The atom lines are not
+ parsed, so that frames which are not needed can be skipped cheaply; call
+ io::FrameStream::parse to parse them.
+ *  @param[out] entry The timestep, number of atoms and box of the frame (the
+ offset is the position of the frame in the decompressed stream)
+ *  \return an int value of 0 (success), 1 (error) or -1 (no frames left; an
+ incomplete last frame is left out)
+ ***********************************************/
+int io::FrameStream::nextHeader(io::FrameIndexEntry *entry) {
+  std::size_t pos;    // End of the lines found so far
+  const char *cursor; // Position for the parser
+
+  if (gz_ == nullptr) {
+    return -1;
+  }
+  // Drop the previous frame, and any blank lines after it
+  dropped_ += frameEnd_;
+  memmove(buffer_.data(), buffer_.data() + frameEnd_, end_ - frameEnd_);
+  end_ -= frameEnd_;
+  begin_ = atoms_ = frameEnd_ = 0;
+  while (true) {
+    while (begin_ < end_ && isspace(buffer_[begin_])) {
+      begin_++;
+    }
+    if (begin_ < end_ || eof_) {
+      break;
+    }
+    if (fill() != 0) {
+      return 1;
+    }
+  }
+  if (begin_ == end_) {
+    return -1;
+  }
+
+  // The header is 9 lines long
+  pos = begin_;
+  if (findLines(&pos, 9) != 0) {
+    if (!eof_) {
+      return 1;
+    }
+    std::cerr << "The last frame is incomplete, and is left out.\n";
+    return -1;
+  }
+  cursor = buffer_.data() + begin_;
+  if (io::parseFrameHeader(&cursor, buffer_.data() + pos, &entry_,
+                           &columns_) != 0) {
+    std::cerr << "Invalid frame header in the traj file!\n";
+    return 1;
+  }
+  entry_.offset = dropped_ + begin_;
+  atoms_ = cursor - buffer_.data();
+
+  // Followed by one line per atom
+  pos = atoms_;
+  if (findLines(&pos, entry_.nop) != 0) {
+    if (!eof_) {
+      return 1;
+    }
+    std::cerr << "The last frame is incomplete, and is left out.\n";
+    return -1;
+  }
+  frameEnd_ = pos;
+
+  *entry = entry_;
+  return 0;
+}
+
+/********************************************/ /**
+ *  Function for parsing the atom lines of the frame read in by
+ io::FrameStream::nextHeader into a reusable frame.
+ *  @param[in, out] frame The frame, which is overwritten
+ *  \return an int value of 0 (success) or 1 (error)
+ ***********************************************/
+int io::FrameStream::parse(gen::Frame *frame) {
+  const char *cursor = buffer_.data() + atoms_; // First atom line
+
+  frame->timestep = entry_.timestep;
+  frame->boxLo = entry_.boxLo;
+  frame->box = entry_.box;
+  frame->tilt = entry_.tilt;
+  frame->resize(entry_.nop);
+  PROF_COUNT(bytesParsed, frameEnd_ - begin_);
+
+  return io::parseAtoms(&cursor, buffer_.data() + frameEnd_, columns_, frame);
+}
@@ -0,0 +1,139 @@
+#include <structure.hpp>
+
+/********************************************/ /**
+ *  Function for getting the running coordination numbers of an accumulation
+ state.
+ *
+ * The raw histograms are summed up bin by bin, and divided by the number of
+ reference particles summed over the frames. A like pair is a neighbour of
+ both of its particles, so it counts twice; an unlike pair of types a and b
+ only counts as a neighbour of type b around its particle of type a. For
+ selected atoms, the ordered pairs are divided by the number of reference
+ atoms, which gives the number of target atoms around a reference atom.
+ *
+ *  @param[in] state The accumulation state
+ *  \return the coordination numbers at the upper edge of every bin, laid out
+ as the histograms (see rdf::RdfState); the columns of types which never
+ appear are zero
+ ***********************************************/
+std::vector<double> rdf::coordinationNumbers(const rdf::RdfState &state) {
+  int nbin = state.nbin;     // Number of bins of each histogram
+  int ntypes = state.ntypes; // Number of atom types
+  int ncolumns = rdf::numberOfColumns(ntypes); // Histograms in the state
+  std::vector<double> cn(state.histogram.size(), 0.0); // Coordination numbers
+  double sum;        // Running sum of the current histogram
+  double pairFactor; // 2 for like pairs, 1 for unlike pairs
+  int icolumn;       // Column of the current pair of types
+
+  // The total is the sum of the partials
+  for (int ibin = 0; ibin < nbin; ibin++) {
+    for (icolumn = (ncolumns > 1) ? 1 : 0; icolumn < ncolumns; icolumn++) {
+      cn[ibin] += state.histogram[icolumn * nbin + ibin];
+    }
+  } // end of loop through all bins
+  if (!state.sumSelected.empty()) {
+    sum = 0;
+    for (int ibin = 0; ibin < nbin && state.sumSelected[0] > 0; ibin++) {
+      sum += cn[ibin];
+      cn[ibin] = sum / state.sumSelected[0];
+    }
+  } else if (state.sumCount[0] > 0) {
+    sum = 0;
+    for (int ibin = 0; ibin < nbin; ibin++) {
+      sum += cn[ibin];
+      cn[ibin] = 2 * sum / state.sumCount[0];
+    }
+  }
+
+  // Neighbours of type b around a particle of type a
+  for (int itype = 1; itype <= ntypes && ntypes > 1; itype++) {
+    for (int jtype = itype; jtype <= ntypes; jtype++) {
+      icolumn = rdf::pairColumn(itype, jtype, ntypes);
+      if (state.sumCount[itype] == 0 || state.sumCount[jtype] == 0) {
+        continue;
+      }
+      pairFactor = (itype == jtype) ? 2.0 : 1.0;
+      sum = 0;
+      for (int ibin = 0; ibin < nbin; ibin++) {
+        sum += state.histogram[icolumn * nbin + ibin];
+        cn[icolumn * nbin + ibin] = pairFactor * sum / state.sumCount[itype];
+      }
+    } // end of loop through jtype
+  }   // end of loop through itype
+
+  return cn;
+}
+
+/********************************************/ /**
+ *  Function for getting the static structure factors of a normalized
+ \f$g(r)\f$, on a grid of q values.
+ *
+ * The sine transform is a direct sum over the bins which lie wholly within the
+ cutoff, at their centres. For every q, the factors
+ \f$r^2 \sin(qr)/(qr)\f$ of all the bins are found once, and then shared by
+ every column, so the sum over the bins is a plain dot product.
+ *
+ *  @param[in] state The accumulation state, for the bins and the number density
+ *  @param[in] rdfArray The normalized \f$g(r)\f$ histograms (see
+ rdf::normalizeState)
+ *  @param[in] q The q values, in inverse units of length
+ *  \return the structure factors, with q.size() values per column, in the
+ column order of the histograms (see rdf::RdfState); the columns of types
+ which never appear are zero
+ ***********************************************/
+std::vector<double> rdf::structureFactor(const rdf::RdfState &state,
+                                         const std::vector<double> &rdfArray,
+                                         const std::vector<double> &q) {
+  int nbin = state.nbin;     // Number of bins of each histogram
+  int ntypes = state.ntypes; // Number of atom types
+  int ncolumns = rdf::numberOfColumns(ntypes); // Histograms in rdfArray
+  int nq = q.size();         // Number of q values
+  std::vector<double> sq(ncolumns * nq, 0.0); // Structure factors
+  std::vector<double> weight(nbin, 0.0); // r^2 sin(qr)/(qr) dr of every bin
+  std::vector<bool> present(ncolumns, true); // Both types of a column appear
+  double pi = 3.14159265;  // Value of pi
+  double rho;              // Total number density
+  double r;                // Centre of the current bin
+  double sum;              // Sum over the bins of the current column
+  const double *g;         // Current column of the g(r)
+  int nfull = 0;           // Bins lying wholly within the cutoff
+
+  if (state.sumVolume <= 0 || nq == 0) {
+    return sq;
+  }
+  // The density of the target atoms, if atoms were selected
+  rho = (state.sumSelected.empty() ? state.sumCount[0]
+                                   : state.sumSelected[1]) /
+        state.sumVolume;
+  while (nfull < nbin &&
+         (nfull + 1) * state.binsize <= state.cutoff * (1 + 1e-12)) {
+    nfull++;
+  }
+  for (int itype = 1; itype <= ntypes && ntypes > 1; itype++) {
+    for (int jtype = itype; jtype <= ntypes; jtype++) {
+      present[rdf::pairColumn(itype, jtype, ntypes)] =
+          state.sumCount[itype] > 0 && state.sumCount[jtype] > 0;
+    }
+  }
+
+  // Loop through the q values
+  for (int iq = 0; iq < nq; iq++) {
+    for (int ibin = 0; ibin < nfull; ibin++) {
+      r = state.binsize * (ibin + 0.5);
+      weight[ibin] = r * sin(q[iq] * r) / q[iq] * state.binsize;
+    }
+    for (int icolumn = 0; icolumn < ncolumns; icolumn++) {
+      if (!present[icolumn]) {
+        continue;
+      }
+      g = rdfArray.data() + icolumn * nbin;
+      sum = 0;
+      for (int ibin = 0; ibin < nfull; ibin++) {
+        sum += weight[ibin] * (g[ibin] - 1.0);
+      }
+      sq[icolumn * nq + iq] = 1.0 + 4.0 * pi * rho * sum;
+    } // end of loop through columns
+  }   // end of loop through q values
+
+  return sq;
+}
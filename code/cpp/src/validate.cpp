@@ -0,0 +1,171 @@
+// Standard Library
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Internal Libraries
+#include <accumulator.hpp>
+#include <binaryTraj.hpp>
+#include <inputOutput.hpp>
+#include <mmapReader.hpp>
+#include <neighbours.hpp>
+#include <rdf.hpp>
+
+/********************************************/ /**
+ *  Compares the single-precision g(r) with the double-precision one on a
+ reference trajectory.
+ *
+ * Usage: yodaValidate [trajectory] [--frames n] [--cutoff r] [--binsize b]
+ [--tolerance t]
+ *
+ * The first n frames of the trajectory (a text or binary trajectory, by default
+ the one runYoda reads) are accumulated twice, with the distances found in
+ double and in float (see rdf::RdfAccumulator::setSinglePrecision), including
+ the partial g(r) of every pair of atom types. The largest absolute deviation of
+ the g(r), the bin it is found in, and the fraction of pairs which were binned
+ differently are printed. A pair moved across a bin edge by rounding changes a
+ sparsely populated bin a lot, so the exit code is 1 if the fraction of pairs
+ binned differently (rather than the deviation) is above the tolerance. It is
+ also 1 if no frame had a box large enough for a cell list, since then no
+ distances were found in float at all.
+ ***********************************************/
+int main(int argc, char *argv[]) {
+  std::string trajectory = "./../../data/liq-mW"; // Reference trajectory
+  int nframes = 10;        // Frames to be compared
+  double cutoff = 9;       // Cutoff of the g(r), with room for a cell list
+  double binsize = 0.01;   // Bin width
+  double tolerance = 1e-4; // Largest fraction of pairs binned differently
+  std::string option;      // Current argument
+  bool isBinary;           // true for a binary trajectory
+  io::MappedFile dumpFile; // Memory map of a text trajectory
+  io::BinaryTrajectory binaryTraj; // Binary trajectory
+  std::vector<io::FrameIndexEntry> frameIndex; // Offsets of the frames
+  gen::Frame frame;        // Current frame
+  int ntypes = 1;          // Number of atom types
+  bool cellsUsed = false;  // true once a frame was binned from a cell list
+  double maxDeviation = 0; // Largest deviation of the g(r)
+  int worstBin = 0;        // Bin of the largest deviation
+  int worstColumn = 0;     // Histogram of the largest deviation
+  uint64_t moved = 0;      // Pairs in a different bin (counted twice)
+  uint64_t npairs = 0;     // Pairs in all the bins
+  double movedFraction;    // Fraction of pairs binned differently
+
+  // Read in the options
+  try {
+    for (int iarg = 1; iarg < argc; iarg++) {
+      option = argv[iarg];
+      bool hasValue = iarg + 1 < argc; // The option has a value after it
+      if (option == "--frames" && hasValue) {
+        nframes = std::stoi(argv[++iarg]);
+      } else if (option == "--cutoff" && hasValue) {
+        cutoff = std::stod(argv[++iarg]);
+      } else if (option == "--binsize" && hasValue) {
+        binsize = std::stod(argv[++iarg]);
+      } else if (option == "--tolerance" && hasValue) {
+        tolerance = std::stod(argv[++iarg]);
+      } else if (option.compare(0, 1, "-") == 0) {
+        std::cerr << "Usage: " << argv[0]
+                  << " [trajectory] [--frames n] [--cutoff r] [--binsize b] "
+                     "[--tolerance t]\n";
+        return 1;
+      } else {
+        trajectory = option;
+      }
+    }
+  } catch (const std::exception &) {
+    std::cerr << "Invalid value for the option " << option << "\n";
+    return 1;
+  }
+  if (cutoff <= 0 || binsize <= 0) {
+    std::cerr << "The cutoff and bin size must be positive.\n";
+    return 1;
+  }
+
+  // Open the trajectory
+  isBinary = io::isBinaryTrajectory(trajectory);
+  if (isBinary) {
+    if (binaryTraj.open(trajectory) != 0) {
+      return 1;
+    }
+    frameIndex = binaryTraj.frameIndex();
+  } else if (io::getFrameIndex(trajectory, &frameIndex) != 0 ||
+             dumpFile.open(trajectory) != 0) {
+    return 1;
+  }
+  nframes = std::min<int>(nframes, frameIndex.size());
+  if (nframes <= 0) {
+    std::cerr << "The trajectory has no frames.\n";
+    return 1;
+  }
+
+  // Reads in a frame
+  auto readFrame = [&](int iframe) {
+    if (isBinary) {
+      return binaryTraj.readFrame(iframe, &frame);
+    }
+    const char *cursor = dumpFile.data() + frameIndex[iframe].offset;
+    return io::parseFrame(&cursor, dumpFile.end(), &frame);
+  };
+
+  // The partial g(r) of every pair of the types of the first frame
+  if (readFrame(0) != 0) {
+    return 1;
+  }
+  if (frame.nop > 0) {
+    ntypes = std::max(
+        *std::max_element(frame.type.begin(), frame.type.end()), 1);
+  }
+  rdf::RdfAccumulator reference(binsize, cutoff, ntypes); // Double precision
+  rdf::RdfAccumulator single(binsize, cutoff, ntypes);    // Single precision
+  single.setSinglePrecision(true);
+
+  for (int iframe = 0; iframe < nframes; iframe++) {
+    if (readFrame(iframe) != 0 || reference.addFrame(frame) != 0 ||
+        single.addFrame(frame) != 0) {
+      return 1;
+    }
+    cellsUsed = cellsUsed || nlist::isUsable(nlist::boxWidths(frame), cutoff);
+  }
+  if (!cellsUsed) {
+    std::cout << "NOT VALIDATED: the boxes are too small for a cell list, so "
+                 "both g(r)s were found in double precision.\n";
+    return 1;
+  }
+
+  // Compare the g(r)s and the raw pair counts
+  std::vector<double> rdfDouble = reference.result();
+  std::vector<double> rdfSingle = single.result();
+  const rdf::RdfState &state = reference.state(); // Settings and counts
+  for (int i = 0; i < rdfDouble.size(); i++) {
+    if (std::abs(rdfSingle[i] - rdfDouble[i]) > maxDeviation) {
+      maxDeviation = std::abs(rdfSingle[i] - rdfDouble[i]);
+      worstColumn = i / state.nbin;
+      worstBin = i % state.nbin;
+    }
+  }
+  for (int i = 0; i < state.histogram.size(); i++) {
+    uint64_t a = state.histogram[i];          // Double count
+    uint64_t b = single.state().histogram[i]; // Single count
+    moved += (a > b) ? a - b : b - a;
+    npairs += a;
+  }
+  movedFraction = (npairs > 0) ? 0.5 * moved / npairs : 0.0;
+
+  std::cout << "Frames compared            " << nframes << "\n"
+            << "Atom types                 " << ntypes << "\n"
+            << "Largest |g_float - g|      " << maxDeviation << "\n"
+            << "  at r                     " << (worstBin + 0.5) * binsize
+            << " (histogram " << worstColumn << ")\n"
+            << "Pairs binned differently   " << movedFraction << "\n";
+  if (movedFraction > tolerance) {
+    std::cout << "FAILED: more pairs were binned differently than the "
+                 "tolerance of "
+              << tolerance << "\n";
+    return 1;
+  }
+  std::cout << "PASSED (tolerance " << tolerance << ")\n";
+
+  return 0;
+}
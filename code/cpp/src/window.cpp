@@ -0,0 +1,94 @@
+#include <window.hpp>
+
+// The header is written as it is laid out in memory
+static_assert(sizeof(io::WindowHeader) == 56,
+              "Unexpected padding in io::WindowHeader");
+
+/********************************************/ /**
+ *  Function for starting a window file. The header is written straight away
+ to filename.tmp, and the number of windows is filled in by
+ io::WindowWriter::close.
+ *  @param[in] filename The path of the window file
+ *  @param[in] state An accumulation state with the settings of the windows
+ *  @param[in] windowFrames The number of frames per window
+ *  @param[in] windowStride The number of frames between the starts of windows
+ *  \return an int value of 0 (success) or 1 (error)
+ ***********************************************/
+int io::WindowWriter::open(const std::string &filename,
+                           const rdf::RdfState &state, int windowFrames,
+                           int windowStride) {
+  filename_ = filename;
+  header_ = io::WindowHeader();
+  memcpy(header_.magic, io::windowMagic, sizeof(header_.magic));
+  header_.nbin = state.nbin;
+  header_.ntypes = state.ntypes;
+  header_.ncolumns = state.histogram.size() / std::max(state.nbin, 1);
+  header_.windowFrames = windowFrames;
+  header_.windowStride = windowStride;
+  header_.binsize = state.binsize;
+  header_.cutoff = state.cutoff;
+  row_.resize(state.histogram.size());
+
+  file_.open(filename_ + ".tmp", std::ios::binary);
+  if (!file_.is_open()) {
+    std::cerr << "Could not open " << filename_ << ".tmp for writing.\n";
+    return 1;
+  }
+  file_.write(reinterpret_cast<const char *>(&header_), sizeof(header_));
+
+  return file_.good() ? 0 : 1;
+}
+
+/********************************************/ /**
+ *  Function for appending the normalized \f$g(r)\f$ of a window to the file.
+ *  @param[in] firstTimestep The timestep of the first frame of the window
+ *  @param[in] lastTimestep The timestep of the last frame of the window
+ *  @param[in] rdfArray The normalized \f$g(r)\f$ histograms of the window (see
+ rdf::normalizeState)
+ *  \return an int value of 0 (success) or 1 (error)
+ ***********************************************/
+int io::WindowWriter::write(long long firstTimestep, long long lastTimestep,
+                            const std::vector<double> &rdfArray) {
+  int64_t timesteps[2] = {firstTimestep, lastTimestep}; // Range of the window
+  PROF_SCOPE("write");
+
+  if (rdfArray.size() != row_.size()) {
+    std::cerr << "The g(r) of a window does not match " << filename_ << "\n";
+    return 1;
+  }
+  for (int ibin = 0; ibin < row_.size(); ibin++) {
+    row_[ibin] = rdfArray[ibin];
+  }
+  file_.write(reinterpret_cast<const char *>(timesteps), sizeof(timesteps));
+  file_.write(reinterpret_cast<const char *>(row_.data()),
+              row_.size() * sizeof(float));
+  if (!file_.good()) {
+    std::cerr << "Could not write to " << filename_ << ".tmp\n";
+    return 1;
+  }
+  header_.nwindows++;
+
+  return 0;
+}
+
+/********************************************/ /**
+ *  Function for finishing a window file. The number of windows is written into
+ the header, and the temporary file replaces the window file.
+ *  \return an int value of 0 (success) or 1 (error)
+ ***********************************************/
+int io::WindowWriter::close() {
+  std::string tmpFile = filename_ + ".tmp"; // Written first, then renamed
+
+  if (!file_.is_open()) {
+    return 1;
+  }
+  file_.seekp(0);
+  file_.write(reinterpret_cast<const char *>(&header_), sizeof(header_));
+  file_.close();
+  if (!file_.good() || rename(tmpFile.c_str(), filename_.c_str()) != 0) {
+    std::cerr << "Could not write " << filename_ << "\n";
+    return 1;
+  }
+
+  return 0;
+}